@@ -0,0 +1,104 @@
+// stats_codec_bench.cpp — wire size and decode cost: JSON vs CBOR vs MessagePack
+// -----------------------------------------------------------------------------
+// Usage: stats-codec-bench [containers=8000] [iterations=200]
+//
+// Encodes one synthetic stats frame in every supported encoding and decodes
+// it repeatedly with the decoder StatsWsClient uses for that encoding
+// (StatsDecoder for JSON text, StatsBinaryDecoder for CBOR / MessagePack).
+// The nlohmann DOM readers are timed as a reference point.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "stats_binary_decoder.hpp"
+#include "stats_decoder.hpp"
+#include "stats_model.hpp"
+
+namespace
+{
+    nlohmann::json make_frame(std::size_t containers)
+    {
+        std::mt19937_64 rng{42};
+        std::uniform_real_distribution<double> cpu{0.0, 4.0};
+        std::uniform_int_distribution<uint64_t> mem{1u << 20, 8ull << 30};
+
+        nlohmann::json j = nlohmann::json::object();
+        char id[65];
+        for (std::size_t i = 0; i < containers; ++i)
+        {
+            std::snprintf(id, sizeof(id), "%016llx%016llx%016llx%016llx",
+                          static_cast<unsigned long long>(rng()),
+                          static_cast<unsigned long long>(rng()),
+                          static_cast<unsigned long long>(rng()),
+                          static_cast<unsigned long long>(i));
+            j[id] = {{"stats", {{"cpu_avg", cpu(rng)}, {"max_mem", mem(rng)}}},
+                     {"timestamp", 1'750'000'000'000ull + i}};
+        }
+        return j;
+    }
+
+    template <typename Fn>
+    double time_ns(int iterations, Fn &&fn)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            fn();
+        const auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const std::size_t containers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    const nlohmann::json frame = make_frame(containers);
+    const std::string json = frame.dump();
+    const std::vector<uint8_t> cbor = nlohmann::json::to_cbor(frame);
+    const std::vector<uint8_t> msgpack = nlohmann::json::to_msgpack(frame);
+
+    StatsDecoder text;
+    StatsBinaryDecoder binary;
+    std::size_t entries = 0;
+    auto sink = [&](std::string_view, const TimestampedStats &)
+    { ++entries; };
+
+    const double json_ns = time_ns(iterations, [&]
+                                   { (void)text.decode(json, sink); });
+    const double cbor_ns = time_ns(iterations, [&]
+                                   { (void)binary.decode(std::as_bytes(std::span{cbor}),
+                                                         StatsEncoding::Cbor, sink); });
+    const double msgpack_ns = time_ns(iterations, [&]
+                                      { (void)binary.decode(std::as_bytes(std::span{msgpack}),
+                                                            StatsEncoding::MsgPack, sink); });
+
+    const double json_dom_ns = time_ns(iterations, [&]
+                                       { entries += nlohmann::json::parse(json).size(); });
+    const double cbor_dom_ns = time_ns(iterations, [&]
+                                       { entries += nlohmann::json::from_cbor(cbor).size(); });
+    const double msgpack_dom_ns = time_ns(iterations, [&]
+                                          { entries += nlohmann::json::from_msgpack(msgpack).size(); });
+
+    std::printf("%zu containers, %d iterations\n\n", containers, iterations);
+    std::printf("%-10s %12s %14s %12s %14s\n", "encoding", "bytes", "decode ns/ent", "MB/s", "DOM ns/ent");
+    auto row = [&](const char *name, std::size_t bytes, double ns, double dom_ns)
+    {
+        std::printf("%-10s %12zu %14.1f %12.1f %14.1f\n", name, bytes,
+                    ns / static_cast<double>(containers),
+                    static_cast<double>(bytes) / ns * 1e3,
+                    dom_ns / static_cast<double>(containers));
+    };
+    row("json", json.size(), json_ns, json_dom_ns);
+    row("cbor", cbor.size(), cbor_ns, cbor_dom_ns);
+    row("msgpack", msgpack.size(), msgpack_ns, msgpack_dom_ns);
+
+    return entries == 0;
+}
@@ -0,0 +1,132 @@
+// stats_decode_bench.cpp — DOM (nlohmann) vs streaming StatsDecoder
+// -----------------------------------------------------------------------------
+// Usage: stats-decode-bench [containers=8000] [iterations=200]
+//
+// Builds one synthetic stats frame with the given number of containers and
+// decodes it repeatedly through both paths, reporting ns per frame and per
+// entry.  Both paths produce a StatsMap so the comparison includes the same
+// container‑side work the ingest thread does.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "stats_decoder.hpp"
+#include "stats_json.hpp"
+#include "stats_model.hpp"
+
+namespace
+{
+    std::string make_frame(std::size_t containers)
+    {
+        std::mt19937_64 rng{42};
+        std::uniform_real_distribution<double> cpu{0.0, 4.0};
+        std::uniform_int_distribution<uint64_t> mem{1u << 20, 8ull << 30};
+
+        nlohmann::json j = nlohmann::json::object();
+        char id[65];
+        for (std::size_t i = 0; i < containers; ++i)
+        {
+            std::snprintf(id, sizeof(id), "%016llx%016llx%016llx%016llx",
+                          static_cast<unsigned long long>(rng()),
+                          static_cast<unsigned long long>(rng()),
+                          static_cast<unsigned long long>(rng()),
+                          static_cast<unsigned long long>(i));
+            j[id] = {{"stats", {{"cpu_avg", cpu(rng)}, {"max_mem", mem(rng)}}},
+                     {"timestamp", 1'750'000'000ull + i}};
+        }
+        return j.dump();
+    }
+
+    // The pre‑decoder ingest path, verbatim from StatsWsClient.
+    StatsMap decode_dom(std::string_view json_sv)
+    {
+        StatsMap sm;
+        auto j = nlohmann::json::parse(json_sv, nullptr, false);
+        if (!j.is_discarded())
+        {
+            for (auto &[id, val] : j.items())
+            {
+                try
+                {
+                    sm.emplace(id, val.get<TimestampedStats>());
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+        return sm;
+    }
+
+    template <typename Fn>
+    double time_ns(int iterations, Fn &&fn)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            fn();
+        const auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const std::size_t containers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    const std::string frame = make_frame(containers);
+    std::printf("frame: %zu containers, %zu bytes, %d iterations\n",
+                containers, frame.size(), iterations);
+
+    // sanity: both paths agree
+    StatsDecoder decoder;
+    StatsMap reference = decode_dom(frame);
+    StatsMap streamed;
+    if (!decoder.decode(frame, streamed) || streamed.size() != reference.size())
+    {
+        std::fprintf(stderr, "decoder mismatch: %zu vs %zu entries\n",
+                     streamed.size(), reference.size());
+        return 1;
+    }
+    for (const auto &[id, ts] : reference)
+    {
+        auto it = streamed.find(id);
+        if (it == streamed.end() || it->second.timestamp != ts.timestamp ||
+            it->second.stats.cpu_avg != ts.stats.cpu_avg ||
+            it->second.stats.max_mem != ts.stats.max_mem)
+        {
+            std::fprintf(stderr, "decoder mismatch for %s\n", id.c_str());
+            return 1;
+        }
+    }
+
+    std::size_t sink = 0;
+    const double dom_ns = time_ns(iterations, [&]
+                                  { sink += decode_dom(frame).size(); });
+    const double map_ns = time_ns(iterations, [&]
+                                  {
+                                      StatsMap sm;
+                                      (void)decoder.decode(frame, sm);
+                                      sink += sm.size(); });
+    const double raw_ns = time_ns(iterations, [&]
+                                  { (void)decoder.decode(frame, [&](std::string_view, const TimestampedStats &)
+                                                         { ++sink; }); });
+
+    auto report = [&](const char *name, double ns)
+    {
+        std::printf("%-28s %12.0f ns/frame %8.1f ns/entry %8.1f MB/s\n", name, ns,
+                    ns / static_cast<double>(containers),
+                    static_cast<double>(frame.size()) / ns * 1e3);
+    };
+    report("nlohmann DOM -> StatsMap", dom_ns);
+    report("StatsDecoder -> StatsMap", map_ns);
+    report("StatsDecoder (sink only)", raw_ns);
+    std::printf("speedup (StatsMap): %.2fx\n", dom_ns / map_ns);
+
+    return sink == 0; // keep the optimiser honest
+}
@@ -0,0 +1,352 @@
+// stats_ingest_bench.cpp — end‑to‑end ingest load test against stub servers
+// -----------------------------------------------------------------------------
+// Usage: stats-ingest-bench [--stub ./stats-stub-server] [--endpoints 1]
+//                           [--port 4300] [--uri ws://host:port/stats/ws]...
+//                           [--seconds 30] [--warmup 3] [--ui-hz 30]
+//                           [--threads 1] [--export :9464] [stub options...]
+//
+// Connects a StatsAggregator to --uri endpoints, or with --stub spawns
+// --endpoints stats-stub-server processes on consecutive ports starting at
+// --port and connects to those; every option the harness does not know
+// (--containers, --hz, --churn, --change, --frame-entries, --id-len,
+// --encoding, ...) is passed through to the stubs.  E.g. 10k containers at
+// 10 Hz, all of them changing every tick:
+//
+//   stats-ingest-bench --stub ./stats-stub-server --containers 10000 --hz 10 --change 1
+//
+// The main thread stands in for the UI: --ui-hz times a second it runs the
+// console's own merge, `StatsIngest::pump()` (ledger, history, rollups,
+// expiry, alerts, host totals, sorted view, exporter snapshot), and sorts the
+// view as a drawn frame would.  With --export a StatsExporter listens there,
+// so scrapes during the run are answered from the merge as in the console.
+// After --warmup seconds (initial snapshots,
+// table growth) every counter is reset; then it reports every 5 s and at
+// the end:
+//
+//   frames/s, MiB/s      what the aggregator received
+//   entries/s            containers published to the mailboxes
+//   parse ns/entry       decode time per container (ingest threads)
+//   queue p50/p99        decoded → merged
+//   merge ns/entry, p99  drain + merge per UI tick
+//   view p99             ContainerOrder::rows() per UI tick
+//   allocs               operator new calls off the UI thread (should
+//                        stay at 0 once warm unless containers churn)
+//   peak RSS             of this process (the stubs are separate)
+//
+// The last line repeats the summary as key=value pairs for scripts that
+// compare runs before and after an upgrade.
+
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "latency_histogram.hpp"
+#include "log_service.hpp"
+#include "stats_aggregator.hpp"
+#include "stats_alerts.hpp"
+#include "stats_exporter.hpp"
+#include "stats_ingest.hpp"
+
+extern char **environ;
+
+// Every operator new in the process, and those made by the UI stand‑in (the
+// main thread); the difference is what the ingest threads allocate.
+static std::atomic<uint64_t> gAllocs{0};
+static thread_local uint64_t tAllocs = 0;
+
+void *operator new(std::size_t n)
+{
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    ++tAllocs;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        std::string stub;
+        std::size_t endpoints = 1;
+        unsigned port = 4300;
+        std::vector<std::string> uris;
+        double seconds = 30;
+        double warmup = 3;
+        double ui_hz = 30;
+        std::size_t threads = 1;
+        std::string listen; // exporter, off if empty
+        std::vector<std::string> stub_args;
+    };
+
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t wall_ms()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+    }
+
+    long peak_rss_kib()
+    {
+        rusage ru{};
+        ::getrusage(RUSAGE_SELF, &ru);
+        return ru.ru_maxrss;
+    }
+
+    pid_t spawn_stub(const Options &opt, unsigned port)
+    {
+        std::vector<std::string> args{opt.stub, "--port", std::to_string(port)};
+        args.insert(args.end(), opt.stub_args.begin(), opt.stub_args.end());
+        std::vector<char *> argv;
+        for (auto &a : args)
+            argv.push_back(a.data());
+        argv.push_back(nullptr);
+
+        posix_spawn_file_actions_t fa;
+        posix_spawn_file_actions_init(&fa);
+        posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+        pid_t pid = -1;
+        const int rc = ::posix_spawn(&pid, opt.stub.c_str(), &fa, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&fa);
+        if (rc != 0)
+        {
+            std::fprintf(stderr, "cannot start %s: %s\n", opt.stub.c_str(), std::strerror(rc));
+            return -1;
+        }
+        return pid;
+    }
+
+    // counters that reset after the warm‑up
+    struct Baseline
+    {
+        uint64_t frames{};
+        uint64_t bytes{};
+        uint64_t entries{};
+        uint64_t allocs{}; // off the UI thread
+    };
+
+    Baseline totals(StatsAggregator &agg)
+    {
+        Baseline b;
+        b.allocs = gAllocs.load(std::memory_order_relaxed) - tAllocs;
+        for (std::size_t i = 0; i < agg.size(); ++i)
+        {
+            const auto h = agg.health(i);
+            b.frames += h.frames;
+            b.bytes += h.bytes;
+            b.entries += agg.mailbox(i).metrics().updates;
+        }
+        return b;
+    }
+
+    LatencyHistogram::Snapshot stage(StatsAggregator &agg, StatsLatency::Stage s)
+    {
+        LatencyHistogram::Snapshot all;
+        for (std::size_t i = 0; i < agg.size(); ++i)
+            all.merge(agg.latency(i).stage(s).snapshot());
+        return all;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string_view flag{argv[i]};
+        if (flag == "--stub")
+            opt.stub = argv[i + 1];
+        else if (flag == "--endpoints")
+            opt.endpoints = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        else if (flag == "--port")
+            opt.port = static_cast<unsigned>(std::atoi(argv[i + 1]));
+        else if (flag == "--uri")
+            opt.uris.emplace_back(argv[i + 1]);
+        else if (flag == "--seconds")
+            opt.seconds = std::atof(argv[i + 1]);
+        else if (flag == "--warmup")
+            opt.warmup = std::atof(argv[i + 1]);
+        else if (flag == "--ui-hz")
+            opt.ui_hz = std::max(1.0, std::atof(argv[i + 1]));
+        else if (flag == "--threads")
+            opt.threads = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        else if (flag == "--export")
+            opt.listen = argv[i + 1];
+        else
+        {
+            opt.stub_args.emplace_back(argv[i]);
+            opt.stub_args.emplace_back(argv[i + 1]);
+        }
+    }
+
+    std::vector<pid_t> stubs;
+    if (!opt.stub.empty())
+    {
+        for (std::size_t k = 0; k < opt.endpoints; ++k)
+        {
+            const unsigned port = opt.port + static_cast<unsigned>(k);
+            const pid_t pid = spawn_stub(opt, port);
+            if (pid < 0)
+                return 1;
+            stubs.push_back(pid);
+            opt.uris.push_back("ws://127.0.0.1:" + std::to_string(port) + "/stats/ws");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{500}); // let them listen
+    }
+    if (opt.uris.empty())
+    {
+        std::fprintf(stderr, "nothing to connect to: give --uri or --stub\n");
+        return 2;
+    }
+
+    StatsAggregator::Options aopt;
+    aopt.threads = opt.threads;
+    StatsAggregator agg{opt.uris, aopt};
+    agg.start();
+
+    std::unique_ptr<StatsExporter> exporter;
+    if (!opt.listen.empty())
+        exporter = std::make_unique<StatsExporter>(StatsExporter::Config{opt.listen});
+
+    // what StatsWindow::pumpQueue() runs, with default configs and two rules
+    StatsIngest ingest{&agg, {}, {}, {},
+                       {*StatsAlerts::Rule::parse("cpu_avg > 0.9 for 60s"),
+                        *StatsAlerts::Rule::parse("max_mem > 8GiB")},
+                       exporter.get()};
+    ingest.order().set_key(ContainerOrder::Key::Cpu, true);
+
+    LatencyHistogram mergeNs, viewNs; // per UI tick; recorded in ns, the buckets don't mind
+    uint64_t merged = 0;
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / opt.ui_hz));
+    const auto start = Clock::now();
+    const auto warm = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.warmup));
+    const auto end = warm + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.seconds));
+    bool warmedUp = opt.warmup <= 0;
+    Baseline base{}, lastReport{};
+    auto measured = start, nextReport = start + std::chrono::seconds{5};
+    if (warmedUp)
+        nextReport = warm + std::chrono::seconds{5};
+
+    for (auto next = start; Clock::now() < end;)
+    {
+        next += period;
+        std::this_thread::sleep_until(next);
+
+        if (!warmedUp && Clock::now() >= warm)
+        {
+            warmedUp = true;
+            for (std::size_t i = 0; i < agg.size(); ++i)
+                agg.latency(i).reset();
+            mergeNs.reset();
+            viewNs.reset();
+            merged = 0;
+            base = lastReport = totals(agg);
+            measured = Clock::now();
+            nextReport = measured + std::chrono::seconds{5};
+        }
+
+        const int64_t t0 = now_ns();
+        const std::size_t entries = ingest.pump(wall_ms());
+        ingest.clear_merged(); // nothing is presented
+        const int64_t t1 = now_ns();
+        const auto rows = ingest.order().rows(ingest.ledger()).size();
+        const int64_t t2 = now_ns();
+        (void)rows;
+
+        if (warmedUp)
+        {
+            mergeNs.record(static_cast<uint64_t>(t1 - t0));
+            viewNs.record(static_cast<uint64_t>(t2 - t1));
+            merged += entries;
+        }
+
+        if (warmedUp && Clock::now() >= nextReport)
+        {
+            const auto cur = totals(agg);
+            std::printf("%6.1fs  %8.0f frames/s  %7.2f MiB/s  %9.0f entries/s  %zu containers  merge p99 %.2f ms  ingest allocs %" PRIu64 "\n",
+                        std::chrono::duration<double>(Clock::now() - measured).count(),
+                        static_cast<double>(cur.frames - lastReport.frames) / 5.0,
+                        static_cast<double>(cur.bytes - lastReport.bytes) / 5.0 / (1 << 20),
+                        static_cast<double>(cur.entries - lastReport.entries) / 5.0, ingest.ledger().size(),
+                        static_cast<double>(mergeNs.snapshot().percentile(0.99)) / 1e6,
+                        cur.allocs - lastReport.allocs);
+            std::fflush(stdout);
+            lastReport = cur;
+            nextReport += std::chrono::seconds{5};
+        }
+    }
+
+    const double secs = std::chrono::duration<double>(Clock::now() - measured).count();
+    const auto cur = totals(agg);
+    agg.stop();
+    for (const pid_t pid : stubs)
+    {
+        ::kill(pid, SIGTERM);
+        ::waitpid(pid, nullptr, 0);
+    }
+
+    const uint64_t frames = cur.frames - base.frames;
+    const uint64_t bytes = cur.bytes - base.bytes;
+    const uint64_t entries = cur.entries - base.entries;
+    const uint64_t allocs = cur.allocs - base.allocs;
+    const auto parse = stage(agg, StatsLatency::Parse);
+    const auto queue = stage(agg, StatsLatency::Queue);
+    const auto merge = mergeNs.snapshot();
+    const auto view = viewNs.snapshot();
+
+    const double fps = static_cast<double>(frames) / secs;
+    const double mibps = static_cast<double>(bytes) / secs / (1 << 20);
+    const double eps = static_cast<double>(entries) / secs;
+    const double parseNsEntry = entries ? static_cast<double>(parse.sum) * 1e3 / static_cast<double>(entries) : 0.0;
+    const double mergeNsEntry = merged ? static_cast<double>(merge.sum) / static_cast<double>(merged) : 0.0;
+    const double rssMib = static_cast<double>(peak_rss_kib()) / 1024.0;
+
+    std::printf("\n%zu endpoint(s), %.1f s measured, %zu containers in the ledger\n", agg.size(), secs, ingest.ledger().size());
+    std::printf("  received   %10.0f frames/s  %8.2f MiB/s  %10.0f entries/s\n", fps, mibps, eps);
+    std::printf("  parse      %10.1f ns/entry  p50 %.0f us  p99 %.0f us per frame\n", parseNsEntry,
+                static_cast<double>(parse.percentile(0.5)), static_cast<double>(parse.percentile(0.99)));
+    std::printf("  queue      p50 %.2f ms  p99 %.2f ms\n", static_cast<double>(queue.percentile(0.5)) / 1e3,
+                static_cast<double>(queue.percentile(0.99)) / 1e3);
+    std::printf("  merge      %10.1f ns/entry  p50 %.2f ms  p99 %.2f ms  max %.2f ms per UI tick\n", mergeNsEntry,
+                static_cast<double>(merge.percentile(0.5)) / 1e6, static_cast<double>(merge.percentile(0.99)) / 1e6,
+                static_cast<double>(merge.max) / 1e6);
+    std::printf("  view sort  p50 %.2f ms  p99 %.2f ms per UI tick\n", static_cast<double>(view.percentile(0.5)) / 1e6,
+                static_cast<double>(view.percentile(0.99)) / 1e6);
+    std::printf("  memory     peak RSS %.1f MiB (history %zu KiB, rollup %zu KiB)\n", rssMib, ingest.history().bytes() / 1024,
+                ingest.rollup().bytes() / 1024);
+    std::printf("  allocs     %" PRIu64 " on ingest threads (%.3f per frame)\n", allocs,
+                frames ? static_cast<double>(allocs) / static_cast<double>(frames) : 0.0);
+    std::printf("RESULT frames_per_s=%.0f bytes_per_s=%.0f entries_per_s=%.0f parse_ns_per_entry=%.1f "
+                "merge_ns_per_entry=%.1f merge_p99_us=%.0f queue_p99_us=%" PRIu64 " ingest_allocs=%" PRIu64 " peak_rss_kib=%ld\n",
+                fps, mibps * (1 << 20), eps, parseNsEntry, mergeNsEntry,
+                static_cast<double>(merge.percentile(0.99)) / 1e3, queue.percentile(0.99), allocs, peak_rss_kib());
+    return frames == 0; // nothing arrived: fail loudly in scripts
+}
@@ -0,0 +1,574 @@
+// stats_stub_server.cpp — local stand‑in for the stats WebSocket endpoint
+// -----------------------------------------------------------------------------
+// Usage: stats-stub-server [--port 4000] [--containers 8000] [--hz 1]
+//                          [--encoding auto|json|cbor|msgpack]
+//                          [--change 0.05] [--churn 0] [--full-every 60]
+//                          [--drop 0] [--frame-entries 0] [--id-len 64]
+//
+// Serves synthetic frames in the stats_json.hpp schema to every client that
+// connects to ws://127.0.0.1:<port>/stats/ws.  With --encoding auto the first
+// subprotocol the client offers (rezn.stats.cbor / .msgpack / .json) wins and
+// is echoed back in the handshake; otherwise the given encoding is forced.
+// Prints bytes/s per client every few seconds so encodings can be compared
+// on the wire as well as in stats-codec-bench.
+//
+// Each tick a --change fraction of the fleet gets new samples and --churn
+// containers are replaced by new IDs.  Clients that send
+// {"op":"subscribe","mode":"delta"} get delta frames (changed containers and
+// tombstones only) with a full snapshot every --full-every frames or on
+// request ("resync":true); everyone else gets the whole fleet every tick.
+// --drop skips that fraction of delta frames to exercise gap recovery.
+//
+// --frame-entries N caps a frame at N containers: snapshots and deltas are
+// split into several frames per tick (each delta chunk with its own seq),
+// while full snapshots stay whole since `full` covers the entire fleet.
+// --id-len sets the container ID length (hex, 8..256) to vary entry size.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "stats_binary_decoder.hpp"
+
+namespace
+{
+    struct Options
+    {
+        uint16_t port = 4000;
+        std::size_t containers = 8000;
+        double hz = 1.0;
+        std::string encoding = "auto";
+        double change = 0.05;
+        std::size_t churn = 0;
+        uint64_t full_every = 60;
+        double drop = 0.0;
+        std::size_t frame_entries = 0; // 0 = one frame per tick
+        std::size_t id_len = 64;
+    };
+
+    // ---------------------------------------------------------------------
+    // Minimal RFC 6455 server side
+    // ---------------------------------------------------------------------
+
+    bool send_all(int fd, const void *data, std::size_t len)
+    {
+        const auto *p = static_cast<const char *>(data);
+        while (len)
+        {
+            ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            p += n;
+            len -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    bool send_frame(int fd, uint8_t opcode, const void *data, std::size_t len)
+    {
+        uint8_t hdr[10];
+        std::size_t hlen = 2;
+        hdr[0] = static_cast<uint8_t>(0x80 | opcode); // FIN, server frames unmasked
+        if (len < 126)
+        {
+            hdr[1] = static_cast<uint8_t>(len);
+        }
+        else if (len <= 0xFFFF)
+        {
+            hdr[1] = 126;
+            hdr[2] = static_cast<uint8_t>(len >> 8);
+            hdr[3] = static_cast<uint8_t>(len);
+            hlen = 4;
+        }
+        else
+        {
+            hdr[1] = 127;
+            for (int i = 0; i < 8; ++i)
+                hdr[2 + i] = static_cast<uint8_t>(static_cast<uint64_t>(len) >> (56 - 8 * i));
+            hlen = 10;
+        }
+        return send_all(fd, hdr, hlen) && send_all(fd, data, len);
+    }
+
+    /** Pop one complete client frame (masked, unfragmented) off `rx`. */
+    bool pop_client_frame(std::string &rx, uint8_t &opcode, std::string &payload)
+    {
+        const auto *p = reinterpret_cast<const uint8_t *>(rx.data());
+        if (rx.size() < 2)
+            return false;
+        opcode = p[0] & 0x0F;
+        const bool masked = p[1] & 0x80;
+        uint64_t len = p[1] & 0x7F;
+        std::size_t off = 2;
+        if (len == 126)
+        {
+            if (rx.size() < 4)
+                return false;
+            len = (uint64_t{p[2]} << 8) | p[3];
+            off = 4;
+        }
+        else if (len == 127)
+        {
+            if (rx.size() < 10)
+                return false;
+            len = 0;
+            for (int i = 0; i < 8; ++i)
+                len = (len << 8) | p[2 + i];
+            off = 10;
+        }
+        const std::size_t mask = off;
+        if (masked)
+            off += 4;
+        if (rx.size() - off < len)
+            return false;
+
+        payload.assign(rx, off, len);
+        if (masked)
+            for (std::size_t i = 0; i < payload.size(); ++i)
+                payload[i] = static_cast<char>(payload[i] ^ rx[mask + i % 4]);
+        rx.erase(0, off + len);
+        return true;
+    }
+
+    std::string header_value(std::string_view req, std::string_view name)
+    {
+        std::size_t pos = 0;
+        while ((pos = req.find("\r\n", pos)) != std::string_view::npos)
+        {
+            pos += 2;
+            if (req.size() - pos < name.size() + 1)
+                break;
+            bool match = true;
+            for (std::size_t i = 0; i < name.size() && match; ++i)
+                match = std::tolower(static_cast<unsigned char>(req[pos + i])) ==
+                        std::tolower(static_cast<unsigned char>(name[i]));
+            if (match && req[pos + name.size()] == ':')
+            {
+                std::size_t v = pos + name.size() + 1;
+                std::size_t e = req.find("\r\n", v);
+                while (v < e && req[v] == ' ')
+                    ++v;
+                return std::string{req.substr(v, e - v)};
+            }
+        }
+        return {};
+    }
+
+    std::string accept_key(const std::string &key)
+    {
+        const std::string src = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        unsigned char sha[SHA_DIGEST_LENGTH];
+        SHA1(reinterpret_cast<const unsigned char *>(src.data()), src.size(), sha);
+        unsigned char b64[4 * ((SHA_DIGEST_LENGTH + 2) / 3) + 1];
+        EVP_EncodeBlock(b64, sha, SHA_DIGEST_LENGTH);
+        return reinterpret_cast<char *>(b64);
+    }
+
+    StatsEncoding choose_encoding(const Options &opt, const std::string &offered)
+    {
+        if (opt.encoding == "json")
+            return StatsEncoding::Json;
+        if (opt.encoding == "cbor")
+            return StatsEncoding::Cbor;
+        if (opt.encoding == "msgpack")
+            return StatsEncoding::MsgPack;
+
+        // auto: first offered protocol we know
+        std::size_t pos = 0;
+        while (pos < offered.size())
+        {
+            std::size_t end = offered.find(',', pos);
+            if (end == std::string::npos)
+                end = offered.size();
+            std::string_view tok{offered.data() + pos, end - pos};
+            while (!tok.empty() && tok.front() == ' ')
+                tok.remove_prefix(1);
+            for (auto enc : {StatsEncoding::Cbor, StatsEncoding::MsgPack, StatsEncoding::Json})
+                if (tok == stats_subprotocol(enc))
+                    return enc;
+            pos = end + 1;
+        }
+        return StatsEncoding::Json;
+    }
+
+    // ---------------------------------------------------------------------
+    // Synthetic fleet
+    // ---------------------------------------------------------------------
+
+    struct Fleet
+    {
+        struct Container
+        {
+            std::string id;
+            double cpu{};
+            uint64_t mem{};
+            uint64_t ts{};
+        };
+
+        Fleet(std::size_t n, std::size_t id_len)
+            : rng{std::random_device{}()}, containers(n), dirty(n, 0), id_len_{std::clamp<std::size_t>(id_len, 8, 256)}
+        {
+            const uint64_t now = now_ms();
+            for (auto &c : containers)
+            {
+                c.id = make_id_();
+                sample_(c, now);
+            }
+        }
+
+        static uint64_t now_ms()
+        {
+            return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count());
+        }
+
+        /** Advance one tick; changes accumulate until `clear_changes()`. */
+        void tick(double change, std::size_t churn)
+        {
+            if (containers.empty())
+                return;
+            const uint64_t now = now_ms();
+            std::uniform_int_distribution<std::size_t> pick{0, containers.size() - 1};
+
+            const auto n = static_cast<std::size_t>(change * static_cast<double>(containers.size()) + 0.5);
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                const std::size_t i = pick(rng);
+                sample_(containers[i], now);
+                mark_(i);
+            }
+            for (std::size_t k = 0; k < churn; ++k)
+            {
+                const std::size_t i = pick(rng);
+                removed.push_back(std::move(containers[i].id));
+                containers[i].id = make_id_();
+                sample_(containers[i], now);
+                mark_(i);
+            }
+        }
+
+        /** Plain snapshot frame: containers [from, to). */
+        nlohmann::json snapshot(std::size_t from = 0, std::size_t to = SIZE_MAX) const
+        {
+            nlohmann::json j = nlohmann::json::object();
+            for (std::size_t i = from; i < std::min(to, containers.size()); ++i)
+                j[containers[i].id] = entry_(containers[i]);
+            return j;
+        }
+
+        nlohmann::json full(uint64_t seq) const
+        {
+            return {{"seq", seq}, {"full", true}, {"upserts", snapshot()}};
+        }
+
+        /** Delta of changed[from, to); removals ride with the first chunk. */
+        nlohmann::json delta(uint64_t seq, std::size_t from = 0, std::size_t to = SIZE_MAX) const
+        {
+            nlohmann::json up = nlohmann::json::object();
+            for (std::size_t k = from; k < std::min(to, changed.size()); ++k)
+                up[containers[changed[k]].id] = entry_(containers[changed[k]]);
+            return {{"seq", seq},
+                    {"full", false},
+                    {"upserts", std::move(up)},
+                    {"removed", from == 0 ? nlohmann::json(removed) : nlohmann::json::array()}};
+        }
+
+        void clear_changes()
+        {
+            for (std::size_t i : changed)
+                dirty[i] = 0;
+            changed.clear();
+            removed.clear();
+        }
+
+        std::mt19937_64 rng;
+        std::vector<Container> containers;
+        std::vector<std::size_t> changed; // indices touched since clear_changes()
+        std::vector<uint8_t> dirty;
+        std::vector<std::string> removed; // IDs retired since clear_changes()
+
+    private:
+        // random hex, ending in a serial so IDs never repeat
+        std::string make_id_()
+        {
+            static constexpr char kHex[] = "0123456789abcdef";
+            std::string id(id_len_, '0');
+            for (std::size_t i = 0; i + 16 < id_len_; ++i)
+                id[i] = kHex[rng() & 15];
+            const uint64_t serial = serial_++;
+            for (std::size_t i = 0; i < std::min<std::size_t>(16, id_len_); ++i)
+                id[id_len_ - 1 - i] = kHex[(serial >> (4 * i)) & 15];
+            return id;
+        }
+
+        void sample_(Container &c, uint64_t now)
+        {
+            std::uniform_real_distribution<double> cpu{0.0, 2.0};
+            std::uniform_int_distribution<uint64_t> mem{16ull << 20, 4ull << 30};
+            c.cpu = cpu(rng);
+            c.mem = mem(rng);
+            c.ts = now;
+        }
+
+        void mark_(std::size_t i)
+        {
+            if (!dirty[i])
+            {
+                dirty[i] = 1;
+                changed.push_back(i);
+            }
+        }
+
+        static nlohmann::json entry_(const Container &c)
+        {
+            return {{"stats", {{"cpu_avg", c.cpu}, {"max_mem", c.mem}}}, {"timestamp", c.ts}};
+        }
+
+        std::size_t id_len_;
+        uint64_t serial_{};
+    };
+
+    bool send_json(int fd, StatsEncoding enc, const nlohmann::json &j, uint64_t &bytes)
+    {
+        if (enc == StatsEncoding::Json)
+        {
+            const std::string s = j.dump();
+            bytes += s.size();
+            return send_frame(fd, 0x1, s.data(), s.size());
+        }
+        const auto v = enc == StatsEncoding::Cbor ? nlohmann::json::to_cbor(j)
+                                                  : nlohmann::json::to_msgpack(j);
+        bytes += v.size();
+        return send_frame(fd, 0x2, v.data(), v.size());
+    }
+
+    void serve_client(int fd, Options opt)
+    {
+        // --- handshake ----------------------------------------------------
+        std::string req;
+        char buf[4096];
+        while (req.find("\r\n\r\n") == std::string::npos)
+        {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0 || req.size() > 16 * 1024)
+            {
+                ::close(fd);
+                return;
+            }
+            req.append(buf, static_cast<std::size_t>(n));
+        }
+
+        const std::string key = header_value(req, "Sec-WebSocket-Key");
+        const std::string offered = header_value(req, "Sec-WebSocket-Protocol");
+        const StatsEncoding enc = choose_encoding(opt, offered);
+
+        std::string resp = "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: " +
+                           accept_key(key) + "\r\n";
+        if (!offered.empty())
+            resp += "Sec-WebSocket-Protocol: " + std::string{stats_subprotocol(enc)} + "\r\n";
+        resp += "\r\n";
+        if (!send_all(fd, resp.data(), resp.size()))
+        {
+            ::close(fd);
+            return;
+        }
+        std::printf("client %d: encoding %s\n", fd, std::string{stats_subprotocol(enc)}.c_str());
+
+        // anything the client sent after its handshake request
+        std::string rx = req.substr(req.find("\r\n\r\n") + 4);
+        std::string msg;
+        uint8_t opcode = 0;
+
+        // --- stream -------------------------------------------------------
+        Fleet fleet{opt.containers, opt.id_len};
+        const std::size_t chunk = opt.frame_entries ? opt.frame_entries : SIZE_MAX;
+        std::bernoulli_distribution drop{std::clamp(opt.drop, 0.0, 1.0)};
+        bool delta = false, want_full = false;
+        uint64_t seq = 0, since_full = 0;
+
+        const auto period = std::chrono::duration<double>(1.0 / opt.hz);
+        auto next = std::chrono::steady_clock::now();
+        auto report = next + std::chrono::seconds(5);
+        uint64_t bytes = 0, frames = 0;
+        bool open = true;
+
+        while (open)
+        {
+            // --- client control messages ----------------------------------
+            while (pop_client_frame(rx, opcode, msg))
+            {
+                if (opcode == 0x8)
+                {
+                    open = false;
+                    break;
+                }
+                if (opcode != 0x1)
+                    continue;
+                const auto j = nlohmann::json::parse(msg, nullptr, false);
+                if (j.is_object() && j.value("op", "") == "subscribe")
+                {
+                    const bool resync = j.value("resync", false);
+                    delta = j.value("mode", "") == "delta";
+                    want_full = true;
+                    std::printf("client %d: %s (%s)\n", fd, resync ? "resubscribed" : "subscribed",
+                                delta ? "delta" : "snapshots");
+                }
+            }
+            if (!open)
+                break;
+
+            // --- one tick -------------------------------------------------
+            fleet.tick(opt.change, opt.churn);
+            bool ok = true;
+            if (!delta)
+            {
+                for (std::size_t from = 0; ok && from < std::max<std::size_t>(fleet.containers.size(), 1);
+                     from += chunk)
+                {
+                    ok = send_json(fd, enc, fleet.snapshot(from, from + chunk), bytes);
+                    ++frames;
+                    if (chunk == SIZE_MAX)
+                        break;
+                }
+            }
+            else if (want_full || ++since_full >= opt.full_every)
+            {
+                ok = send_json(fd, enc, fleet.full(++seq), bytes);
+                want_full = false;
+                since_full = 0;
+                ++frames;
+            }
+            else if (drop(fleet.rng))
+            {
+                ++seq; // lost on the way: the client sees a gap
+            }
+            else
+            {
+                for (std::size_t from = 0; ok; from += chunk)
+                {
+                    ok = send_json(fd, enc, fleet.delta(++seq, from, from + chunk), bytes);
+                    ++frames;
+                    if (chunk == SIZE_MAX || from + chunk >= fleet.changed.size())
+                        break;
+                }
+            }
+            fleet.clear_changes();
+            if (!ok)
+                break;
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= report)
+            {
+                std::printf("client %d: %.0f frames/s, %.1f KiB/s\n", fd, frames / 5.0,
+                            bytes / 5.0 / 1024.0);
+                frames = bytes = 0;
+                report = now + std::chrono::seconds(5);
+            }
+
+            // wait for the next tick; EOF ends the session
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                next - std::chrono::steady_clock::now());
+            pollfd pfd{fd, POLLIN, 0};
+            if (::poll(&pfd, 1, std::max<int>(0, static_cast<int>(wait.count()))) > 0)
+            {
+                ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0)
+                    break;
+                rx.append(buf, static_cast<std::size_t>(n));
+            }
+        }
+
+        std::printf("client %d: disconnected\n", fd);
+        ::close(fd);
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string_view flag{argv[i]};
+        if (flag == "--port")
+            opt.port = static_cast<uint16_t>(std::atoi(argv[i + 1]));
+        else if (flag == "--containers")
+            opt.containers = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--hz")
+            opt.hz = std::atof(argv[i + 1]);
+        else if (flag == "--encoding")
+            opt.encoding = argv[i + 1];
+        else if (flag == "--change")
+            opt.change = std::atof(argv[i + 1]);
+        else if (flag == "--churn")
+            opt.churn = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--full-every")
+            opt.full_every = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--drop")
+            opt.drop = std::atof(argv[i + 1]);
+        else if (flag == "--frame-entries")
+            opt.frame_entries = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--id-len")
+            opt.id_len = std::strtoull(argv[i + 1], nullptr, 10);
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (opt.hz <= 0)
+        opt.hz = 1.0;
+
+    int srv = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    ::setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(srv, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        ::listen(srv, 64) != 0)
+    {
+        std::perror("bind/listen");
+        return 1;
+    }
+
+    std::printf("stats stub: ws://127.0.0.1:%u/stats/ws, %zu containers @ %.1f Hz, encoding %s\n",
+                opt.port, opt.containers, opt.hz, opt.encoding.c_str());
+
+    while (true)
+    {
+        int fd = ::accept(srv, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::thread{serve_client, fd, opt}.detach();
+    }
+}
@@ -1,20 +1,98 @@
 #ifndef CP_LEDGR_API_CLIENT_HPP
 #define CP_LEDGR_API_CLIENT_HPP
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <string>
 #include <vector>
 #include "host_descriptor.hpp"
+#include "host_list_parser.hpp"
 #include "client.hpp"
 
+/**
+ * LedgerApiClient
+ * ---------------
+ * Typed calls on the ledger daemon.
+ *
+ * Host sync is revision‑aware.  A daemon that versions its ledger puts a
+ * `revision` on the `list` reply and answers
+ *
+ *   {"op":"changes","since":N[,"wait_ms":W]}
+ *     → {"status":"ok","revision":M,"added":[…],"changed":[…],"removed":["id",…]}
+ *
+ * with what happened after revision N.  With `wait_ms` the daemon holds the
+ * reply until something changes or W elapses (then the lists are empty and
+ * M = N), which keeps a cache current at the cost of one idle request.  A
+ * reply other than "ok" (typically `"code":"revision_expired"` once N has
+ * left the daemon's change log) means the client must refetch the full list.
+ * Daemons without revisions keep working through full lists.
+ *
+ * Full lists are streamed: the reply is parsed by `HostListParser` as curl
+ * receives it, so only the resulting descriptors are ever held in full.
+ */
 class LedgerApiClient
 {
 public:
+    /** What brings a cache at some revision up to `revision`. */
+    struct HostChanges
+    {
+        uint64_t revision{}; //!< 0 = the daemon does not version its ledger
+        bool full{};         //!< `upserts` is the whole list: replace the cache
+        bool resync{};       //!< `since` was refused: fetch the full list instead
+        std::vector<ledgr::HostDescriptor> upserts; //!< added or changed, by id
+        std::vector<std::string> removed;           //!< ids
+    };
+    using ChangesResult = std::expected<HostChanges, std::string>;
+
     LedgerApiClient(const std::string &socket_path);
 
     std::vector<ledgr::HostDescriptor> list_hosts();
+
+    /**
+     * Stream the full list to `chunk`, `chunk_size` hosts at a time (called on
+     * the client thread while the reply arrives).  Returns the ledger
+     * revision, 0 if the daemon reports none; throws like `list_hosts()`.
+     */
+    uint64_t list_hosts(const HostListParser::Chunk &chunk, std::size_t chunk_size = 1024);
+
+    /**
+     * Changes since `revision`, or the full list when `revision` is 0 or
+     * refused by the daemon.  Blocking; throws what `list_hosts()` throws.
+     */
+    HostChanges sync_hosts(uint64_t revision);
+
+    /**
+     * Long‑poll for changes since `revision` (non‑zero), waiting up to `wait`
+     * on the daemon.  `done` runs on the client thread; a refused revision
+     * arrives as `resync`.
+     */
+    void watch_hosts(uint64_t revision, std::chrono::milliseconds wait,
+                     std::function<void(ChangesResult)> done);
+
     bool add_host(const ledgr::HostDescriptor &host, std::string *error = nullptr);
+
+    using AddResult = std::expected<void, std::string>;
+    /** Called per host as its create completes, in input order; false stops
+     *  further submissions (those hosts read "cancelled"). */
+    using AddProgress = std::function<bool(std::size_t index, const AddResult &result)>;
+
+    /**
+     * Create many hosts, pipelined: up to `window` create requests are queued
+     * at a time (the client's connection limit bounds what is on the wire).
+     * One result per host, in input order; a failed transport or a daemon
+     * refusal is that host's error.
+     */
+    std::vector<AddResult> add_hosts(const std::vector<ledgr::HostDescriptor> &hosts,
+                                     const AddProgress &progress = {}, std::size_t window = 64);
     // Add more methods as needed
 
 private:
+    uint64_t stream_list_(std::vector<ledgr::HostDescriptor> &out, const HostListParser::Chunk &chunk,
+                          std::size_t chunk_size);
+
     LedgerClient client;
 };
 
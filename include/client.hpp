@@ -3,36 +3,131 @@
 
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstddef>
+#include <expected>
+#include <functional>
+#include <future>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+/**
+ * LedgerClient
+ * ------------
+ * JSON‑over‑HTTP client for the ledger daemon's Unix socket, driven by one
+ * `curl_multi` event loop on its own thread.
+ *
+ *   - `send_async()` queues a request and returns at once; the reply arrives
+ *     through a `std::future` or a callback (called on the client thread —
+ *     keep it short and hand work elsewhere).
+ *   - Up to `max_connections` requests are on the wire at a time, each on a
+ *     kept‑alive connection; more wait inside curl.
+ *   - Easy handles are pooled with their invariant options (socket, URL,
+ *     headers) set once; a request only sets its body, sink and timeout.
+ *
+ * `send_request()` is the blocking form, with the exceptions it always threw:
+ * libcurl errors, non‑200 replies and unparsable JSON.
+ *
+ * `send_streaming()` skips the buffer and the DOM for replies too large to
+ * hold twice: the body goes to a sink piece by piece as curl receives it.
+ */
 class LedgerClient
 {
 public:
+    /** Parsed reply, or why there is none. */
+    using Result = std::expected<nlohmann::json, std::string>;
+    using Callback = std::function<void(Result)>;
+    /** Receives a reply body piece by piece; false aborts the transfer. */
+    using BodySink = std::function<bool(std::string_view)>;
+
     explicit LedgerClient(const std::string &socket_path,
-                          std::chrono::seconds timeout = std::chrono::seconds{5});
+                          std::chrono::seconds timeout = std::chrono::seconds{5},
+                          std::size_t max_connections = 8);
     ~LedgerClient();
 
+    LedgerClient(const LedgerClient &) = delete;
+    LedgerClient &operator=(const LedgerClient &) = delete;
+
+    /** Blocking round trip; throws `std::runtime_error` on any failure. */
     nlohmann::json send_request(const nlohmann::json &req);
 
+    /** Queue a request; the future throws what `send_request()` would. */
+    std::future<nlohmann::json> send_async(const nlohmann::json &req);
+
+    /**
+     * Queue a request; `done` runs on the client thread.  A non‑zero
+     * `timeout` replaces the client's own for this request (long polls).
+     */
+    void send_async(const nlohmann::json &req, Callback done,
+                    std::chrono::milliseconds timeout = std::chrono::milliseconds{0});
+
+    /**
+     * Queue a request whose 200 reply body is handed to `sink` as it arrives
+     * instead of being buffered and parsed (both run on the client thread);
+     * `done` then gets an empty JSON value, or the error.  Bodies of other
+     * statuses are still collected for the error message.
+     */
+    void send_streaming(const nlohmann::json &req, BodySink sink, Callback done);
+
+    /** Requests queued or on the wire. */
+    [[nodiscard]] std::size_t in_flight() const noexcept { return in_flight_.load(std::memory_order_relaxed); }
+
 private:
-    struct CurlDeleter
+    struct Request
     {
-        void operator()(CURL *c) const
+        std::string body; // JSON payload (must stay alive during the transfer)
+        std::string resp; // collects the response (or an error body when streaming)
+        long timeout_ms;
+        BodySink sink;    // streaming: gets a 200 body instead of `resp`
+        bool aborted{};   // the sink refused more
+        CURL *easy{};
+        Callback done;
+    };
+
+    struct CurlMultiDeleter
+    {
+        void operator()(CURLM *m) const
         {
-            if (c)
-                curl_easy_cleanup(c);
+            if (m)
+                curl_multi_cleanup(m);
         }
     };
 
-    std::unique_ptr<CURL, CurlDeleter> curl_;
+    static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userdata);
+    static Result finish_(CURL *easy, CURLcode rc, Request &r);
+
+    void submit_(std::unique_ptr<Request> r);
+    CURL *acquire_();
+    void release_(CURL *easy);
+    void apply_invariants(CURL *easy);
+    void run_();
+    void start_queued_();
+    void reap_();
+    void fail_all_(const std::string &why);
+
+    std::unique_ptr<CURLM, CurlMultiDeleter> multi_;
     std::string socket_path_;
-    long timeout_sec_;
+    long timeout_ms_; // default per‑request timeout
+    struct curl_slist *hdrs_{nullptr}; // shared by every request
 
-    static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userdata);
-    void apply_invariants();
+    std::mutex mtx_;
+    std::vector<std::unique_ptr<Request>> queue_; // submitted, not yet started
+    std::atomic<std::size_t> in_flight_{0};
+    std::atomic<bool> stopping_{false};
+
+    // client thread only
+    std::vector<std::unique_ptr<Request>> starting_;
+    std::unordered_map<CURL *, std::unique_ptr<Request>> active_;
+    std::vector<CURL *> idle_; // pooled easy handles
+
+    std::thread thread_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,168 @@
+// container_order.hpp — incrementally maintained sort order over a ContainerTable
+// -----------------------------------------------------------------------------
+#ifndef CP_CONTAINER_ORDER_HPP
+#define CP_CONTAINER_ORDER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "container_table.hpp"
+#include "stats_model.hpp"
+
+/**
+ * ContainerOrder
+ * --------------
+ * Keeps the table's live slots ordered by one key (ID, source, CPU, memory
+ * or age) without re‑sorting the whole ledger every frame.
+ *
+ *   - Ingest only *marks* slots whose value changed (`touch()`), O(1) each.
+ *   - `rows()` applies the marks lazily, once per frame at most:
+ *       · few changes → the touched slots are pulled out, sorted among
+ *         themselves and merged back: O(n + k log k);
+ *       · many changes (a full‑fleet snapshot) or a new sort key → one full
+ *         sort, O(n log n).
+ *
+ * Between frames with no updates `rows()` is free, so a sorted view at 10k+
+ * containers costs one linear merge per ingest batch.
+ */
+class ContainerOrder
+{
+public:
+    using Slot = ContainerTable::Slot;
+
+    enum class Key
+    {
+        Id,
+        Source,
+        Cpu,
+        Mem,
+        Age
+    };
+
+    /** Change the sort key; triggers one full sort on the next `rows()`. */
+    void set_key(Key key, bool descending) noexcept
+    {
+        if (key == key_ && descending == descending_)
+            return;
+        key_ = key;
+        descending_ = descending;
+        full_ = true;
+    }
+
+    [[nodiscard]] Key key() const noexcept { return key_; }
+    [[nodiscard]] bool descending() const noexcept { return descending_; }
+
+    /** Mark a slot inserted, updated or erased since the last `rows()`. */
+    void touch(Slot slot)
+    {
+        if (slot >= touched_.size())
+            touched_.resize(slot + 1, 0);
+        if (!touched_[slot])
+        {
+            touched_[slot] = 1;
+            pending_.push_back(slot);
+        }
+    }
+
+    /** Live slots of `table` in sort order. */
+    const std::vector<Slot> &rows(const ContainerTable &table)
+    {
+        if (full_ || pending_.size() * 4 > order_.size())
+            resort_(table);
+        else if (!pending_.empty())
+            merge_(table);
+        return order_;
+    }
+
+private:
+    bool less_(const ContainerTable &t, Slot a, Slot b) const
+    {
+        const auto &sa = t.stats(a);
+        const auto &sb = t.stats(b);
+        int c = 0;
+        switch (key_)
+        {
+        case Key::Id:
+            c = t.id(a).compare(t.id(b));
+            if (c == 0)
+                c = cmp_(t.source(a), t.source(b));
+            break;
+        case Key::Source:
+            c = cmp_(t.source(a), t.source(b));
+            if (c == 0)
+                c = t.id(a).compare(t.id(b));
+            break;
+        case Key::Cpu:
+            c = cmp_(sa.stats.cpu_avg.value_or(0.0), sb.stats.cpu_avg.value_or(0.0));
+            break;
+        case Key::Mem:
+            c = cmp_(sa.stats.max_mem.value_or(0), sb.stats.max_mem.value_or(0));
+            break;
+        case Key::Age: // older sample == larger age; raw stamps mix units
+            c = cmp_(stats_timestamp_ms(sb.timestamp), stats_timestamp_ms(sa.timestamp));
+            break;
+        }
+        if (descending_)
+            c = -c;
+        return c != 0 ? c < 0 : a < b; // slot as a deterministic tie‑break
+    }
+
+    template <typename T>
+    static int cmp_(const T &a, const T &b) noexcept
+    {
+        return (a > b) - (a < b);
+    }
+
+    void clear_marks_()
+    {
+        for (Slot s : pending_)
+            touched_[s] = 0;
+        pending_.clear();
+    }
+
+    void resort_(const ContainerTable &table)
+    {
+        order_.assign(table.rows().begin(), table.rows().end());
+        std::sort(order_.begin(), order_.end(), [&](Slot a, Slot b)
+                  { return less_(table, a, b); });
+        clear_marks_();
+        full_ = false;
+    }
+
+    void merge_(const ContainerTable &table)
+    {
+        // 1. drop touched (and erased) slots from the ordered list
+        std::erase_if(order_, [&](Slot s)
+                      { return s < touched_.size() && touched_[s]; });
+
+        // 2. sort the live touched slots among themselves
+        std::erase_if(pending_, [&](Slot s)
+                      {
+                          if (table.live(s))
+                              return false;
+                          touched_[s] = 0; // erased: nothing to merge back
+                          return true; });
+        auto cmp = [&](Slot a, Slot b)
+        { return less_(table, a, b); };
+        std::sort(pending_.begin(), pending_.end(), cmp);
+
+        // 3. linear merge into the scratch buffer, then swap
+        scratch_.resize(order_.size() + pending_.size());
+        std::merge(order_.begin(), order_.end(), pending_.begin(), pending_.end(),
+                   scratch_.begin(), cmp);
+        order_.swap(scratch_);
+        clear_marks_();
+    }
+
+    Key key_{Key::Id};
+    bool descending_{false};
+    bool full_{true};
+
+    std::vector<Slot> order_;      // live slots, sorted
+    std::vector<Slot> scratch_;    // merge target, reused
+    std::vector<Slot> pending_;    // touched since last rows()
+    std::vector<uint8_t> touched_; // slot → in pending_
+};
+
+#endif
@@ -0,0 +1,147 @@
+// container_table.hpp — dense, slot‑indexed ledger of container stats
+// -----------------------------------------------------------------------------
+#ifndef CP_CONTAINER_TABLE_HPP
+#define CP_CONTAINER_TABLE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "stats_model.hpp"
+#include "string_utils.hpp"
+
+/**
+ * ContainerTable
+ * --------------
+ * Flat replacement for `std::map<std::string, TimestampedStats>`:
+ *
+ *   - a hash index maps each container ID to a *slot*, a small integer that
+ *     stays stable for as long as the container is in the table;
+ *   - per‑slot values live in contiguous arrays indexed by slot, so other
+ *     per‑container structures (history, sort order, …) can use the same
+ *     index instead of another string lookup;
+ *   - `rows()` is a dense list of live slots, which is what the UI iterates
+ *     (and clips) — no tree walk, no pointer chasing.
+ *
+ * Rows are keyed by (source, container ID): the same container ID reported by
+ * two stats endpoints is two rows.  The index key is the 4‑byte source number
+ * followed by the ID, built in a reused scratch string, so lookups do not
+ * allocate.
+ *
+ * Erased slots go on a free list and are handed out again by later inserts,
+ * so the arrays never grow beyond the peak container count.
+ */
+class ContainerTable
+{
+public:
+    using Slot = uint32_t;
+    using Source = uint32_t; //!< index of the stats endpoint
+    static constexpr Slot npos = ~Slot{0};
+
+    /** Insert or overwrite; returns the slot and whether it was newly taken. */
+    std::pair<Slot, bool> upsert(Source source, std::string_view id, const TimestampedStats &ts)
+    {
+        const std::string_view key = key_(source, id);
+        if (auto it = index_.find(key); it != index_.end())
+        {
+            stats_[it->second] = ts;
+            return {it->second, false};
+        }
+
+        Slot slot;
+        if (!free_.empty())
+        {
+            slot = free_.back();
+            free_.pop_back();
+        }
+        else
+        {
+            slot = static_cast<Slot>(stats_.size());
+            ids_.push_back(nullptr);
+            sources_.push_back(0);
+            stats_.emplace_back();
+            rowPos_.push_back(0);
+        }
+
+        auto it = index_.emplace(std::string{key}, slot).first;
+        ids_[slot] = &it->first; // node keys are stable across rehashing
+        sources_[slot] = source;
+        stats_[slot] = ts;
+        rowPos_[slot] = static_cast<uint32_t>(rows_.size());
+        rows_.push_back(slot);
+        return {slot, true};
+    }
+
+    [[nodiscard]] Slot find(Source source, std::string_view id)
+    {
+        auto it = index_.find(key_(source, id));
+        return it == index_.end() ? npos : it->second;
+    }
+
+    /** Remove a live slot; the slot number may be reused by a later insert. */
+    void erase(Slot slot)
+    {
+        if (!live(slot))
+            return;
+
+        // swap‑remove from the dense row list
+        const uint32_t pos = rowPos_[slot];
+        const Slot last = rows_.back();
+        rows_[pos] = last;
+        rowPos_[last] = pos;
+        rows_.pop_back();
+
+        index_.erase(index_.find(std::string_view{*ids_[slot]}));
+        ids_[slot] = nullptr;
+        free_.push_back(slot);
+    }
+
+    [[nodiscard]] bool live(Slot slot) const noexcept
+    {
+        return slot < ids_.size() && ids_[slot] != nullptr;
+    }
+
+    [[nodiscard]] std::string_view id(Slot slot) const noexcept
+    {
+        return std::string_view{*ids_[slot]}.substr(sizeof(Source));
+    }
+    [[nodiscard]] Source source(Slot slot) const noexcept { return sources_[slot]; }
+    [[nodiscard]] const TimestampedStats &stats(Slot slot) const noexcept { return stats_[slot]; }
+
+    /** Live slots, densely packed (order is insertion order modulo erases). */
+    [[nodiscard]] const std::vector<Slot> &rows() const noexcept { return rows_; }
+
+    [[nodiscard]] std::size_t size() const noexcept { return rows_.size(); }
+
+    /** One past the highest slot ever handed out — size for slot‑indexed arrays. */
+    [[nodiscard]] std::size_t slot_count() const noexcept { return stats_.size(); }
+
+private:
+    std::string_view key_(Source source, std::string_view id)
+    {
+        key_scratch_.resize(sizeof(Source));
+        std::memcpy(key_scratch_.data(), &source, sizeof(Source));
+        key_scratch_.append(id);
+        return key_scratch_;
+    }
+
+    std::unordered_map<std::string, Slot, util::string_hash, std::equal_to<>> index_;
+
+    // slot‑indexed columns
+    std::vector<const std::string *> ids_; // → key in index_, nullptr if free
+    std::vector<Source> sources_;
+    std::vector<TimestampedStats> stats_;
+    std::vector<uint32_t> rowPos_; // position of the slot in rows_
+
+    std::vector<Slot> rows_; // live slots
+    std::vector<Slot> free_; // erased slots, reused LIFO
+
+    std::string key_scratch_; // source + ID of the current lookup
+};
+
+#endif
@@ -0,0 +1,133 @@
+// dns_cache.hpp — small thread‑safe getaddrinfo() cache with TTL
+// -----------------------------------------------------------------------------
+#ifndef CP_DNS_CACHE_HPP
+#define CP_DNS_CACHE_HPP
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <cstring>
+#include <expected>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * DnsCache
+ * --------
+ * Remembers the addresses of (host, port) pairs for `Config::ttl`, and
+ * failures for `Config::negative_ttl`, so reconnect storms do not turn into
+ * resolver storms.  getaddrinfo() does not report record TTLs, hence one
+ * configured TTL for every name.  Callers that fail to connect to a cached
+ * address `invalidate()` it, so a moved service is picked up on the next
+ * attempt instead of after the TTL.
+ *
+ * Resolution runs outside the lock; two threads missing the same name at
+ * once both resolve it and the later result wins.
+ */
+class DnsCache
+{
+public:
+    struct Config
+    {
+        std::chrono::seconds ttl{60};
+        std::chrono::seconds negative_ttl{5};
+    };
+
+    struct Address
+    {
+        sockaddr_storage addr{};
+        socklen_t len{};
+        int family{};
+    };
+
+    struct Result
+    {
+        std::vector<Address> addresses;
+        bool cached{false}; //!< served without calling getaddrinfo()
+    };
+
+    DnsCache() : DnsCache(Config{}) {}
+    explicit DnsCache(Config cfg) : cfg_{cfg} {}
+
+    std::expected<Result, std::string> resolve(const std::string &host, const std::string &port)
+    {
+        const auto now = Clock::now();
+        const std::string key = key_(host, port);
+        {
+            std::lock_guard lock{mtx_};
+            if (auto it = cache_.find(key); it != cache_.end() && it->second.expires > now)
+            {
+                if (!it->second.error.empty())
+                    return std::unexpected(it->second.error);
+                return Result{it->second.addresses, true};
+            }
+        }
+
+        Entry e;
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *res = nullptr;
+        if (int rc = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &res); rc != 0)
+        {
+            e.error = std::string{"resolve: "} + ::gai_strerror(rc);
+            e.expires = now + cfg_.negative_ttl;
+        }
+        else
+        {
+            for (auto *ai = res; ai; ai = ai->ai_next)
+            {
+                Address a;
+                std::memcpy(&a.addr, ai->ai_addr, ai->ai_addrlen);
+                a.len = static_cast<socklen_t>(ai->ai_addrlen);
+                a.family = ai->ai_family;
+                e.addresses.push_back(a);
+            }
+            ::freeaddrinfo(res);
+            e.expires = now + cfg_.ttl;
+        }
+
+        std::lock_guard lock{mtx_};
+        auto &slot = cache_[key];
+        slot = std::move(e);
+        if (!slot.error.empty())
+            return std::unexpected(slot.error);
+        return Result{slot.addresses, false};
+    }
+
+    /** Forget (host, port), e.g. after connecting to its address failed. */
+    void invalidate(const std::string &host, const std::string &port)
+    {
+        std::lock_guard lock{mtx_};
+        cache_.erase(key_(host, port));
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        std::vector<Address> addresses;
+        std::string error;
+        Clock::time_point expires{};
+    };
+
+    // "host\0port"; one small string per lookup is noise next to connect()
+    static std::string key_(const std::string &host, const std::string &port)
+    {
+        std::string key;
+        key.reserve(host.size() + port.size() + 1);
+        key.append(host).push_back('\0');
+        key.append(port);
+        return key;
+    }
+
+    Config cfg_;
+    std::mutex mtx_;
+    std::unordered_map<std::string, Entry> cache_;
+};
+
+#endif
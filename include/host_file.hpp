@@ -0,0 +1,309 @@
+// host_file.hpp — host lists from / to CSV and JSON files (bulk import, export)
+// -----------------------------------------------------------------------------
+#ifndef CP_HOST_FILE_HPP
+#define CP_HOST_FILE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <expected>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "host_descriptor.hpp"
+#include "string_utils.hpp"
+
+/**
+ * HostFile
+ * --------
+ * Reads and writes host lists for onboarding and backup.  The format follows
+ * the file extension: `.csv` is CSV, anything else JSON.
+ *
+ *   - CSV: RFC 4180 (quoted fields may hold commas, quotes and newlines).  A
+ *     first row naming the columns (`id`, `name`, `host`, any order, other
+ *     columns ignored) is used as the header; without one the columns are
+ *     id, name, host.
+ *   - JSON: an array of `{"id","name","host"}` objects, or the daemon's list
+ *     reply (`{"entries":[…]}`).
+ *
+ * `read()` separates file‑level failures (unreadable, not JSON) from row
+ * errors — a row without an id or host, a wrong shape, an id repeated within
+ * the file — which are reported with their line (CSV) or element number
+ * (JSON) while the good rows are kept.  `write()` streams row by row to a
+ * temporary file renamed into place, so a failed export leaves no half file.
+ */
+class HostFile
+{
+public:
+    struct Row
+    {
+        std::size_t line; //!< 1‑based line (CSV) or element (JSON)
+        ledgr::HostDescriptor host;
+    };
+
+    struct RowError
+    {
+        std::size_t line;
+        std::string message;
+    };
+
+    struct Parsed
+    {
+        std::vector<Row> rows;
+        std::vector<RowError> errors;
+    };
+
+    static bool is_csv(std::string_view path) noexcept
+    {
+        const auto dot = path.rfind('.');
+        if (dot == std::string_view::npos)
+            return false;
+        return util::iequals(path.substr(dot + 1), "csv");
+    }
+
+    static std::expected<Parsed, std::string> read(const std::string &path)
+    {
+        std::ifstream in{path, std::ios::binary};
+        if (!in)
+            return std::unexpected(path + ": " + std::strerror(errno));
+        const std::string text{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+        if (in.bad())
+            return std::unexpected(path + ": read error");
+
+        Parsed out;
+        if (is_csv(path))
+            parse_csv_(text, out);
+        else if (auto ok = parse_json_(text, out); !ok)
+            return std::unexpected(path + ": " + ok.error());
+        return out;
+    }
+
+    static std::expected<void, std::string> write(const std::string &path,
+                                                  const std::vector<ledgr::HostDescriptor> &hosts)
+    {
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+            if (!out)
+                return std::unexpected(tmp + ": " + std::strerror(errno));
+
+            if (is_csv(path))
+            {
+                out << "id,name,host\n";
+                for (const auto &h : hosts)
+                {
+                    csv_field_(out, h.id) << ',';
+                    csv_field_(out, h.name) << ',';
+                    csv_field_(out, h.host) << '\n';
+                }
+            }
+            else
+            {
+                out << '[';
+                bool first = true;
+                for (const auto &h : hosts)
+                {
+                    // invalid UTF‑8 (ids typed into a CSV) becomes U+FFFD, not a throw
+                    out << (first ? "\n  " : ",\n  ")
+                        << nlohmann::json(h).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+                    first = false;
+                }
+                out << "\n]\n";
+            }
+
+            out.flush();
+            if (!out)
+            {
+                std::remove(tmp.c_str());
+                return std::unexpected(tmp + ": write error");
+            }
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        {
+            const std::string err = std::strerror(errno);
+            std::remove(tmp.c_str());
+            return std::unexpected(path + ": " + err);
+        }
+        return {};
+    }
+
+private:
+    // one parsed CSV record: its fields and the line it starts on
+    struct Record
+    {
+        std::size_t line{};
+        std::vector<std::string> fields;
+    };
+
+    // next record from `text` at `pos`; false at the end of the text
+    static bool next_record_(std::string_view text, std::size_t &pos, std::size_t &line, Record &rec)
+    {
+        rec.fields.clear();
+        if (pos >= text.size())
+            return false;
+
+        rec.line = line;
+        std::string field;
+        bool quoted = false;
+        for (; pos < text.size(); ++pos)
+        {
+            const char c = text[pos];
+            if (quoted)
+            {
+                if (c == '"' && pos + 1 < text.size() && text[pos + 1] == '"')
+                {
+                    field += '"';
+                    ++pos;
+                }
+                else if (c == '"')
+                    quoted = false;
+                else
+                {
+                    if (c == '\n')
+                        ++line;
+                    field += c;
+                }
+            }
+            else if (c == '"')
+                quoted = true;
+            else if (c == ',')
+                rec.fields.push_back(std::exchange(field, {}));
+            else if (c == '\n')
+            {
+                ++pos;
+                ++line;
+                break;
+            }
+            else if (c != '\r')
+                field += c;
+        }
+        rec.fields.push_back(std::move(field));
+        return true;
+    }
+
+    static void parse_csv_(std::string_view text, Parsed &out)
+    {
+        if (text.starts_with("\xEF\xBB\xBF"))
+            text.remove_prefix(3); // spreadsheet BOM
+
+        // column of id / name / host; positional unless a header names them
+        std::size_t col[3] = {0, 1, 2};
+        std::size_t pos = 0, line = 1;
+        Record rec;
+        bool first = true;
+        std::unordered_set<std::string> seen;
+        while (next_record_(text, pos, line, rec))
+        {
+            if (rec.fields.size() == 1 && util::trim(rec.fields[0]).empty())
+                continue; // blank line
+
+            if (first)
+            {
+                first = false;
+                std::size_t named[3] = {npos_, npos_, npos_};
+                for (std::size_t i = 0; i < rec.fields.size(); ++i)
+                {
+                    const auto name = util::trim(rec.fields[i]);
+                    for (std::size_t k = 0; k < 3; ++k)
+                        if (util::iequals(name, kColumns[k]))
+                            named[k] = i;
+                }
+                if (named[0] != npos_ || named[2] != npos_) // a header row
+                {
+                    if (named[0] == npos_ || named[2] == npos_)
+                    {
+                        out.errors.push_back({rec.line, "header needs both an id and a host column"});
+                        return;
+                    }
+                    std::copy(std::begin(named), std::end(named), std::begin(col));
+                    continue;
+                }
+            }
+
+            const auto field = [&](std::size_t k) -> std::string
+            {
+                return col[k] < rec.fields.size() ? std::string{util::trim(rec.fields[col[k]])} : std::string{};
+            };
+            add_(out, seen, rec.line, {field(0), field(1), field(2)});
+        }
+    }
+
+    static std::expected<void, std::string> parse_json_(std::string_view text, Parsed &out)
+    {
+        nlohmann::json doc = nlohmann::json::parse(text, nullptr, false);
+        if (doc.is_discarded())
+            return std::unexpected(std::string{"not valid JSON"});
+        if (doc.is_object() && doc.contains("entries"))
+            doc = std::move(doc["entries"]);
+        if (!doc.is_array())
+            return std::unexpected(std::string{"expected an array of hosts"});
+
+        std::unordered_set<std::string> seen;
+        std::size_t n = 0;
+        for (const auto &j : doc)
+        {
+            ++n;
+            if (!j.is_object())
+            {
+                out.errors.push_back({n, "not an object"});
+                continue;
+            }
+            ledgr::HostDescriptor h;
+            try
+            {
+                h = j.get<ledgr::HostDescriptor>();
+            }
+            catch (const std::exception &)
+            {
+                out.errors.push_back({n, "id, name and host must be strings"});
+                continue;
+            }
+            add_(out, seen, n, std::move(h));
+        }
+        return {};
+    }
+
+    static void add_(Parsed &out, std::unordered_set<std::string> &seen, std::size_t line, ledgr::HostDescriptor h)
+    {
+        if (h.id.empty())
+            out.errors.push_back({line, "missing id"});
+        else if (h.host.empty())
+            out.errors.push_back({line, "missing host"});
+        else if (!seen.insert(h.id).second)
+            out.errors.push_back({line, "duplicate id '" + h.id + "'"});
+        else
+            out.rows.push_back({line, std::move(h)});
+    }
+
+    static std::ofstream &csv_field_(std::ofstream &out, const std::string &s)
+    {
+        if (s.find_first_of(",\"\r\n") == std::string::npos)
+        {
+            out << s;
+            return out;
+        }
+        out << '"';
+        for (const char c : s)
+        {
+            if (c == '"')
+                out << '"';
+            out << c;
+        }
+        out << '"';
+        return out;
+    }
+
+    static constexpr std::size_t npos_ = ~std::size_t{0};
+    static constexpr std::string_view kColumns[3] = {"id", "name", "host"};
+};
+
+#endif
@@ -0,0 +1,230 @@
+// host_index.hpp — case‑folded trigram index for filtering the host list
+// -----------------------------------------------------------------------------
+#ifndef CP_HOST_INDEX_HPP
+#define CP_HOST_INDEX_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "host_descriptor.hpp"
+
+/**
+ * HostIndex
+ * ---------
+ * Substring search over every host's id, name and host string, built once
+ * per host‑list version so a filter query costs a few posting‑list
+ * intersections instead of a scan with three `find`s per host.
+ *
+ *   - Text is case‑folded (ASCII) and stored field by field, so a match
+ *     never spans two fields.
+ *   - Each trigram of the folded text is reduced to 6 bits per character
+ *     (letters, digits and the usual host‑name punctuation get their own
+ *     code; everything else shares one), giving 2^18 possible keys.  The
+ *     posting lists are built with two counting passes over the text into
+ *     one CSR array — linear, no sort, no per‑key allocation.
+ *   - `query()` intersects the lists of the needle's trigrams, shortest
+ *     first, then confirms each candidate with a real substring check (the
+ *     reduced alphabet admits false positives, never false negatives).
+ *     Needles shorter than three characters are answered by a scan of the
+ *     folded text.
+ *
+ * Results are host indices in list order.
+ */
+class HostIndex
+{
+public:
+    void build(const std::vector<ledgr::HostDescriptor> &hosts)
+    {
+        // folded fields, back to back: host i's fields are fields_[3i .. 3i+3)
+        text_.clear();
+        fieldEnd_.clear();
+        fieldEnd_.reserve(hosts.size() * kFields);
+        for (const auto &h : hosts)
+        {
+            for (const std::string *f : {&h.id, &h.name, &h.host})
+            {
+                for (const char c : *f)
+                    text_.push_back(fold_(c));
+                fieldEnd_.push_back(static_cast<uint32_t>(text_.size()));
+            }
+        }
+        hosts_ = hosts.size();
+
+        // pass 1: postings per key, each host counted once per key
+        keys_.assign(kKeys, {kNoHost, 0});
+        forEachGram_([&](uint32_t key, uint32_t host)
+                     {
+                         auto &k = keys_[key];
+                         if (k.last != host)
+                         {
+                             k.last = host;
+                             ++k.n;
+                         } });
+        offsets_.resize(kKeys + 1);
+        offsets_[0] = 0;
+        for (std::size_t key = 0; key < kKeys; ++key)
+        {
+            offsets_[key + 1] = offsets_[key] + keys_[key].n;
+            keys_[key] = {kNoHost, offsets_[key]}; // n becomes the fill cursor
+        }
+
+        // pass 2: fill; hosts arrive in order, so every list is sorted
+        postings_.resize(offsets_[kKeys]);
+        forEachGram_([&](uint32_t key, uint32_t host)
+                     {
+                         auto &k = keys_[key];
+                         if (k.last != host)
+                         {
+                             k.last = host;
+                             postings_[k.n++] = host;
+                         } });
+    }
+
+    /** Hosts whose id, name or host contains `needle`, case‑insensitively;
+     *  every host for an empty needle. */
+    void query(std::string_view needle, std::vector<std::size_t> &out)
+    {
+        out.clear();
+        needle_.clear();
+        for (const char c : needle)
+            needle_.push_back(fold_(c));
+
+        if (needle_.empty())
+        {
+            for (std::size_t i = 0; i < hosts_; ++i)
+                out.push_back(i);
+            return;
+        }
+
+        if (needle_.size() < 3)
+        {
+            for (std::size_t i = 0; i < hosts_; ++i)
+                if (matches_(i))
+                    out.push_back(i);
+            return;
+        }
+
+        // the needle's posting lists, shortest first
+        lists_.clear();
+        for (std::size_t p = 0; p + 3 <= needle_.size(); ++p)
+            lists_.push_back(key_(needle_[p], needle_[p + 1], needle_[p + 2]));
+        std::ranges::sort(lists_);
+        const auto [first, last] = std::ranges::unique(lists_);
+        lists_.erase(first, last);
+        std::ranges::sort(lists_, {}, [this](uint32_t key)
+                          { return offsets_[key + 1] - offsets_[key]; });
+
+        cand_.assign(postings_.begin() + offsets_[lists_[0]], postings_.begin() + offsets_[lists_[0] + 1]);
+        for (std::size_t l = 1; l < lists_.size() && !cand_.empty(); ++l)
+        {
+            const auto *b = postings_.data() + offsets_[lists_[l]];
+            const auto *e = postings_.data() + offsets_[lists_[l] + 1];
+            std::erase_if(cand_, [&](uint32_t host)
+                          {
+                              // gallop: candidates are ascending, so b only moves forward
+                              std::size_t step = 1;
+                              while (b + step < e && b[step] < host)
+                              {
+                                  b += step;
+                                  step *= 2;
+                              }
+                              b = std::lower_bound(b, std::min(b + step + 1, e), host);
+                              return b == e || *b != host; });
+        }
+
+        for (const uint32_t host : cand_)
+            if (matches_(host))
+                out.push_back(host);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return hosts_; }
+
+private:
+    static constexpr std::size_t kFields = 3;
+    static constexpr std::size_t kKeys = std::size_t{1} << 18;
+    static constexpr uint32_t kNoHost = ~uint32_t{0};
+
+    static char fold_(char c) noexcept
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    // 6‑bit code of a folded character: 0 = anything without its own code
+    static constexpr std::array<uint8_t, 256> kCode = []
+    {
+        std::array<uint8_t, 256> t{};
+        uint8_t next = 1;
+        for (char c = 'a'; c <= 'z'; ++c)
+            t[static_cast<unsigned char>(c)] = next++;
+        for (char c = '0'; c <= '9'; ++c)
+            t[static_cast<unsigned char>(c)] = next++;
+        for (const char c : std::string_view{".-_:/@ "})
+            t[static_cast<unsigned char>(c)] = next++;
+        return t;
+    }();
+
+    static uint32_t key_(char a, char b, char c) noexcept
+    {
+        return uint32_t{kCode[static_cast<unsigned char>(a)]} << 12 |
+               uint32_t{kCode[static_cast<unsigned char>(b)]} << 6 |
+               uint32_t{kCode[static_cast<unsigned char>(c)]};
+    }
+
+    template <typename F>
+    void forEachGram_(F &&f) const
+    {
+        uint32_t begin = 0;
+        for (std::size_t field = 0; field < fieldEnd_.size(); ++field)
+        {
+            const uint32_t end = fieldEnd_[field];
+            const auto host = static_cast<uint32_t>(field / kFields);
+            uint32_t key = 0; // rolling: last three codes
+            for (uint32_t p = begin; p < end; ++p)
+            {
+                key = (key << 6 | kCode[static_cast<unsigned char>(text_[p])]) & (kKeys - 1);
+                if (p >= begin + 2)
+                    f(key, host);
+            }
+            begin = end;
+        }
+    }
+
+    bool matches_(std::size_t host) const noexcept
+    {
+        uint32_t begin = host == 0 ? 0 : fieldEnd_[host * kFields - 1];
+        for (std::size_t f = 0; f < kFields; ++f)
+        {
+            const uint32_t end = fieldEnd_[host * kFields + f];
+            if (std::string_view{text_}.substr(begin, end - begin).find(needle_) != std::string_view::npos)
+                return true;
+            begin = end;
+        }
+        return false;
+    }
+
+    std::size_t hosts_{};
+    std::string text_;               // folded fields, back to back
+    std::vector<uint32_t> fieldEnd_; // end offset of each field in text_
+    std::vector<uint32_t> offsets_;  // key → [offsets_[key], offsets_[key+1]) in postings_
+    std::vector<uint32_t> postings_; // host indices, ascending per key
+
+    // per‑key build state: last host counted, then count / fill cursor
+    struct KeyState
+    {
+        uint32_t last;
+        uint32_t n;
+    };
+
+    // scratch, kept between calls
+    std::vector<KeyState> keys_;
+    std::string needle_;
+    std::vector<uint32_t> lists_;
+    std::vector<uint32_t> cand_;
+};
+
+#endif
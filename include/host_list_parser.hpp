@@ -0,0 +1,404 @@
+// host_list_parser.hpp — incremental parser for the daemon's host list reply
+// -----------------------------------------------------------------------------
+#ifndef CP_HOST_LIST_PARSER_HPP
+#define CP_HOST_LIST_PARSER_HPP
+
+#include <cstddef>
+#include <expected>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "host_descriptor.hpp"
+
+/**
+ * HostListParser
+ * --------------
+ * Push parser for `{"entries":[{host}, …], <other members>}`, fed the reply
+ * body piece by piece as it comes off the socket (`LedgerClient::
+ * send_streaming()`), so a large ledger is never held as text plus DOM plus
+ * descriptors at once.
+ *
+ * A resumable scanner tracks nesting and strings across piece boundaries and
+ * buffers one value at a time: each element of `entries`, decoded by a SAX
+ * handler straight into a `HostDescriptor` that is moved to the output, and
+ * each other top‑level member (a revision, a status — all small), kept in
+ * `meta()`.  Peak memory is the output plus the largest single entry.
+ *
+ * Output goes to the vector given at construction; with a chunk callback it
+ * is handed over (and then cleared) every `chunk_size` hosts instead.
+ * Semantics follow `from_json`: missing fields read as empty, mistyped ones
+ * and malformed JSON fail the whole reply.
+ */
+class HostListParser
+{
+public:
+    using Chunk = std::function<void(std::vector<ledgr::HostDescriptor> &)>;
+
+    explicit HostListParser(std::vector<ledgr::HostDescriptor> &out, Chunk chunk = {},
+                            std::size_t chunk_size = 1024)
+        : out_{out}, chunk_{std::move(chunk)}, chunkSize_{chunk_size ? chunk_size : 1} {}
+
+    /** Consume the next piece of the body; false once it is known to be bad. */
+    bool feed(std::string_view data)
+    {
+        std::size_t i = 0;
+        while (i < data.size() && error_.empty())
+            i = step_(data, i);
+        if (capturing_ && error_.empty())
+        {
+            buf_.append(data.substr(capStart_));
+            capStart_ = 0;
+        }
+        return error_.empty();
+    }
+
+    /** End of the body: flush the output; error if it was bad or cut short. */
+    std::expected<void, std::string> finish()
+    {
+        if (error_.empty() && state_ != State::Done)
+            error_ = "host list truncated";
+        if (!error_.empty())
+            return std::unexpected(error_);
+        if (chunk_ && !out_.empty())
+        {
+            chunk_(out_);
+            out_.clear();
+        }
+        return {};
+    }
+
+    /** Top‑level members other than `entries`. */
+    [[nodiscard]] const nlohmann::json &meta() const noexcept { return meta_; }
+
+    /** Hosts emitted so far. */
+    [[nodiscard]] std::size_t count() const noexcept { return count_; }
+
+private:
+    enum class State
+    {
+        Start,    // before the top‑level object
+        Key,      // in the object, expecting a key (or its end)
+        Colon,    // after a key
+        Value,    // expecting a member value
+        Entries,  // in the entries array, expecting an element (or its end)
+        Capture,  // inside a value being buffered
+        Done,     // top‑level object closed
+    };
+
+    static bool space_(char c) noexcept { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    // process from data[i]; returns where to continue
+    std::size_t step_(std::string_view data, std::size_t i)
+    {
+        const char c = data[i];
+        switch (state_)
+        {
+        case State::Start:
+            if (space_(c))
+                return i + 1;
+            if (c != '{')
+                return fail_("host list is not an object");
+            state_ = State::Key;
+            return i + 1;
+
+        case State::Key:
+            if (space_(c) || c == ',')
+                return i + 1;
+            if (c == '}')
+            {
+                state_ = State::Done;
+                return i + 1;
+            }
+            if (c != '"')
+                return fail_("expected a member name");
+            begin_(i, State::Colon); // a key is a string value
+            return i + 1;
+
+        case State::Colon:
+            if (space_(c))
+                return i + 1;
+            if (c != ':')
+                return fail_("expected ':'");
+            state_ = State::Value;
+            return i + 1;
+
+        case State::Value:
+            if (space_(c))
+                return i + 1;
+            if (key_ == "entries" && c == '[')
+            {
+                state_ = State::Entries;
+                return i + 1;
+            }
+            begin_(i, State::Key);
+            return i; // the capture sees the value's first character
+
+        case State::Entries:
+            if (space_(c) || c == ',')
+                return i + 1;
+            if (c == ']')
+            {
+                state_ = State::Key;
+                return i + 1;
+            }
+            begin_(i, State::Entries);
+            return i;
+
+        case State::Capture:
+            return capture_(data, i);
+
+        case State::Done:
+            if (!space_(c))
+                return fail_("data after the host list");
+            return i + 1;
+        }
+        return i + 1;
+    }
+
+    // start buffering a value at data[i]; `then` is the state after it
+    void begin_(std::size_t i, State then)
+    {
+        then_ = then;
+        state_ = State::Capture;
+        capturing_ = true;
+        capStart_ = i;
+        buf_.clear();
+        depth_ = 0;
+        inString_ = false;
+        escape_ = false;
+        if (then == State::Colon) // a key: the opening quote is consumed here
+        {
+            inString_ = true;
+            capStart_ = i + 1;
+        }
+    }
+
+    // scan a buffered value; ends at its closing bracket / quote, or (for a
+    // scalar) just before the ',', '}' or ']' that follows it
+    std::size_t capture_(std::string_view data, std::size_t i)
+    {
+        for (; i < data.size(); ++i)
+        {
+            const char c = data[i];
+            if (inString_)
+            {
+                if (escape_)
+                {
+                    escape_ = false;
+                    continue;
+                }
+                // skip to the next quote or backslash
+                const auto j = data.find_first_of("\"\\", i);
+                if (j == std::string_view::npos)
+                    return data.size();
+                i = j;
+                if (data[i] == '\\')
+                {
+                    escape_ = true;
+                    continue;
+                }
+                inString_ = false;
+                if (then_ == State::Colon) // end of a key
+                {
+                    buf_.append(data.substr(capStart_, i - capStart_));
+                    capturing_ = false;
+                    key_ = std::move(buf_);
+                    buf_.clear();
+                    state_ = State::Colon;
+                    return i + 1;
+                }
+                if (depth_ == 0)
+                    return end_(data, i + 1); // a string value
+                continue;
+            }
+
+            switch (c)
+            {
+            case '"':
+                inString_ = true;
+                break;
+            case '{':
+            case '[':
+                ++depth_;
+                break;
+            case '}':
+            case ']':
+                if (depth_ == 0)
+                    return end_(data, i); // closes the parent: scalar ended
+                if (--depth_ == 0)
+                    return end_(data, i + 1);
+                break;
+            case ',':
+                if (depth_ == 0)
+                    return end_(data, i);
+                break;
+            default:
+                break;
+            }
+        }
+        return i;
+    }
+
+    // the value ends before data[end]
+    std::size_t end_(std::string_view data, std::size_t end)
+    {
+        buf_.append(data.substr(capStart_, end - capStart_));
+        capturing_ = false;
+        state_ = then_;
+        if (then_ == State::Entries)
+            entry_();
+        else
+            member_();
+        return end;
+    }
+
+    void member_()
+    {
+        auto v = nlohmann::json::parse(buf_, nullptr, false);
+        if (v.is_discarded())
+        {
+            fail_("malformed value of '" + key_ + "'");
+            return;
+        }
+        meta_[key_] = std::move(v);
+    }
+
+    void entry_()
+    {
+        host_ = {};
+        EntrySax sax{host_};
+        if (!nlohmann::json::sax_parse(buf_, &sax) || !sax.ok || !sax.object)
+        {
+            fail_("entries[" + std::to_string(count_) + "]: " +
+                  (!sax.ok ? sax.why : sax.object ? std::string{"malformed JSON"} : std::string{"not an object"}));
+            return;
+        }
+        out_.push_back(std::move(host_));
+        ++count_;
+        if (chunk_ && out_.size() >= chunkSize_)
+        {
+            chunk_(out_);
+            out_.clear();
+        }
+    }
+
+    std::size_t fail_(std::string why)
+    {
+        if (error_.empty())
+            error_ = std::move(why);
+        return ~std::size_t{0};
+    }
+
+    // SAX handler for one entry: the id / name / host strings of the object,
+    // other members ignored at any depth
+    struct EntrySax
+    {
+        explicit EntrySax(ledgr::HostDescriptor &out) noexcept : h{out} {}
+
+        ledgr::HostDescriptor &h;
+        int depth{0};
+        std::string *field{nullptr};
+        bool object{false}; // the entry is an object at all
+        bool ok{true};
+        std::string why;
+
+        bool scalar_()
+        {
+            if (field && depth == 1)
+                return mistyped_();
+            field = nullptr;
+            return true;
+        }
+        bool mistyped_()
+        {
+            ok = false;
+            why = "id, name and host must be strings";
+            return false;
+        }
+
+        bool null() { return scalar_(); }
+        bool boolean(bool) { return scalar_(); }
+        bool number_integer(nlohmann::json::number_integer_t) { return scalar_(); }
+        bool number_unsigned(nlohmann::json::number_unsigned_t) { return scalar_(); }
+        bool number_float(nlohmann::json::number_float_t, const std::string &) { return scalar_(); }
+        bool binary(nlohmann::json::binary_t &) { return scalar_(); }
+        bool string(std::string &s)
+        {
+            if (field && depth == 1)
+                *field = std::move(s);
+            field = nullptr;
+            return true;
+        }
+        bool start_object(std::size_t)
+        {
+            if (depth == 0)
+            {
+                object = true;
+                ++depth;
+                return true;
+            }
+            if (field && depth == 1)
+                return mistyped_();
+            ++depth;
+            return true;
+        }
+        bool end_object()
+        {
+            --depth;
+            return true;
+        }
+        bool start_array(std::size_t)
+        {
+            if (field && depth == 1)
+                return mistyped_();
+            ++depth;
+            return true;
+        }
+        bool end_array()
+        {
+            --depth;
+            return true;
+        }
+        bool key(std::string &k)
+        {
+            field = nullptr;
+            if (depth == 1)
+            {
+                if (k == "id")
+                    field = &h.id;
+                else if (k == "name")
+                    field = &h.name;
+                else if (k == "host")
+                    field = &h.host;
+            }
+            return true;
+        }
+        bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &) { return false; }
+    };
+
+    std::vector<ledgr::HostDescriptor> &out_;
+    Chunk chunk_;
+    std::size_t chunkSize_;
+
+    State state_{State::Start};
+    State then_{State::Key}; // state after the value being captured
+    bool capturing_{false};  // buf_ holds the head of a value that began in an earlier piece
+    std::size_t capStart_{0};
+    int depth_{0};
+    bool inString_{false};
+    bool escape_{false};
+
+    std::string buf_; // the value being captured
+    std::string key_; // last member name
+    ledgr::HostDescriptor host_;
+    nlohmann::json meta_ = nlohmann::json::object();
+    std::size_t count_{0};
+    std::string error_;
+};
+
+#endif
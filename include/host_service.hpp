@@ -1,79 +1,534 @@
 #ifndef CP_HOST_SERVICE_HPP
 #define CP_HOST_SERVICE_HPP
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <vector>
-#include <shared_mutex>
 #include <string>
 #include <expected>
 #include <mutex>
-
-// #include <spdlog/spdlog.h>
+#include <optional>
+#include <thread>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include "host_descriptor.hpp"
+#include "host_file.hpp"
 #include "api_client.hpp"
+#include "log.hpp"
+#include "log_service.hpp"
 
 /**
  * HostService
  * ---------------------------
  * Owns the already‑connected `LedgerApiClient`, keeps a cached copy of the
  * host list, and translates daemon errors into `std::expected` so the UI can
- * treat them as ordinary values.  Thread‑safe via a `std::shared_mutex`.
+ * treat them as ordinary values.
+ *
+ * Nothing here blocks the caller on the daemon.  Operations are commands
+ * queued to a worker thread and identified by a `Ticket`; the UI `poll()`s
+ * its tickets once per frame (spinner while the result is `std::nullopt`) and
+ * may `cancel()` them.  A cancelled command that has not started is dropped;
+ * one already on the wire finishes, and its result is discarded — except
+ * that a host the daemon did create still lands in the cache.
+ *
+ * The cache is published RCU‑style: an immutable, versioned `Snapshot` behind
+ * an atomically swapped `shared_ptr`.  Only the worker writes; it builds each
+ * new version off to the side (a fetched list, or the current one plus a
+ * created host) and swaps it in.  Readers on any thread take `snapshot()`
+ * without blocking and keep a consistent list for as long as they hold it;
+ * comparing `version` tells them whether anything derived from it (a
+ * filtered or sorted view, a join) needs redoing.  The constructor queues the
+ * first refresh instead of waiting for it.
+ *
+ * Sync is incremental once the daemon reports ledger revisions (see
+ * `LedgerApiClient`): a refresh asks for the changes since the cached
+ * revision and applies the upserts and removals by id, falling back to the
+ * full list only when the daemon refuses the revision.  Between refreshes a
+ * long‑poll watch keeps one request parked on the daemon and applies what it
+ * returns, so an idle ledger costs an empty reply every `watch` interval and
+ * no new version.  Watch failures back off up to `kWatchBackoffMax`; without
+ * revisions, or with `watch` = 0, only explicit refreshes sync.
+ *
+ * Bulk onboarding goes through `importHosts()`: the worker reads a CSV/JSON
+ * file (see `HostFile`), pipelines the creates with bounded concurrency, and
+ * counts progress into a shared `Transfer` the UI can draw from while it
+ * runs; the created hosts land in the cache as one new version.
+ * `exportHosts()` streams the current snapshot to a file.
  */
 class HostService
 {
 public:
-    explicit HostService(LedgerApiClient &client) noexcept : client_{client}
+    using Ticket = uint64_t;
+    using Outcome = std::expected<void, std::string>;
+
+    /** One published version of the host list; never modified once shared. */
+    struct Snapshot
+    {
+        uint64_t version{}; //!< 0 = nothing loaded yet
+        std::vector<ledgr::HostDescriptor> hosts;
+    };
+
+    /** Progress of a bulk import; counters are live, `errors` is complete
+     *  (sorted by line) once the ticket is done. */
+    struct Transfer
     {
-        refresh_(); // prime cache
+        std::atomic<std::size_t> total{0}; //!< rows in the file
+        std::atomic<std::size_t> done{0};  //!< rows settled, good or bad
+        std::atomic<std::size_t> failed{0};
+        std::vector<HostFile::RowError> errors;
+    };
+
+    explicit HostService(LedgerApiClient &client,
+                         std::chrono::milliseconds watch = std::chrono::seconds{25})
+        : client_{client}, watchWait_{watch}
+    {
+        worker_ = std::thread([this]
+                              { run_(); });
+        submit_({.kind = Kind::Refresh}, true); // prime cache in the background
     }
 
-    /** Return the cached hosts.  Never throws. */
-    const std::vector<ledgr::HostDescriptor> &listHosts() const noexcept
+    ~HostService()
     {
-        std::shared_lock lock{mtx_};
-        return cache_;
+        {
+            // a parked watch outlives us on the client thread; cut it off
+            std::lock_guard lock{inbox_->mtx};
+            inbox_->owner = nullptr;
+        }
+        {
+            std::lock_guard lock{mtx_};
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        worker_.join(); // a command on the wire finishes first (≤ client timeout)
     }
 
+    HostService(const HostService &) = delete;
+    HostService &operator=(const HostService &) = delete;
+
+    /** Current host list; lock‑free, never null, never throws. */
+    [[nodiscard]] std::shared_ptr<const Snapshot> snapshot() const noexcept
+    {
+        return snap_.load(std::memory_order_acquire);
+    }
+
+    /** Queue adding a host via the daemon; the cache gains it on success. */
+    [[nodiscard]] Ticket addHost(ledgr::HostDescriptor h) { return submit_({.kind = Kind::Add, .host = std::move(h)}); }
+
+    /** Queue a reload of the cache from the daemon. */
+    [[nodiscard]] Ticket refresh() { return submit_({.kind = Kind::Refresh}); }
+
+    /**
+     * Queue creating every host in the CSV/JSON file at `path`.  The outcome
+     * fails only if the file cannot be used at all; rows the file or the
+     * daemon rejected are in the returned `Transfer`.  Cancelling stops
+     * further creates; hosts already created stay.
+     */
+    [[nodiscard]] std::pair<Ticket, std::shared_ptr<const Transfer>> importHosts(std::string path)
+    {
+        auto transfer = std::make_shared<Transfer>();
+        const Ticket t = submit_({.kind = Kind::Import, .path = std::move(path), .transfer = transfer});
+        return {t, std::move(transfer)};
+    }
+
+    /** Queue writing the host list, as it is when the command runs, to `path`. */
+    [[nodiscard]] Ticket exportHosts(std::string path) { return submit_({.kind = Kind::Export, .path = std::move(path)}); }
+
     /**
-     * Add a host via the daemon.  Success ⇒ cache updated; error ⇒ returned as
-     * `std::unexpected<string>`.
+     * Result of `t` once it is done (the ticket is then forgotten), or
+     * `std::nullopt` while it is queued or running.
      */
-    [[nodiscard]] std::expected<void, std::string>
-    addHost(const ledgr::HostDescriptor &h) noexcept
+    [[nodiscard]] std::optional<Outcome> poll(Ticket t)
     {
-        std::string err;
-        if (client_.add_host(h, &err))
+        std::lock_guard lock{mtx_};
+        auto it = ops_.find(t);
+        if (it == ops_.end())
+            return Outcome{std::unexpected(std::string{"unknown operation"})};
+        if (!it->second.result)
+            return std::nullopt;
+        Outcome out = std::move(*it->second.result);
+        ops_.erase(it);
+        return out;
+    }
+
+    /** Give up on `t`; its result will not be reported. */
+    void cancel(Ticket t)
+    {
+        std::lock_guard lock{mtx_};
+        auto it = ops_.find(t);
+        if (it == ops_.end())
+            return;
+        if (it->second.result) // done, just not polled yet
         {
+            ops_.erase(it);
+            return;
+        }
+        if (!it->second.running)
+        {
+            std::erase_if(queue_, [t](const Command &c)
+                          { return c.ticket == t; });
+            if (it->second.kind == Kind::Refresh)
+                --refreshes_;
+            ops_.erase(it);
+            return;
+        }
+        it->second.cancelled = true;
+    }
+
+    /** A refresh is queued or running (for a spinner next to the table). */
+    [[nodiscard]] bool refreshing() const
+    {
+        std::lock_guard lock{mtx_};
+        return refreshes_ > 0;
+    }
+
+private:
+    using Changes = LedgerApiClient::HostChanges;
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds kWatchBackoffMin{500};
+    static constexpr std::chrono::milliseconds kWatchBackoffMax{30'000};
+
+    enum class Kind
+    {
+        Refresh,
+        Add,
+        Import,
+        Export,
+        Watched, // a watch reply, delivered from the client thread
+    };
+
+    static const char *kind_name_(Kind kind) noexcept
+    {
+        switch (kind)
+        {
+        case Kind::Refresh:
+            return "refresh";
+        case Kind::Add:
+            return "add host";
+        case Kind::Import:
+            return "import";
+        case Kind::Export:
+            return "export";
+        case Kind::Watched:
+            break;
+        }
+        return "watch";
+    }
+
+    struct Command
+    {
+        Ticket ticket{}; // 0 for Watched
+        Kind kind{};
+        ledgr::HostDescriptor host{};               // Add
+        std::string path{};                         // Import, Export
+        std::shared_ptr<Transfer> transfer{};       // Import
+        LedgerApiClient::ChangesResult changes{};   // Watched
+    };
+
+    // Where watch replies go; shared with the callbacks so one arriving
+    // after our destructor finds no owner instead of a dangling pointer.
+    struct Inbox
+    {
+        explicit Inbox(HostService *o) noexcept : owner{o} {}
+        std::mutex mtx;
+        HostService *owner;
+    };
+
+    struct Op
+    {
+        Kind kind;
+        bool running{false};
+        bool cancelled{false};
+        bool detached{false}; // nobody polls it: forget once done
+        std::optional<Outcome> result;
+    };
+
+    Ticket submit_(Command cmd, bool detached = false)
+    {
+        Ticket t;
+        {
+            std::lock_guard lock{mtx_};
+            t = next_++;
+            cmd.ticket = t;
+            ops_.emplace(t, Op{.kind = cmd.kind, .detached = detached, .result = std::nullopt});
+            if (cmd.kind == Kind::Refresh)
+                ++refreshes_;
+            queue_.push_back(std::move(cmd));
+        }
+        cv_.notify_one();
+        return t;
+    }
+
+    void run_()
+    {
+        for (;;)
+        {
+            Command cmd;
             {
                 std::unique_lock lock{mtx_};
-                cache_.push_back(h);
+                const auto ready = [this]
+                { return stopping_ || !queue_.empty(); };
+                if (watchRetry_)
+                    cv_.wait_until(lock, *watchRetry_, ready);
+                else
+                    cv_.wait(lock, ready);
+                if (stopping_)
+                    return;
+                if (queue_.empty()) // watch back‑off elapsed
+                {
+                    lock.unlock();
+                    watchRetry_.reset();
+                    watch_();
+                    continue;
+                }
+                cmd = std::move(queue_.front());
+                queue_.pop_front();
+                if (cmd.kind != Kind::Watched)
+                    ops_[cmd.ticket].running = true;
             }
-            return {};
+
+            if (cmd.kind == Kind::Watched)
+            {
+                watched_(std::move(cmd.changes));
+                continue;
+            }
+
+            Outcome out;
+            std::optional<Changes> changes;
+            try
+            {
+                switch (cmd.kind)
+                {
+                case Kind::Refresh:
+                    changes = client_.sync_hosts(revision_);
+                    break;
+                case Kind::Add:
+                {
+                    std::string err;
+                    if (!client_.add_host(cmd.host, &err))
+                        out = std::unexpected(err.empty() ? std::string{"rejected by daemon"} : std::move(err));
+                    break;
+                }
+                case Kind::Import:
+                    out = import_(cmd, changes);
+                    break;
+                case Kind::Export:
+                    out = HostFile::write(cmd.path, snapshot()->hosts);
+                    break;
+                case Kind::Watched:
+                    break;
+                }
+            }
+            catch (const std::exception &ex)
+            {
+                out = std::unexpected(std::string{ex.what()});
+            }
+            if (!out)
+                LOG_WARN("HostService {} failed: {}", kind_name_(cmd.kind), out.error());
+
+            if (cmd.kind == Kind::Add && out)
+            {
+                auto next = snapshot()->hosts; // copied off to the side, outside the lock
+                next.push_back(std::move(cmd.host)); // it exists, cancelled or not
+                publish_(std::move(next));
+            }
+
+            // applied even if cancelled: it is newer than the cache either way
+            if (changes)
+                apply_(std::move(*changes));
+
+            {
+                std::lock_guard lock{mtx_};
+                auto &op = ops_[cmd.ticket];
+                if (cmd.kind == Kind::Refresh)
+                    --refreshes_;
+                if (op.cancelled || op.detached)
+                    ops_.erase(cmd.ticket);
+                else
+                    op.result = std::move(out);
+            }
+
+            if (!watching_ && !watchRetry_)
+                watch_();
         }
-        return std::unexpected(err);
     }
 
-    /** Refresh the cache from the daemon.  Non‑throwing; logs on failure. */
-    void refresh() noexcept { refresh_(); }
+    // worker only: create the hosts of a file; `created` gets the ones that were
+    Outcome import_(const Command &cmd, std::optional<Changes> &created)
+    {
+        auto parsed = HostFile::read(cmd.path);
+        if (!parsed)
+            return std::unexpected(std::move(parsed.error()));
+
+        auto &st = *cmd.transfer;
+        st.errors = std::move(parsed->errors); // rows the file itself got wrong
+        st.failed.store(st.errors.size(), std::memory_order_relaxed);
+        st.done.store(st.errors.size(), std::memory_order_relaxed);
+        st.total.store(st.errors.size() + parsed->rows.size(), std::memory_order_relaxed);
+        if (parsed->rows.empty())
+            return st.errors.empty() ? Outcome{std::unexpected(std::string{"no hosts in file"})} : Outcome{};
 
-private:
-    void refresh_() noexcept
+        std::vector<ledgr::HostDescriptor> hosts;
+        hosts.reserve(parsed->rows.size());
+        for (auto &row : parsed->rows)
+            hosts.push_back(std::move(row.host));
+
+        const auto results = client_.add_hosts(hosts, [&](std::size_t i, const LedgerApiClient::AddResult &res)
+                                               {
+                                                   if (!res)
+                                                   {
+                                                       st.errors.push_back({parsed->rows[i].line, res.error()});
+                                                       st.failed.fetch_add(1, std::memory_order_relaxed);
+                                                   }
+                                                   st.done.fetch_add(1, std::memory_order_relaxed);
+                                                   std::lock_guard lock{mtx_};
+                                                   return !ops_[cmd.ticket].cancelled; });
+        std::ranges::sort(st.errors, {}, &HostFile::RowError::line);
+
+        Changes c;
+        c.revision = revision_; // our own writes; the watch brings the real revision
+        for (std::size_t i = 0; i < hosts.size(); ++i)
+            if (results[i])
+                c.upserts.push_back(std::move(hosts[i]));
+        if (!c.upserts.empty())
+            created = std::move(c);
+        return {};
+    }
+
+    // worker only: park a long poll on the daemon, if it can take one
+    void watch_()
+    {
+        if (watching_ || watchWait_.count() <= 0 || revision_ == 0)
+            return;
+        watching_ = true;
+        client_.watch_hosts(revision_, watchWait_, [inbox = inbox_](LedgerApiClient::ChangesResult res)
+                            {
+                                std::lock_guard lock{inbox->mtx};
+                                if (inbox->owner)
+                                    inbox->owner->deliver_(std::move(res)); });
+    }
+
+    // client thread: hand a watch reply to the worker
+    void deliver_(LedgerApiClient::ChangesResult res)
+    {
+        {
+            std::lock_guard lock{mtx_};
+            queue_.push_back({.kind = Kind::Watched, .changes = std::move(res)});
+        }
+        cv_.notify_one();
+    }
+
+    // worker only: apply a watch reply and park the next one
+    void watched_(LedgerApiClient::ChangesResult res)
     {
+        watching_ = false;
         try
         {
-            auto hosts = client_.list_hosts();
-            std::unique_lock lock{mtx_};
-            cache_ = std::move(hosts);
+            if (res && res->resync)
+                res = client_.sync_hosts(0); // revision fell out of the daemon's log
         }
         catch (const std::exception &ex)
         {
-            // spdlog::warn("HostService refresh failed: {}", ex.what());
+            res = std::unexpected(std::string{ex.what()});
+        }
+
+        if (!res)
+        {
+            LOG_WARN("HostService watch failed: {}", res.error());
+            watchBackoff_ = std::clamp(watchBackoff_ * 2, kWatchBackoffMin, kWatchBackoffMax);
+            watchRetry_ = Clock::now() + watchBackoff_;
+            return;
+        }
+        watchBackoff_ = {};
+        apply_(std::move(*res));
+        watch_();
+    }
+
+    // worker only: bring the cache to `c.revision`; publishes only on change
+    void apply_(Changes c)
+    {
+        if (c.revision != 0 && c.revision < revision_)
+            return; // a slower reply overtaken by a newer one
+        revision_ = c.revision;
+        if (c.full)
+        {
+            publish_(std::move(c.upserts));
+            return;
+        }
+        if (c.upserts.empty() && c.removed.empty())
+            return; // same list: no new version, nothing downstream redone
+
+        // one pass over the cache; lookups go into the (small) change set
+        std::unordered_map<std::string_view, std::size_t> upserts; // id → index in c.upserts
+        for (std::size_t k = 0; k < c.upserts.size(); ++k)
+            upserts[c.upserts[k].id] = k; // the last one for an id wins
+        const std::unordered_set<std::string_view> removed(c.removed.begin(), c.removed.end());
+        std::vector<bool> placed(c.upserts.size());
+
+        const auto cur = snapshot();
+        std::vector<ledgr::HostDescriptor> next;
+        next.reserve(cur->hosts.size() + c.upserts.size());
+        for (const auto &h : cur->hosts)
+        {
+            if (removed.contains(h.id))
+                continue;
+            if (auto it = upserts.find(h.id); it != upserts.end() && !placed[it->second])
+            {
+                placed[it->second] = true; // changed in place, keeps its row
+                next.push_back(c.upserts[it->second]);
+            }
+            else
+            {
+                next.push_back(h);
+            }
+        }
+        for (std::size_t k = 0; k < c.upserts.size(); ++k)
+        {
+            if (!placed[k] && upserts.at(c.upserts[k].id) == k)
+            {
+                placed[k] = true; // added at the end
+                next.push_back(c.upserts[k]);
+            }
         }
+        publish_(std::move(next));
+    }
+
+    // worker only: swap in the next version
+    void publish_(std::vector<ledgr::HostDescriptor> hosts)
+    {
+        auto next = std::make_shared<Snapshot>();
+        next->version = snapshot()->version + 1;
+        next->hosts = std::move(hosts);
+        snap_.store(std::move(next), std::memory_order_release);
     }
 
     LedgerApiClient &client_;
-    std::vector<ledgr::HostDescriptor> cache_;
-    mutable std::shared_mutex mtx_;
+    const std::chrono::milliseconds watchWait_;
+    std::shared_ptr<Inbox> inbox_{std::make_shared<Inbox>(this)};
+    std::atomic<std::shared_ptr<const Snapshot>> snap_{std::make_shared<const Snapshot>()};
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Command> queue_;
+    std::unordered_map<Ticket, Op> ops_; // queued, running or done‑but‑unpolled
+    Ticket next_{1};
+    int refreshes_{0}; // refreshes queued or running
+    bool stopping_{false};
+
+    // worker only
+    uint64_t revision_{0}; // ledger revision of the cache; 0 = unknown / unversioned
+    bool watching_{false}; // a watch is parked on the daemon
+    std::chrono::milliseconds watchBackoff_{0};
+    std::optional<Clock::time_point> watchRetry_; // re‑watch after a failure
+
+    std::thread worker_;
 };
 
 #endif
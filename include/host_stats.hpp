@@ -0,0 +1,310 @@
+// host_stats.hpp — per‑host CPU / memory totals joined from the stats ledger
+// -----------------------------------------------------------------------------
+#ifndef CP_HOST_STATS_HPP
+#define CP_HOST_STATS_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "container_table.hpp"
+#include "host_descriptor.hpp"
+#include "stats_model.hpp"
+#include "string_utils.hpp"
+
+/**
+ * HostStats
+ * ---------
+ * Rolls the container ledger up to hosts for the Hosts window: container
+ * count, summed and maximum CPU and memory per host.
+ *
+ * Totals are kept per stats endpoint and maintained on ingest, from the loop
+ * in `StatsIngest::pump()` that merges the ledger: an update moves the
+ * endpoint's sums by the difference to the container's previous sample and
+ * repositions the container in two indexed max‑heaps (CPU, memory), so the
+ * maxima stay right when the top container cools down or goes away.  That is
+ * O(log n) per update and nothing per frame — no re‑join of hosts and
+ * containers while the table is drawn.
+ *
+ * Hosts come from `HostService` and are joined to endpoints by host name: the
+ * endpoint URI's host and `HostDescriptor::host`, each without scheme, user,
+ * port or path, compared case‑insensitively.  `set_hosts()` redoes that join
+ * when the host cache changes (O(hosts)); a host matching several endpoints
+ * (one node, several ports) reads as their sum.  A metric a container does
+ * not report counts as 0, as in the Stats table.
+ */
+class HostStats
+{
+public:
+    using Slot = ContainerTable::Slot;
+    using Source = ContainerTable::Source;
+
+    struct Totals
+    {
+        std::size_t containers{};
+        double cpu_sum{}; //!< sum of cpu_avg (1.0 = one core)
+        double cpu_max{};
+        uint64_t mem_sum{}; //!< bytes
+        uint64_t mem_max{};
+    };
+
+    explicit HostStats(const ContainerTable &ledger) noexcept : ledger_{ledger} {}
+
+    /** Register the next stats endpoint (source numbers count up from 0). */
+    void add_endpoint(std::string_view uri)
+    {
+        const auto source = static_cast<Source>(endpoints_.size());
+        auto &ep = endpoints_.emplace_back();
+        ep.key = join_key(uri);
+        byKey_[ep.key].push_back(source);
+    }
+
+    // ---------------------------------------------------------------------
+    // Ingest (UI thread, next to every ledger upsert / erase)
+    // ---------------------------------------------------------------------
+
+    /** Container in `slot` (of endpoint `source`) now reports `ts`. */
+    void update(Slot slot, Source source, const TimestampedStats &ts)
+    {
+        if (source >= endpoints_.size())
+            return;
+        grow_(slot);
+        if (source_[slot] != source)
+            erase(slot); // slot recycled for another endpoint's container
+
+        double cpu = ts.stats.cpu_avg.value_or(0.0);
+        if (!std::isfinite(cpu))
+            cpu = 0.0; // would break the heap order
+        const uint64_t mem = ts.stats.max_mem.value_or(0);
+        auto &ep = endpoints_[source];
+        if (source_[slot] == kNone)
+        {
+            source_[slot] = source;
+            ep.cpu_sum += cpu;
+            ep.mem_sum += mem;
+            ep.cpu.push(slot, cpu, cpuPos_);
+            ep.mem.push(slot, mem, memPos_);
+        }
+        else
+        {
+            ep.cpu_sum += cpu - cpu_[slot];
+            ep.mem_sum += mem - mem_[slot]; // unsigned wrap cancels out
+            ep.cpu.set(slot, cpu, cpuPos_);
+            ep.mem.set(slot, mem, memPos_);
+        }
+        cpu_[slot] = cpu;
+        mem_[slot] = mem;
+    }
+
+    /** Container in `slot` left the ledger. */
+    void erase(Slot slot)
+    {
+        if (slot >= source_.size() || source_[slot] == kNone)
+            return;
+        auto &ep = endpoints_[source_[slot]];
+        ep.cpu_sum -= cpu_[slot];
+        ep.mem_sum -= mem_[slot];
+        ep.cpu.remove(slot, cpuPos_);
+        ep.mem.remove(slot, memPos_);
+        if (ep.cpu.items.empty())
+            ep.cpu_sum = 0.0; // no drift carried over from the last container
+        source_[slot] = kNone;
+    }
+
+    // ---------------------------------------------------------------------
+    // Host join (UI thread)
+    // ---------------------------------------------------------------------
+
+    /** Join `hosts` (in their table order) to the endpoints. */
+    void set_hosts(const std::vector<ledgr::HostDescriptor> &hosts)
+    {
+        hosts_.resize(hosts.size());
+        for (std::size_t i = 0; i < hosts.size(); ++i)
+        {
+            hosts_[i].clear();
+            if (auto it = byKey_.find(join_key(hosts[i].host)); it != byKey_.end())
+                hosts_[i] = it->second;
+        }
+    }
+
+    /** Totals of host `i` (index into the vector given to `set_hosts()`). */
+    [[nodiscard]] Totals host(std::size_t i) const noexcept
+    {
+        Totals t;
+        if (i >= hosts_.size())
+            return t;
+        for (const Source s : hosts_[i])
+        {
+            const auto &ep = endpoints_[s];
+            t.containers += ep.cpu.items.size();
+            t.cpu_sum += std::max(ep.cpu_sum, 0.0);
+            t.mem_sum += ep.mem_sum;
+            t.cpu_max = std::max(t.cpu_max, ep.cpu.top());
+            t.mem_max = std::max(t.mem_max, ep.mem.top());
+        }
+        return t;
+    }
+
+    /** Whether host `i` has a stats endpoint at all. */
+    [[nodiscard]] bool joined(std::size_t i) const noexcept { return i < hosts_.size() && !hosts_[i].empty(); }
+
+    /** Append the slots of host `i`'s containers to `out` (no particular order). */
+    void containers(std::size_t i, std::vector<Slot> &out) const
+    {
+        if (i >= hosts_.size())
+            return;
+        for (const Source s : hosts_[i])
+            for (const auto &item : endpoints_[s].cpu.items)
+                out.push_back(item.slot);
+    }
+
+    [[nodiscard]] const ContainerTable &ledger() const noexcept { return ledger_; }
+
+    /**
+     * Host part of an endpoint URI or `HostDescriptor::host`, lowercased:
+     * "wss://Admin@Node-1.lan:4300/stats/ws" → "node-1.lan",
+     * "[fd00::1]:22" → "fd00::1".
+     */
+    static std::string join_key(std::string_view s)
+    {
+        if (auto p = s.find("://"); p != std::string_view::npos)
+            s.remove_prefix(p + 3);
+        s = s.substr(0, s.find_first_of("/?#"));
+        if (auto at = s.rfind('@'); at != std::string_view::npos)
+            s.remove_prefix(at + 1);
+        if (s.starts_with('['))
+            s = s.substr(1, s.find(']') - 1); // [v6]:port
+        else if (auto colon = s.find(':'); colon != std::string_view::npos && s.find(':', colon + 1) == std::string_view::npos)
+            s = s.substr(0, colon); // host:port, not a bare v6 address
+
+        std::string key{s};
+        std::ranges::transform(key, key.begin(), [](unsigned char c)
+                               { return static_cast<char>(std::tolower(c)); });
+        return key;
+    }
+
+private:
+    static constexpr Source kNone = ~Source{0};
+
+    // Max‑heap of one endpoint's containers by one metric.  `pos` is the
+    // slot‑indexed column of heap positions shared by all endpoints' heaps
+    // of that metric (a slot is in exactly one of them).
+    template <typename Key>
+    struct Heap
+    {
+        struct Item
+        {
+            Key key;
+            Slot slot;
+        };
+        std::vector<Item> items;
+
+        [[nodiscard]] Key top() const noexcept { return items.empty() ? Key{} : items.front().key; }
+
+        void push(Slot slot, Key key, std::vector<uint32_t> &pos)
+        {
+            items.push_back({key, slot});
+            pos[slot] = static_cast<uint32_t>(items.size() - 1);
+            up_(items.size() - 1, pos);
+        }
+
+        void set(Slot slot, Key key, std::vector<uint32_t> &pos)
+        {
+            const std::size_t i = pos[slot];
+            const Key old = std::exchange(items[i].key, key);
+            if (key > old)
+                up_(i, pos);
+            else if (key < old)
+                down_(i, pos);
+        }
+
+        void remove(Slot slot, std::vector<uint32_t> &pos)
+        {
+            const std::size_t i = pos[slot];
+            const Item last = items.back();
+            items.pop_back();
+            if (i == items.size())
+                return;
+            items[i] = last;
+            pos[last.slot] = static_cast<uint32_t>(i);
+            up_(i, pos);
+            down_(pos[last.slot], pos);
+        }
+
+    private:
+        void place_(std::size_t i, const Item &item, std::vector<uint32_t> &pos)
+        {
+            items[i] = item;
+            pos[item.slot] = static_cast<uint32_t>(i);
+        }
+
+        void up_(std::size_t i, std::vector<uint32_t> &pos)
+        {
+            const Item item = items[i];
+            while (i > 0 && items[(i - 1) / 2].key < item.key)
+            {
+                place_(i, items[(i - 1) / 2], pos);
+                i = (i - 1) / 2;
+            }
+            place_(i, item, pos);
+        }
+
+        void down_(std::size_t i, std::vector<uint32_t> &pos)
+        {
+            const Item item = items[i];
+            const std::size_t n = items.size();
+            for (std::size_t c = 2 * i + 1; c < n; c = 2 * i + 1)
+            {
+                if (c + 1 < n && items[c].key < items[c + 1].key)
+                    ++c;
+                if (!(item.key < items[c].key))
+                    break;
+                place_(i, items[c], pos);
+                i = c;
+            }
+            place_(i, item, pos);
+        }
+    };
+
+    struct Endpoint
+    {
+        std::string key; // join_key() of the URI
+        double cpu_sum{};
+        uint64_t mem_sum{};
+        Heap<double> cpu;
+        Heap<uint64_t> mem;
+    };
+
+    void grow_(Slot slot)
+    {
+        if (slot < source_.size())
+            return;
+        const std::size_t n = std::max<std::size_t>(slot + 1, source_.size() * 2);
+        source_.resize(n, kNone);
+        cpu_.resize(n);
+        mem_.resize(n);
+        cpuPos_.resize(n);
+        memPos_.resize(n);
+    }
+
+    const ContainerTable &ledger_;
+    std::vector<Endpoint> endpoints_; // by source
+    std::unordered_map<std::string, std::vector<Source>, util::string_hash, std::equal_to<>> byKey_;
+    std::vector<std::vector<Source>> hosts_; // host index → its endpoints
+
+    // slot‑indexed columns
+    std::vector<Source> source_; // kNone if not tracked
+    std::vector<double> cpu_;    // value summed into the endpoint
+    std::vector<uint64_t> mem_;
+    std::vector<uint32_t> cpuPos_; // position in the endpoint's cpu heap
+    std::vector<uint32_t> memPos_;
+};
+
+#endif
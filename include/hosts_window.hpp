@@ -4,21 +4,41 @@
 // Dear ImGui
 #include <imgui.h>
 
+#include <algorithm>
+#include <cinttypes>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <vector>
 
+#include "host_index.hpp"   // trigram index behind the filter box
 #include "host_service.hpp" // service façade for daemon access
+#include "host_stats.hpp"   // per‑host container totals (optional)
 
 /**
  * HostsWindow — immediate‑mode widget that shows the Hosts / Nodes table and an
  * “Add Host” modal.  Keep UI‑only state inside this class; all persistence and
  * daemon I/O is delegated to HostService.
+ *
+ * Given the `HostStats` rollup of the stats ledger, the table also shows each
+ * host's container count and CPU / memory totals and maxima; selecting a host
+ * lists its containers in a pane under the table.
+ *
+ * Hosts can also be imported in bulk from a CSV/JSON file, with live progress
+ * and the rejected rows listed afterwards, and the list exported to one.
+ *
+ * Sized for ledgers of 100k hosts: the filter is answered from a `HostIndex`
+ * rebuilt only when the host list version changes, the filtered rows are
+ * recomputed only when the list or the filter text changes, and the table is
+ * clipped to the rows on screen.
  */
 class HostsWindow
 {
 public:
-    explicit HostsWindow(HostService &service) noexcept : svc_{service} {}
+    explicit HostsWindow(HostService &service, HostStats *stats = nullptr) noexcept
+        : svc_{service}, stats_{stats} {}
 
     /**
      * Draw the window. Call once per frame from the main event‑loop. The
@@ -41,12 +61,16 @@ public:
         }
 
         // --- Filter box --------------------------------------------------------------
-        if (ImGui::InputTextWithHint("##filter", "filter by name / host…",
+        if (ImGui::InputTextWithHint("##filter", "filter by id / name / host…",
                                      filterBuf_, sizeof(filterBuf_)))
         {
             dirtyFilter_ = true;
         }
 
+        // --- Refresh (runs on the service's worker; we only poll) ----------------------
+        ImGui::SameLine();
+        drawRefresh_();
+
         ImGui::Separator();
         drawTable_();
 
@@ -58,7 +82,16 @@ public:
             ImGui::OpenPopup("AddHostPopup");
         }
 
+        // --- Bulk import / export ------------------------------------------------------
+        ImGui::SameLine();
+        if (ImGui::Button("Import…"))
+            openFileModal_(FileOp::Import);
+        ImGui::SameLine();
+        if (ImGui::Button("Export…"))
+            openFileModal_(FileOp::Export);
+
         drawAddHostModal_();
+        drawFileModal_();
 
         ImGui::End();
     }
@@ -70,43 +103,219 @@ private:
 
     inline void drawTable_()
     {
-        // Fetch (and cache) hosts each frame.  The service might be polling the
-        // daemon in the background or caching internally; here we just call its
-        // accessor.
-        const auto &hosts = svc_.listHosts();
+        // Hold this frame's version of the list; the service may publish the
+        // next one meanwhile without disturbing us.
+        const auto snap = svc_.snapshot();
+        const auto &hosts = snap->hosts;
 
-        // Simple client‑side filter on name or host string -----------------------
-        auto matchesFilter = [&](const ledgr::HostDescriptor &h)
+        // The index (and the stats join) follow the list version; the rows
+        // passing the filter are re‑queried only when either side changed.
+        if (snap->version != viewVersion_)
+        {
+            index_.build(hosts);
+            if (stats_)
+                stats_->set_hosts(hosts);
+            select_(hosts); // the selected host may have moved or gone
+            viewVersion_ = snap->version;
+            dirtyFilter_ = true;
+        }
+        if (dirtyFilter_)
         {
-            if (!dirtyFilter_)
-                return true; // no filter text entered
-            const std::string needle{filterBuf_};
-            return h.name.find(needle) != std::string::npos ||
-                   h.host.find(needle) != std::string::npos;
-        };
+            index_.query(filterBuf_, visible_);
+            dirtyFilter_ = false;
+        }
 
-        if (ImGui::BeginTable("HostLedger", 3,
-                              ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+        // Fill the window down to the row count and Add Host button, less the
+        // container pane of a selected host.
+        const float line = ImGui::GetTextLineHeightWithSpacing();
+        const bool drill = stats_ && selected_ && stats_->joined(*selected_);
+        float reserve = line + ImGui::GetFrameHeightWithSpacing();
+        if (drill)
+            reserve += (kDrillRows + 2) * line;
+
+        const int columns = stats_ ? 8 : 3;
+        if (ImGui::BeginTable("HostLedger", columns,
+                              ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY,
+                              ImVec2(0.f, -reserve)))
         {
+            ImGui::TableSetupScrollFreeze(0, 1);
             ImGui::TableSetupColumn("ID");
             ImGui::TableSetupColumn("Name");
             ImGui::TableSetupColumn("Host");
+            if (stats_)
+            {
+                ImGui::TableSetupColumn("Containers");
+                ImGui::TableSetupColumn("CPU total");
+                ImGui::TableSetupColumn("CPU max");
+                ImGui::TableSetupColumn("Mem total");
+                ImGui::TableSetupColumn("Mem max");
+            }
             ImGui::TableHeadersRow();
 
-            for (const auto &h : hosts)
+            // fixed‑height rows, so only the ones on screen are submitted
+            ImGuiListClipper clip;
+            clip.Begin(static_cast<int>(visible_.size()));
+            while (clip.Step())
+            {
+                for (int r = clip.DisplayStart; r < clip.DisplayEnd; ++r)
+                {
+                    const std::size_t i = visible_[r];
+                    const auto &h = hosts[i];
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    if (stats_ && stats_->joined(i))
+                    {
+                        // a click selects the host for the container pane below
+                        ImGui::PushID(static_cast<int>(i));
+                        if (ImGui::Selectable(h.id.c_str(), selected_ == i, ImGuiSelectableFlags_SpanAllColumns))
+                        {
+                            const bool was = selected_ == i;
+                            selected_.reset();
+                            selectedId_.clear();
+                            if (!was)
+                            {
+                                selected_ = i;
+                                selectedId_ = h.id;
+                            }
+                        }
+                        ImGui::PopID();
+                    }
+                    else
+                    {
+                        ImGui::TextUnformatted(h.id.c_str());
+                    }
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::TextUnformatted(h.name.c_str());
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::TextUnformatted(h.host.c_str());
+
+                    if (stats_ && stats_->joined(i))
+                    {
+                        const auto t = stats_->host(i);
+                        ImGui::TableSetColumnIndex(3);
+                        ImGui::Text("%zu", t.containers);
+                        ImGui::TableSetColumnIndex(4);
+                        ImGui::Text("%.1f %%", t.cpu_sum * 100.0);
+                        ImGui::TableSetColumnIndex(5);
+                        ImGui::Text("%.1f %%", t.cpu_max * 100.0);
+                        ImGui::TableSetColumnIndex(6);
+                        ImGui::Text("%" PRIu64 " MiB", t.mem_sum >> 20);
+                        ImGui::TableSetColumnIndex(7);
+                        ImGui::Text("%" PRIu64 " MiB", t.mem_max >> 20);
+                    }
+                }
+            }
+            ImGui::EndTable();
+        }
+        ImGui::Text("%zu of %zu hosts", visible_.size(), hosts.size());
+
+        if (drill)
+            drawContainers_(hosts[*selected_]);
+    }
+
+    // re‑find the selected host by id in a new version of the list
+    inline void select_(const std::vector<ledgr::HostDescriptor> &hosts)
+    {
+        selected_.reset();
+        if (selectedId_.empty())
+            return;
+        for (std::size_t i = 0; i < hosts.size(); ++i)
+        {
+            if (hosts[i].id == selectedId_)
             {
-                if (!matchesFilter(h))
-                    continue;
+                selected_ = i;
+                return;
+            }
+        }
+        selectedId_.clear();
+    }
+
+    // containers of the selected host, busiest first
+    inline void drawContainers_(const ledgr::HostDescriptor &h)
+    {
+        const auto &ledger = stats_->ledger();
+        drill_.clear();
+        stats_->containers(*selected_, drill_);
+        std::ranges::sort(drill_, [&](HostStats::Slot a, HostStats::Slot b)
+                          { return ledger.stats(a).stats.cpu_avg.value_or(0.0) >
+                                   ledger.stats(b).stats.cpu_avg.value_or(0.0); });
+
+        ImGui::Text("Containers on %s", h.name.empty() ? h.id.c_str() : h.name.c_str());
+        if (!ImGui::BeginTable("HostContainers", 3,
+                               ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY,
+                               ImVec2(0.f, kDrillRows * ImGui::GetTextLineHeightWithSpacing())))
+            return;
+
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Container");
+        ImGui::TableSetupColumn("CPU");
+        ImGui::TableSetupColumn("Memory");
+        ImGui::TableHeadersRow();
 
+        ImGuiListClipper clip;
+        clip.Begin(static_cast<int>(drill_.size()));
+        while (clip.Step())
+        {
+            for (int r = clip.DisplayStart; r < clip.DisplayEnd; ++r)
+            {
+                const auto slot = drill_[r];
+                const auto &ts = ledger.stats(slot);
+                const auto id = ledger.id(slot);
                 ImGui::TableNextRow();
                 ImGui::TableSetColumnIndex(0);
-                ImGui::TextUnformatted(h.id.c_str());
+                ImGui::TextUnformatted(id.data(), id.data() + id.size());
                 ImGui::TableSetColumnIndex(1);
-                ImGui::TextUnformatted(h.name.c_str());
+                ImGui::Text("%.1f %%", ts.stats.cpu_avg.value_or(0.0) * 100.0);
                 ImGui::TableSetColumnIndex(2);
-                ImGui::TextUnformatted(h.host.c_str());
+                ImGui::Text("%" PRIu64 " MiB", ts.stats.max_mem.value_or(0) >> 20);
             }
-            ImGui::EndTable();
+        }
+        ImGui::EndTable();
+    }
+
+    // text spinner for operations in flight, advanced by wall time not frames
+    static const char *spinner_()
+    {
+        static constexpr const char *kFrames[] = {"|", "/", "-", "\\"};
+        return kFrames[static_cast<int>(ImGui::GetTime() * 8.0) % 4];
+    }
+
+    inline void drawRefresh_()
+    {
+        if (refreshTicket_)
+        {
+            if (auto res = svc_.poll(*refreshTicket_))
+            {
+                refreshTicket_.reset();
+                refreshError_ = res->has_value() ? std::string{} : std::move(res->error());
+            }
+        }
+
+        if (refreshTicket_)
+        {
+            ImGui::Text("%s refreshing", spinner_());
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Cancel##refresh"))
+            {
+                svc_.cancel(*refreshTicket_);
+                refreshTicket_.reset();
+            }
+        }
+        else if (svc_.refreshing())
+        {
+            ImGui::Text("%s loading hosts", spinner_()); // the service's own initial load
+        }
+        else if (ImGui::SmallButton("Refresh"))
+        {
+            refreshTicket_ = svc_.refresh();
+            refreshError_.clear();
+        }
+
+        if (!refreshError_.empty())
+        {
+            ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 80, 80, 255));
+            ImGui::Text("refresh failed: %s", refreshError_.c_str());
+            ImGui::PopStyleColor();
         }
     }
 
@@ -123,26 +332,45 @@ private:
             ImGui::InputText("Name", &d.name);
             ImGui::InputText("Host", &d.host);
 
-            bool ok = ImGui::Button("Add");
-            ImGui::SameLine();
-            bool canc = ImGui::Button("Cancel");
-
-            if (ok)
+            // result of a submitted add, if it arrived
+            if (addTicket_)
             {
-                auto res = svc_.addHost(d);
-                if (res)
+                if (auto res = svc_.poll(*addTicket_))
                 {
-                    modalOpen_ = false; // close on success
+                    addTicket_.reset();
+                    if (res->has_value())
+                        modalOpen_ = false; // close on success
+                    else
+                        errorMessage_ = std::move(res->error());
                 }
-                else
+            }
+
+            if (addTicket_)
+            {
+                // in flight: the form stays up, frames keep coming
+                ImGui::Text("%s adding…", spinner_());
+                ImGui::SameLine();
+                if (ImGui::Button("Cancel"))
                 {
-                    // Show error tooltip next frame (simplest UX)
-                    errorMessage_ = std::move(res.error());
+                    svc_.cancel(*addTicket_);
+                    addTicket_.reset();
                 }
             }
-            else if (canc)
+            else
             {
-                modalOpen_ = false;
+                bool ok = ImGui::Button("Add");
+                ImGui::SameLine();
+                bool canc = ImGui::Button("Cancel");
+
+                if (ok)
+                {
+                    addTicket_ = svc_.addHost(d);
+                    errorMessage_.clear();
+                }
+                else if (canc)
+                {
+                    modalOpen_ = false;
+                }
             }
 
             if (!errorMessage_.empty())
@@ -152,25 +380,178 @@ private:
                 ImGui::PopStyleColor();
             }
 
-            if (!modalOpen_)
+            ImGui::EndPopup();
+        }
+
+        if (!modalOpen_) // closed this frame: by success, Cancel or the title‑bar X
+        {
+            if (addTicket_)
+                svc_.cancel(*addTicket_);
+            addTicket_.reset();
+            draft_.reset();
+            errorMessage_.clear();
+        }
+    }
+
+    enum class FileOp
+    {
+        Import,
+        Export,
+    };
+
+    inline void openFileModal_(FileOp op)
+    {
+        fileOp_ = op;
+        fileOpen_ = true;
+        fileMessage_.clear();
+        transfer_.reset();
+        ImGui::OpenPopup("HostFilePopup");
+    }
+
+    inline void drawFileModal_()
+    {
+        if (!fileOpen_)
+            return;
+
+        if (ImGui::BeginPopupModal("HostFilePopup", &fileOpen_))
+        {
+            const bool import = fileOp_ == FileOp::Import;
+            ImGui::TextUnformatted(import ? "Import hosts (.csv: id,name,host — or .json)"
+                                          : "Export hosts (.csv or .json)");
+            ImGui::InputText("File", &filePath_);
+
+            if (fileTicket_)
             {
-                draft_.reset();
-                errorMessage_.clear();
+                if (auto res = svc_.poll(*fileTicket_))
+                {
+                    fileTicket_.reset();
+                    fileFailed_ = !res->has_value();
+                    if (fileFailed_)
+                        fileMessage_ = std::move(res->error());
+                    else if (import)
+                        fileMessage_ = std::to_string(transfer_->total - transfer_->failed) + " of " +
+                                       std::to_string(transfer_->total) + " hosts imported";
+                    else
+                        fileMessage_ = "exported to " + filePath_;
+                }
             }
 
+            if (fileTicket_)
+            {
+                if (import)
+                    ImGui::Text("%s importing %zu / %zu, %zu failed", spinner_(), transfer_->done.load(),
+                                transfer_->total.load(), transfer_->failed.load());
+                else
+                    ImGui::Text("%s exporting…", spinner_());
+                ImGui::SameLine();
+                if (ImGui::Button("Cancel"))
+                {
+                    svc_.cancel(*fileTicket_); // creates already made stay
+                    fileTicket_.reset();
+                    transfer_.reset(); // still being written by the worker
+                    fileMessage_ = "cancelled";
+                    fileFailed_ = true;
+                }
+            }
+            else
+            {
+                if (ImGui::Button(import ? "Import" : "Export") && !filePath_.empty())
+                {
+                    fileMessage_.clear();
+                    if (import)
+                        std::tie(fileTicket_, transfer_) = svc_.importHosts(filePath_);
+                    else
+                        fileTicket_ = svc_.exportHosts(filePath_);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Close"))
+                    fileOpen_ = false;
+            }
+
+            if (!fileMessage_.empty())
+            {
+                if (fileFailed_)
+                    ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 80, 80, 255));
+                ImGui::TextUnformatted(fileMessage_.c_str());
+                if (fileFailed_)
+                    ImGui::PopStyleColor();
+            }
+
+            // rejected rows, once the import is over (the worker owns them until then)
+            if (!fileTicket_ && transfer_ && !transfer_->errors.empty())
+                drawImportErrors_(transfer_->errors);
+
             ImGui::EndPopup();
         }
+
+        if (!fileOpen_) // closed this frame
+        {
+            if (fileTicket_)
+                svc_.cancel(*fileTicket_);
+            fileTicket_.reset();
+            transfer_.reset();
+            fileMessage_.clear();
+        }
+    }
+
+    static void drawImportErrors_(const std::vector<HostFile::RowError> &errors)
+    {
+        const float rows = static_cast<float>(std::min<std::size_t>(errors.size(), kDrillRows) + 1);
+        if (!ImGui::BeginTable("ImportErrors", 2,
+                               ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY,
+                               ImVec2(0.f, rows * ImGui::GetTextLineHeightWithSpacing())))
+            return;
+
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Line");
+        ImGui::TableSetupColumn("Error");
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clip;
+        clip.Begin(static_cast<int>(errors.size()));
+        while (clip.Step())
+        {
+            for (int r = clip.DisplayStart; r < clip.DisplayEnd; ++r)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%zu", errors[r].line);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::TextUnformatted(errors[r].message.c_str());
+            }
+        }
+        ImGui::EndTable();
     }
 
 private:
     HostService &svc_;
+    HostStats *stats_; //!< null when there are no stats endpoints
+    static constexpr int kDrillRows = 8; //!< height of the container pane
+
+    HostIndex index_;                       //!< filter index over the current version
+    uint64_t viewVersion_{~uint64_t{0}};    //!< host list version index_ was built from
+    std::vector<std::size_t> visible_;      //!< indices of hosts passing the filter
+    std::optional<std::size_t> selected_;   //!< host whose containers are listed
+    std::string selectedId_;                //!< its id, to find it again in a new version
+    std::vector<HostStats::Slot> drill_;    //!< scratch: containers of the selected host
 
     // Transient UI state ----------------------------------------------------------
     std::optional<ledgr::HostDescriptor> draft_{}; //!< form under construction
     bool modalOpen_{false};
-    bool dirtyFilter_{false};
+    bool dirtyFilter_{false};  //!< filter text changed since visible_ was built
     char filterBuf_[64]{};     //!< small fixed buffer is fine here
     std::string errorMessage_; //!< last add‑host error (if any)
+    std::optional<HostService::Ticket> addTicket_;     //!< add in flight
+    std::optional<HostService::Ticket> refreshTicket_; //!< refresh in flight
+    std::string refreshError_;                         //!< last refresh error (if any)
+
+    FileOp fileOp_{FileOp::Import};
+    bool fileOpen_{false};
+    std::string filePath_;                            //!< kept between uses of the dialog
+    std::optional<HostService::Ticket> fileTicket_;   //!< import / export in flight
+    std::shared_ptr<const HostService::Transfer> transfer_; //!< progress of the last import
+    std::string fileMessage_;                         //!< result line under the form
+    bool fileFailed_{false};
 };
 
 #endif
@@ -0,0 +1,135 @@
+// latency_histogram.hpp — log‑bucketed (HDR‑style) latency histogram
+// -----------------------------------------------------------------------------
+#ifndef CP_LATENCY_HISTOGRAM_HPP
+#define CP_LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * LatencyHistogram
+ * ----------------
+ * Counts microsecond latencies in log‑linear buckets, the layout HdrHistogram
+ * uses: values below 32 µs get a bucket each, and every power of two above
+ * that is split into 32 equal sub‑buckets, so any recorded value is known to
+ * within ~3 %.  Values from 1 µs up to 2^40 µs (~12 days) fit in 1 152
+ * buckets; larger ones land in the last bucket.
+ *
+ * `record()` is one relaxed atomic increment (plus a CAS loop for the max
+ * when a new maximum shows up), so ingest threads record while the UI thread
+ * reads `snapshot()`s without any lock.  A snapshot taken mid‑update may be
+ * off by the few samples in flight.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned kSubBits = 5;
+    static constexpr uint64_t kSub = uint64_t{1} << kSubBits;
+    static constexpr unsigned kMaxBits = 40;
+    static constexpr std::size_t kBuckets = (kMaxBits - kSubBits + 1) * kSub;
+
+    /** Plain copy of the counters, for reading and merging. */
+    struct Snapshot
+    {
+        std::array<uint64_t, kBuckets> counts{};
+        uint64_t total{};
+        uint64_t sum{};
+        uint64_t max{};
+
+        void merge(const Snapshot &o) noexcept
+        {
+            for (std::size_t i = 0; i < kBuckets; ++i)
+                counts[i] += o.counts[i];
+            total += o.total;
+            sum += o.sum;
+            max = std::max(max, o.max);
+        }
+
+        [[nodiscard]] double mean() const noexcept
+        {
+            return total ? static_cast<double>(sum) / static_cast<double>(total) : 0.0;
+        }
+
+        /** Smallest value v with at least `q` of the samples ≤ v (upper
+         *  edge of the bucket, never above `max`); 0 if empty. */
+        [[nodiscard]] uint64_t percentile(double q) const noexcept
+        {
+            if (total == 0)
+                return 0;
+            const auto rank = static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(total - 1)) + 1;
+            uint64_t seen = 0;
+            for (std::size_t i = 0; i < kBuckets; ++i)
+            {
+                seen += counts[i];
+                if (seen >= rank)
+                    return std::min(upper_(i), max);
+            }
+            return max;
+        }
+    };
+
+    void record(uint64_t us) noexcept
+    {
+        counts_[index_(us)].fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(us, std::memory_order_relaxed);
+        uint64_t m = max_.load(std::memory_order_relaxed);
+        while (us > m && !max_.compare_exchange_weak(m, us, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    [[nodiscard]] Snapshot snapshot() const noexcept
+    {
+        Snapshot s;
+        for (std::size_t i = 0; i < kBuckets; ++i)
+            s.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        s.total = total_.load(std::memory_order_relaxed);
+        s.sum = sum_.load(std::memory_order_relaxed);
+        s.max = max_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    [[nodiscard]] uint64_t count() const noexcept { return total_.load(std::memory_order_relaxed); }
+
+    void reset() noexcept
+    {
+        for (auto &c : counts_)
+            c.store(0, std::memory_order_relaxed);
+        total_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static std::size_t index_(uint64_t v) noexcept
+    {
+        if (v < kSub)
+            return static_cast<std::size_t>(v);
+        const unsigned msb = static_cast<unsigned>(std::bit_width(v)) - 1;
+        if (msb >= kMaxBits)
+            return kBuckets - 1;
+        const unsigned shift = msb - kSubBits;
+        return static_cast<std::size_t>((shift + 1) * kSub + ((v >> shift) - kSub));
+    }
+
+    // largest value that maps to bucket i
+    static uint64_t upper_(std::size_t i) noexcept
+    {
+        if (i < kSub)
+            return i;
+        const uint64_t shift = i / kSub - 1;
+        return ((kSub + i % kSub + 1) << shift) - 1;
+    }
+
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+    std::atomic<uint64_t> total_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+#endif
@@ -0,0 +1,147 @@
+// stats_aggregator.hpp — many stats WebSocket endpoints on a few epoll threads
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_AGGREGATOR_HPP
+#define CP_STATS_AGGREGATOR_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dns_cache.hpp"
+#include "stats_binary_decoder.hpp"
+#include "stats_latency.hpp"
+#include "stats_mailbox.hpp"
+
+class StatsRecorder;
+
+/** "ws://node-1:4000/stats/ws" → "node-1:4000", for tables and labels. */
+inline std::string_view stats_endpoint_label(std::string_view uri) noexcept
+{
+    if (auto p = uri.find("://"); p != std::string_view::npos)
+        uri.remove_prefix(p + 3);
+    return uri.substr(0, uri.find('/'));
+}
+
+/**
+ * StatsAggregator
+ * ---------------
+ * Keeps one WebSocket connection (ws:// or wss://) per stats endpoint and
+ * multiplexes all of them on `Options::threads` event‑loop threads, each
+ * driving its share of the connections with non‑blocking sockets and epoll.
+ *
+ * Every endpoint has its own `StatsMailbox`, so a full snapshot from one node
+ * only reconciles that node's containers; the consumer drains the mailboxes
+ * and keys its ledger by (endpoint index, container ID).  `health()` reports
+ * per‑endpoint connection state, traffic and the last error.
+ *
+ * Reconnects are cheap for both sides:
+ *   - resolved addresses are cached for `Options::dns_ttl` (shared by all
+ *     loops); a failed connect moves on to the next address, and once
+ *     all of them failed the name is resolved again;
+ *   - one TLS context lives for the whole process and every endpoint keeps
+ *     its last session, so reconnects resume instead of doing a full
+ *     handshake;
+ *   - read/write buffers and decoders belong to the endpoint and survive
+ *     reconnects with their capacity;
+ *   - retries back off exponentially from `backoff_initial` to `backoff_max`
+ *     with jitter, so consoles that lost the same server do not come back
+ *     in lock‑step.
+ * A cache miss still resolves with a blocking getaddrinfo() on the loop.
+ *
+ * With `Options::record_dir` set, every batch applied to a mailbox is also
+ * teed into a `StatsRecorder`.  With `Options::replay_dir` set, nothing is
+ * connected: the endpoints are the ones in the recording, and a replay
+ * thread feeds their mailboxes from it at `replay_speed`, so the consumer
+ * cannot tell a past incident from a live fleet.  That constructor throws if
+ * the recording cannot be opened.
+ */
+class StatsAggregator
+{
+public:
+    struct Options
+    {
+        std::size_t threads = 1; //!< event‑loop threads (capped at endpoint count)
+        StatsEncoding encoding = StatsEncoding::Cbor;
+        bool delta = true;       //!< request delta frames after the handshake
+        std::chrono::milliseconds connect_timeout{5'000};
+        std::chrono::milliseconds idle_timeout{65'000};
+        std::chrono::milliseconds backoff_initial{1'000};
+        std::chrono::milliseconds backoff_max{30'000};
+        std::chrono::seconds dns_ttl{60};
+
+        std::string record_dir;      //!< tee applied batches here (empty = off)
+        std::string replay_dir;      //!< replay this recording instead of connecting
+        double replay_speed = 1.0;   //!< 1 = real time, 0 = as fast as the disk allows
+        uint64_t replay_from_ms = 0; //!< wall clock to start at (0 = beginning)
+    };
+
+    enum class State
+    {
+        Connecting,  //!< TCP connect / TLS / WebSocket handshake in progress
+        Open,        //!< receiving frames
+        Backoff,     //!< waiting to reconnect
+        Replay,      //!< fed from a recording
+    };
+
+    struct Health
+    {
+        State state{State::Connecting};
+        std::string subprotocol;  //!< negotiated encoding, empty if none
+        std::string last_error;
+        uint64_t frames{};        //!< data frames received
+        uint64_t bytes{};         //!< payload bytes received
+        uint64_t bad_frames{};    //!< frames that failed to decode
+        uint64_t gaps{};          //!< delta sequence gaps (→ resubscribe)
+        uint64_t connects{};      //!< completed handshakes
+        uint64_t failures{};      //!< attempts that failed or connections lost
+        uint64_t last_frame_ms{}; //!< wall clock of the last frame, 0 = never
+
+        uint64_t attempts{};      //!< connection attempts started
+        uint32_t retry{};         //!< consecutive failed attempts, 0 once data flows
+        uint64_t dns_cached{};    //!< attempts that skipped getaddrinfo()
+        uint64_t tls_resumed{};   //!< TLS handshakes that resumed a session
+        uint64_t connect_ms{};    //!< last successful attempt: start → open
+        uint64_t reconnect_ms{};  //!< last outage: connection lost → open again
+    };
+
+    explicit StatsAggregator(std::vector<std::string> uris)
+        : StatsAggregator(std::move(uris), Options{}) {}
+    StatsAggregator(std::vector<std::string> uris, Options opt);
+    ~StatsAggregator();
+
+    StatsAggregator(const StatsAggregator &) = delete;
+    StatsAggregator &operator=(const StatsAggregator &) = delete;
+
+    /** Spawn the event‑loop threads. */
+    void start();
+    /** Close every connection and join the threads; idempotent. */
+    void stop();
+
+    [[nodiscard]] std::size_t size() const noexcept { return endpoints_.size(); }
+    [[nodiscard]] const std::string &uri(std::size_t endpoint) const;
+    [[nodiscard]] StatsMailbox &mailbox(std::size_t endpoint);
+    /** Per‑stage latency of the endpoint's frames; the consumer records the
+     *  stages after the mailbox. */
+    [[nodiscard]] StatsLatency &latency(std::size_t endpoint);
+    [[nodiscard]] Health health(std::size_t endpoint) const;
+
+    [[nodiscard]] static const char *state_name(State state) noexcept;
+
+private:
+    struct Endpoint;
+    class Worker;
+    class Replayer;
+
+    Options opt_;
+    DnsCache dns_;
+    std::vector<std::unique_ptr<Endpoint>> endpoints_;
+    std::unique_ptr<StatsRecorder> recorder_; // outlives the workers feeding it
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::unique_ptr<Replayer> replayer_;
+};
+
+#endif
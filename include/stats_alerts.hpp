@@ -0,0 +1,470 @@
+// stats_alerts.hpp — incremental threshold alerts over container stats
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_ALERTS_HPP
+#define CP_STATS_ALERTS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "stats_model.hpp"
+#include "string_utils.hpp"
+
+/**
+ * StatsAlerts
+ * -----------
+ * Evaluates threshold rules such as
+ *
+ *     cpu_avg > 0.9 for 60s
+ *     big = max_mem >= 8GiB clear 7GiB
+ *
+ * against every merged container update (not every UI frame) and keeps a
+ * small state machine per (container, rule):
+ *
+ *     ok ──holds──▶ pending ──held `for`──▶ firing ──clear──▶ ok
+ *                     └──────no longer holds──────▶ ok
+ *
+ * Firing alerts clear only once the value passes the rule's `clear` level
+ * (by default 5 % on the safe side of the threshold), so a value hovering at
+ * the threshold does not flap.  `for` durations are measured in sample
+ * timestamps; a sample older than the one that started them restarts them.
+ *
+ * Cost per update is independent of the rule count in the steady state:
+ * rules are indexed per metric and direction by threshold, so an update only
+ * visits the rules whose threshold lies between the container's previous and
+ * new value, plus the container's own pending/firing alerts.  Containers
+ * with nothing active keep no per‑rule state at all.
+ *
+ * Raise and clear transitions are reported to the caller's sink as `Event`s;
+ * `firing()` is the dense list of currently firing alerts for display.
+ */
+class StatsAlerts
+{
+public:
+    using Slot = uint32_t;
+
+    enum class Metric : uint8_t
+    {
+        Cpu, //!< `cpu_avg`, a fraction (1.0 = 100 %)
+        Mem, //!< `max_mem`, bytes
+    };
+
+    enum class Op : uint8_t
+    {
+        Gt,
+        Ge,
+        Lt,
+        Le,
+    };
+
+    struct Rule
+    {
+        std::string name;
+        Metric metric{Metric::Cpu};
+        Op op{Op::Gt};
+        double threshold{};
+        double clear{};     //!< firing clears once the value is past this
+        uint64_t for_ms{};  //!< how long the condition must hold
+
+        [[nodiscard]] bool rising() const noexcept { return op == Op::Gt || op == Op::Ge; }
+
+        [[nodiscard]] bool holds(double v) const noexcept
+        {
+            switch (op)
+            {
+            case Op::Gt:
+                return v > threshold;
+            case Op::Ge:
+                return v >= threshold;
+            case Op::Lt:
+                return v < threshold;
+            default:
+                return v <= threshold;
+            }
+        }
+
+        [[nodiscard]] bool cleared(double v) const noexcept
+        {
+            return rising() ? v < clear : v > clear;
+        }
+
+        /**
+         * `[name =] metric op value [for duration] [clear value]`
+         * metric: cpu_avg (fraction or percent, "90%") | max_mem (bytes,
+         * KiB/MiB/GiB/TiB or KB/MB/GB/TB); op: > >= < <=; duration: N[s|m|h];
+         * a `clear` level must lie on the safe side of the threshold.
+         */
+        static std::expected<Rule, std::string> parse(std::string_view text);
+    };
+
+    struct Event
+    {
+        std::size_t rule;
+        Slot slot;
+        bool raised; //!< false: cleared
+        double value;
+        uint64_t at_ms;
+    };
+
+    struct Firing
+    {
+        Slot slot;
+        uint32_t rule;
+        uint64_t since_ms;
+        double value; //!< latest value while firing
+    };
+
+    struct Metrics
+    {
+        uint64_t updates{};   //!< container updates evaluated
+        uint64_t visits{};    //!< (container, rule) pairs looked at
+        uint64_t raised{};
+        uint64_t cleared{};
+    };
+
+    explicit StatsAlerts(std::vector<Rule> rules = {}) : rules_{std::move(rules)}
+    {
+        for (uint32_t r = 0; r < rules_.size(); ++r)
+            index_for_(rules_[r]).push_back({rules_[r].threshold, r});
+        for (auto &idx : index_)
+            std::sort(idx.begin(), idx.end());
+    }
+
+    /** Evaluate one merged update; `sink(const Event &)` sees transitions. */
+    template <typename Sink>
+    void update(Slot slot, const TimestampedStats &ts, Sink &&sink)
+    {
+        if (rules_.empty())
+            return;
+        if (slot >= prev_.size())
+        {
+            const std::size_t n = std::max<std::size_t>(slot + 1, prev_.size() * 2);
+            prev_.resize(n, {kNone, kNone});
+            active_.resize(n);
+        }
+        ++metrics_.updates;
+
+        const uint64_t at = stats_timestamp_ms(ts.timestamp);
+        const double values[2] = {ts.stats.cpu_avg ? *ts.stats.cpu_avg : kNone,
+                                  ts.stats.max_mem ? static_cast<double>(*ts.stats.max_mem) : kNone};
+
+        // 1. rules whose threshold the value just crossed into → pending
+        for (std::size_t m = 0; m < 2; ++m)
+        {
+            const double v = values[m];
+            if (std::isnan(v))
+                continue;
+            const double old = prev_[slot][m];
+            prev_[slot][m] = v;
+            enter_(slot, index_[m * 2], v, old, true, at);     // rising rules
+            enter_(slot, index_[m * 2 + 1], v, old, false, at); // falling rules
+        }
+
+        // 2. this container's pending / firing alerts
+        auto &act = active_[slot];
+        for (std::size_t i = 0; i < act.size();)
+        {
+            ++metrics_.visits;
+            Active &a = act[i];
+            const Rule &rule = rules_[a.rule];
+            const double v = values[static_cast<std::size_t>(rule.metric)];
+            if (std::isnan(v))
+            {
+                ++i;
+                continue;
+            }
+
+            if (a.firing)
+            {
+                if (rule.cleared(v))
+                {
+                    sink(Event{a.rule, slot, false, v, at});
+                    ++metrics_.cleared;
+                    drop_(slot, i);
+                    continue;
+                }
+                firing_[a.pos].value = v;
+            }
+            else if (!rule.holds(v))
+            {
+                drop_(slot, i); // pending, never held long enough
+                continue;
+            }
+            else if (at < a.since_ms)
+            {
+                a.since_ms = at; // time went backwards (clock step, replay): start over
+            }
+            else if (at - a.since_ms >= rule.for_ms)
+            {
+                a.firing = true;
+                a.pos = static_cast<uint32_t>(firing_.size());
+                firing_.push_back({slot, a.rule, at, v});
+                sink(Event{a.rule, slot, true, v, at});
+                ++metrics_.raised;
+            }
+            ++i;
+        }
+    }
+
+    /** The container left the ledger: its firing alerts clear. */
+    template <typename Sink>
+    void forget(Slot slot, uint64_t at_ms, Sink &&sink)
+    {
+        if (slot >= active_.size())
+            return;
+        auto &act = active_[slot];
+        while (!act.empty())
+        {
+            if (act.back().firing)
+            {
+                sink(Event{act.back().rule, slot, false, kNone, at_ms});
+                ++metrics_.cleared;
+            }
+            drop_(slot, act.size() - 1);
+        }
+        prev_[slot][0] = prev_[slot][1] = kNone;
+    }
+
+    [[nodiscard]] const std::vector<Rule> &rules() const noexcept { return rules_; }
+    [[nodiscard]] const std::vector<Firing> &firing() const noexcept { return firing_; }
+    [[nodiscard]] const Metrics &metrics() const noexcept { return metrics_; }
+
+private:
+    static constexpr double kNone = std::numeric_limits<double>::quiet_NaN();
+
+    struct Active
+    {
+        uint32_t rule;
+        bool firing;
+        uint32_t pos;      // index in firing_ while firing
+        uint64_t since_ms; // when the condition started to hold
+    };
+
+    using Index = std::vector<std::pair<double, uint32_t>>; // (threshold, rule), sorted
+
+    Index &index_for_(const Rule &r)
+    {
+        return index_[static_cast<std::size_t>(r.metric) * 2 + (r.rising() ? 0 : 1)];
+    }
+
+    /**
+     * Visit the rules of one index whose threshold lies between `old` and
+     * `v` (for a first sample: every rule the value is past) and start
+     * those that now hold.
+     */
+    void enter_(Slot slot, const Index &idx, double v, double old, bool rising, uint64_t at)
+    {
+        if (idx.empty())
+            return;
+        double lo, hi;
+        if (std::isnan(old))
+        {
+            lo = rising ? -std::numeric_limits<double>::infinity() : v;
+            hi = rising ? v : std::numeric_limits<double>::infinity();
+        }
+        else
+        {
+            lo = std::min(old, v);
+            hi = std::max(old, v);
+        }
+
+        auto it = std::lower_bound(idx.begin(), idx.end(), std::pair{lo, uint32_t{0}});
+        for (; it != idx.end() && it->first <= hi; ++it)
+        {
+            ++metrics_.visits;
+            const Rule &rule = rules_[it->second];
+            if (!rule.holds(v) || (!std::isnan(old) && rule.holds(old)))
+                continue;
+            // a first sample cannot meet an entry of this metric; later ones can
+            // (firing, dipped under the threshold but not past `clear`)
+            auto &act = active_[slot];
+            if (std::isnan(old) || std::none_of(act.begin(), act.end(), [&](const Active &a)
+                                                { return a.rule == it->second; }))
+                act.push_back({it->second, false, 0, at});
+        }
+    }
+
+    void drop_(Slot slot, std::size_t i)
+    {
+        auto &act = active_[slot];
+        if (act[i].firing)
+        {
+            // swap‑remove from the firing list and fix the moved entry's pos
+            const uint32_t pos = act[i].pos;
+            const Firing moved = firing_.back();
+            firing_[pos] = moved;
+            firing_.pop_back();
+            if (pos < firing_.size())
+            {
+                for (auto &a : active_[moved.slot])
+                {
+                    if (a.firing && a.rule == moved.rule)
+                        a.pos = pos;
+                }
+            }
+        }
+        act[i] = act.back();
+        act.pop_back();
+    }
+
+    std::vector<Rule> rules_;
+    Index index_[4]; // [metric * 2 + falling]
+
+    // per‑slot columns
+    std::vector<std::array<double, 2>> prev_;  // last cpu / mem, NaN = none
+    std::vector<std::vector<Active>> active_;  // pending + firing, usually empty
+
+    std::vector<Firing> firing_;
+    Metrics metrics_{};
+};
+
+// -----------------------------------------------------------------------------
+// Rule parser
+// -----------------------------------------------------------------------------
+
+namespace stats_alerts_detail
+{
+    inline std::string_view next_token(std::string_view &s)
+    {
+        s = util::trim(s);
+        std::size_t n = 0;
+        if (!s.empty() && (s[0] == '>' || s[0] == '<' || s[0] == '='))
+            n = s.size() > 1 && s[1] == '=' ? 2 : 1;
+        else
+            while (n < s.size() && !std::isspace(static_cast<unsigned char>(s[n])) &&
+                   s[n] != '>' && s[n] != '<' && s[n] != '=')
+                ++n;
+        const auto tok = s.substr(0, n);
+        s.remove_prefix(n);
+        return tok;
+    }
+
+    // number with an optional unit suffix, scaled to the metric's base unit
+    inline std::expected<double, std::string> value(std::string_view tok, StatsAlerts::Metric metric)
+    {
+        double v = 0;
+        auto [end, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), v);
+        if (ec != std::errc{})
+            return std::unexpected("bad number '" + std::string{tok} + "'");
+        const std::string_view unit{end, static_cast<std::size_t>(tok.data() + tok.size() - end)};
+        if (unit.empty())
+            return v;
+        if (metric == StatsAlerts::Metric::Cpu && unit == "%")
+            return v / 100.0;
+        if (metric == StatsAlerts::Metric::Mem)
+        {
+            static constexpr std::pair<std::string_view, double> kUnits[] = {
+                {"KiB", 1024.0}, {"MiB", 1048576.0}, {"GiB", 1073741824.0}, {"TiB", 1099511627776.0},
+                {"KB", 1e3}, {"MB", 1e6}, {"GB", 1e9}, {"TB", 1e12}, {"B", 1.0}};
+            for (const auto &[name, scale] : kUnits)
+            {
+                if (util::iequals(unit, name))
+                    return v * scale;
+            }
+        }
+        return std::unexpected("unknown unit '" + std::string{unit} + "'");
+    }
+
+    inline std::expected<uint64_t, std::string> duration_ms(std::string_view tok)
+    {
+        uint64_t n = 0;
+        auto [end, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), n);
+        if (ec != std::errc{})
+            return std::unexpected("bad duration '" + std::string{tok} + "'");
+        const std::string_view unit{end, static_cast<std::size_t>(tok.data() + tok.size() - end)};
+        if (unit.empty() || unit == "s")
+            return n * 1000;
+        if (unit == "ms")
+            return n;
+        if (unit == "m")
+            return n * 60'000;
+        if (unit == "h")
+            return n * 3'600'000;
+        return std::unexpected("unknown duration unit '" + std::string{unit} + "'");
+    }
+} // namespace stats_alerts_detail
+
+inline std::expected<StatsAlerts::Rule, std::string> StatsAlerts::Rule::parse(std::string_view text)
+{
+    namespace d = stats_alerts_detail;
+    Rule r;
+    text = util::trim(text);
+
+    if (const auto eq = text.find('='); eq != std::string_view::npos &&
+                                        (eq == 0 || (text[eq - 1] != '>' && text[eq - 1] != '<')))
+    {
+        r.name = util::trim(text.substr(0, eq));
+        text.remove_prefix(eq + 1);
+    }
+    else
+    {
+        r.name = text;
+    }
+
+    const auto metric = d::next_token(text);
+    if (metric == "cpu_avg" || metric == "cpu")
+        r.metric = Metric::Cpu;
+    else if (metric == "max_mem" || metric == "mem")
+        r.metric = Metric::Mem;
+    else
+        return std::unexpected("unknown metric '" + std::string{metric} + "'");
+
+    const auto op = d::next_token(text);
+    if (op == ">")
+        r.op = Op::Gt;
+    else if (op == ">=")
+        r.op = Op::Ge;
+    else if (op == "<")
+        r.op = Op::Lt;
+    else if (op == "<=")
+        r.op = Op::Le;
+    else
+        return std::unexpected("expected > >= < or <=, got '" + std::string{op} + "'");
+
+    auto threshold = d::value(d::next_token(text), r.metric);
+    if (!threshold)
+        return std::unexpected(threshold.error());
+    r.threshold = *threshold;
+    r.clear = r.rising() ? r.threshold * 0.95 : r.threshold * 1.05;
+
+    while (true)
+    {
+        const auto kw = d::next_token(text);
+        if (kw.empty())
+            break;
+        if (kw == "for")
+        {
+            auto ms = d::duration_ms(d::next_token(text));
+            if (!ms)
+                return std::unexpected(ms.error());
+            r.for_ms = *ms;
+        }
+        else if (kw == "clear")
+        {
+            auto c = d::value(d::next_token(text), r.metric);
+            if (!c)
+                return std::unexpected(c.error());
+            r.clear = *c;
+            // on the firing side the alert would clear at once and never re‑arm
+            if (r.rising() ? r.clear > r.threshold : r.clear < r.threshold)
+                return std::unexpected(std::string{"clear level must not be past the threshold"});
+        }
+        else
+        {
+            return std::unexpected("unexpected '" + std::string{kw} + "'");
+        }
+    }
+    return r;
+}
+
+#endif
@@ -0,0 +1,511 @@
+// stats_binary_decoder.hpp — CBOR / MessagePack stats frames via nlohmann SAX
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_BINARY_DECODER_HPP
+#define CP_STATS_BINARY_DECODER_HPP
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <map>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "stats_decoder.hpp"
+#include "stats_model.hpp"
+
+/** Wire encodings the stats stream can use. */
+enum class StatsEncoding
+{
+    Json,
+    Cbor,
+    MsgPack,
+};
+
+/** WebSocket subprotocol name advertised for each encoding. */
+constexpr std::string_view stats_subprotocol(StatsEncoding enc) noexcept
+{
+    switch (enc)
+    {
+    case StatsEncoding::Cbor:
+        return "rezn.stats.cbor";
+    case StatsEncoding::MsgPack:
+        return "rezn.stats.msgpack";
+    default:
+        return "rezn.stats.json";
+    }
+}
+
+/**
+ * Tell CBOR from MessagePack by the first byte of a frame whose top level is
+ * a map: CBOR maps are major type 5 (0xA0–0xBF), MessagePack maps are fixmap
+ * (0x80–0x8F), map16 (0xDE) or map32 (0xDF).  The ranges do not overlap, so
+ * the client does not depend on reading the negotiated subprotocol back.
+ */
+constexpr std::expected<StatsEncoding, std::string_view>
+sniff_stats_encoding(std::span<const std::byte> frame) noexcept
+{
+    if (frame.empty())
+        return std::unexpected("empty binary frame");
+    const auto b = static_cast<uint8_t>(frame[0]);
+    if (b >= 0xA0 && b <= 0xBF)
+        return StatsEncoding::Cbor;
+    if ((b >= 0x80 && b <= 0x8F) || b == 0xDE || b == 0xDF)
+        return StatsEncoding::MsgPack;
+    return std::unexpected("binary frame is not a CBOR or MessagePack map");
+}
+
+namespace stats_detail
+{
+    /**
+     * Per‑thread arena for the strings nlohmann's binary reader builds while
+     * walking a frame (map keys, string values).  `StatsBinaryDecoder`
+     * releases it at the start of every frame, so once a thread has decoded
+     * its largest frame the reader's scratch never reaches malloc.  Nothing
+     * allocated here outlives the frame: the handler copies what it keeps.
+     */
+    inline std::pmr::monotonic_buffer_resource &frame_arena()
+    {
+        static constexpr std::size_t kInitial = 16 * 1024;
+        alignas(std::max_align_t) thread_local std::byte buf[kInitial];
+        thread_local std::pmr::monotonic_buffer_resource arena{buf, sizeof buf};
+        return arena;
+    }
+
+    // Stateless allocator over frame_arena(); nlohmann default‑constructs its
+    // strings, so the arena cannot be passed in.
+    template <typename T>
+    struct FrameAllocator
+    {
+        using value_type = T;
+
+        FrameAllocator() noexcept = default;
+        template <typename U>
+        FrameAllocator(const FrameAllocator<U> &) noexcept {}
+
+        T *allocate(std::size_t n) { return static_cast<T *>(frame_arena().allocate(n * sizeof(T), alignof(T))); }
+        void deallocate(T *, std::size_t) noexcept {} // released per frame
+
+        friend bool operator==(const FrameAllocator &, const FrameAllocator &) noexcept { return true; }
+    };
+
+    using FrameString = std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+} // namespace stats_detail
+
+/**
+ * StatsBinaryDecoder
+ * ------------------
+ * Same contract as `StatsDecoder` (sink gets `(id, TimestampedStats)`, bad
+ * entries are skipped, bad frames rejected, delta envelopes understood) for
+ * CBOR and MessagePack frames.
+ * It drives nlohmann's binary reader in SAX mode, so no `json` tree is built;
+ * the decoder only tracks which level of the
+ * `{id: {stats: {cpu_avg, max_mem}, timestamp}}` shape (or of the
+ * `{seq, full, upserts, removed}` envelope) it is in and skips every other
+ * subtree.
+ *
+ * The reader's own scratch strings come from `stats_detail::frame_arena()`,
+ * and the current container ID is kept in a reused buffer, so decoding a
+ * frame allocates nothing once the thread is warm.
+ */
+class StatsBinaryDecoder
+{
+public:
+    using Result = StatsDecoder::Result;
+
+    template <typename Sink>
+        requires std::invocable<Sink &, std::string_view, const TimestampedStats &>
+    [[nodiscard]] std::expected<Result, std::string>
+    decode(std::span<const std::byte> frame, StatsEncoding enc, Sink &&sink)
+    {
+        stats_detail::EntryHandler<std::remove_reference_t<Sink>> h{sink};
+        return decode_frame_(frame, enc, h);
+    }
+
+    /** Everything, including delta envelope fields, into `out` (cleared first). */
+    [[nodiscard]] std::expected<Result, std::string>
+    decode(std::span<const std::byte> frame, StatsEncoding enc, StatsBatch &out)
+    {
+        out.clear();
+        stats_detail::BatchHandler h{out};
+        return decode_frame_(frame, enc, h);
+    }
+
+    /** Sniff the encoding from the first byte, then decode. */
+    template <typename Out>
+    [[nodiscard]] std::expected<Result, std::string>
+    decode(std::span<const std::byte> frame, Out &&out)
+    {
+        auto enc = sniff_stats_encoding(frame);
+        if (!enc)
+            return std::unexpected(std::string{enc.error()});
+        return decode(frame, *enc, std::forward<Out>(out));
+    }
+
+private:
+    // nlohmann::json with arena strings: only its SAX reader is used
+    using json = nlohmann::basic_json<std::map, std::vector, stats_detail::FrameString>;
+
+    template <typename Events>
+    std::expected<Result, std::string>
+    decode_frame_(std::span<const std::byte> frame, StatsEncoding enc, Events &events)
+    {
+        Handler<Events> h{*this, events};
+        const auto *first = reinterpret_cast<const uint8_t *>(frame.data());
+        const auto format = enc == StatsEncoding::Cbor
+                                ? json::input_format_t::cbor
+                                : json::input_format_t::msgpack;
+
+        error_.clear();
+        stats_detail::frame_arena().release(); // previous frame's scratch
+        const bool ok = json::sax_parse(first, first + frame.size(), &h, format);
+        if (!ok || h.depth != 0 || !h.seen_top)
+        {
+            if (error_.empty())
+                error_ = "binary stats frame is not a map of entries";
+            return std::unexpected(error_);
+        }
+        return h.res;
+    }
+
+    enum class Field : uint8_t
+    {
+        Other,
+        Stats,
+        Timestamp,
+        Cpu,
+        Mem,
+        // envelope members
+        Seq,
+        Full,
+        Upserts,
+        Removed,
+    };
+
+    // Containers the handler descends into; everything else is skipped.
+    enum class Level : uint8_t
+    {
+        Frame,   // top‑level map: entries or envelope members
+        Entries, // "upserts" map
+        Entry,   // one container
+        Stats,   // entry.stats
+        Removed, // "removed" array
+    };
+
+    // SAX event handler.  `stack[0..depth)` holds the relevant levels; nested
+    // values outside the schema are skipped by counting nesting in `skip`.
+    template <typename Events>
+    struct Handler
+    {
+        StatsBinaryDecoder &dec;
+        Events &events;
+
+        Result res{};
+        Level stack[4]{};
+        int depth{0};
+        int skip{0};
+        bool seen_top{false};
+
+        Field field1{Field::Other}; // envelope key inside the frame map
+        Field field2{Field::Other}; // key inside an entry
+        Field field3{Field::Other}; // key inside "stats"
+        TimestampedStats ts{};
+        bool ok{true}, have_stats{false}, have_ts{false};
+
+        Level top() const noexcept { return stack[depth - 1]; }
+        void push(Level l) noexcept { stack[depth++] = l; }
+
+        void begin_entry()
+        {
+            push(Level::Entry);
+            ts = {};
+            ok = true;
+            have_stats = have_ts = false;
+            field2 = Field::Other;
+        }
+
+        // --- containers ------------------------------------------------------
+        bool start_object(std::size_t)
+        {
+            if (skip)
+            {
+                ++skip;
+                return true;
+            }
+            if (depth == 0)
+            {
+                if (seen_top)
+                    return false; // a second top‑level value
+                seen_top = true;
+                push(Level::Frame);
+                return true;
+            }
+            switch (top())
+            {
+            case Level::Frame:
+                if (field1 == Field::Upserts)
+                    push(Level::Entries);
+                else
+                    begin_entry();
+                return true;
+            case Level::Entries:
+                begin_entry();
+                return true;
+            case Level::Entry:
+                if (field2 == Field::Stats)
+                {
+                    push(Level::Stats);
+                    have_stats = true;
+                    field3 = Field::Other;
+                    return true;
+                }
+                if (field2 == Field::Timestamp)
+                    ok = false;
+                ++skip;
+                return true;
+            case Level::Stats:
+                if (field3 == Field::Cpu || field3 == Field::Mem)
+                    ok = false;
+                ++skip;
+                return true;
+            default: // object inside "removed"
+                ++res.skipped;
+                ++skip;
+                return true;
+            }
+        }
+
+        bool end_object()
+        {
+            if (skip)
+            {
+                --skip;
+                return true;
+            }
+            if (top() == Level::Entry)
+            {
+                if (ok && have_stats && have_ts)
+                {
+                    events.entry(std::string_view{dec.id_}, static_cast<const TimestampedStats &>(ts));
+                    ++res.entries;
+                }
+                else
+                {
+                    ++res.skipped;
+                }
+            }
+            --depth;
+            return true;
+        }
+
+        bool start_array(std::size_t)
+        {
+            if (skip)
+            {
+                ++skip;
+                return true;
+            }
+            if (depth == 0)
+                return false; // frame must be a map
+            if (top() == Level::Frame && field1 == Field::Removed)
+            {
+                push(Level::Removed);
+                return true;
+            }
+            if (top() == Level::Removed)
+                ++res.skipped;
+            else
+                scalar_(false);
+            ++skip;
+            return true;
+        }
+
+        bool end_array()
+        {
+            if (skip)
+                --skip;
+            else
+                --depth; // "removed"
+            return true;
+        }
+
+        bool key(json::string_t &k)
+        {
+            if (skip)
+                return true;
+            switch (top())
+            {
+            case Level::Frame:
+                field1 = k == "seq" ? Field::Seq : k == "full" ? Field::Full
+                                               : k == "upserts" ? Field::Upserts
+                                               : k == "removed" ? Field::Removed
+                                                                : Field::Other;
+                dec.id_.assign(std::string_view{k});
+                break;
+            case Level::Entries:
+                dec.id_.assign(std::string_view{k});
+                break;
+            case Level::Entry:
+                field2 = k == "stats" ? Field::Stats : k == "timestamp" ? Field::Timestamp
+                                                                        : Field::Other;
+                break;
+            case Level::Stats:
+                field3 = k == "cpu_avg" ? Field::Cpu : k == "max_mem" ? Field::Mem
+                                                                      : Field::Other;
+                break;
+            default:
+                break;
+            }
+            return true;
+        }
+
+        // --- scalars ---------------------------------------------------------
+        bool null() { return scalar_(true); }
+        bool binary(json::binary_t &) { return scalar_(false); }
+
+        bool boolean(bool v)
+        {
+            if (!skip && depth && top() == Level::Frame && field1 == Field::Full)
+            {
+                events.full(v);
+                return true;
+            }
+            return scalar_(false);
+        }
+
+        bool string(json::string_t &v)
+        {
+            if (!skip && depth && top() == Level::Removed)
+            {
+                events.removed(std::string_view{v});
+                ++res.removed;
+                return true;
+            }
+            return scalar_(false);
+        }
+
+        bool number_integer(json::number_integer_t v)
+        {
+            if (v < 0)
+                return number_(static_cast<double>(v), false);
+            return unsigned_(static_cast<uint64_t>(v));
+        }
+        bool number_unsigned(json::number_unsigned_t v) { return unsigned_(v); }
+        // the UBJSON high‑precision path passes its token as std::string
+        template <typename Text>
+        bool number_float(json::number_float_t v, const Text &)
+        {
+            return number_(v, v >= 0.0 && v < 18446744073709551616.0);
+        }
+
+        bool parse_error(std::size_t pos, const std::string &, const nlohmann::detail::exception &ex)
+        {
+            dec.error_ = "binary stats frame: " + std::string{ex.what()} +
+                         " (byte " + std::to_string(pos) + ")";
+            return false;
+        }
+
+        // --- helpers ---------------------------------------------------------
+        bool unsigned_(uint64_t v)
+        {
+            if (skip || depth == 0)
+                return scalar_(false);
+            switch (top())
+            {
+            case Level::Frame:
+                if (field1 == Field::Seq)
+                {
+                    events.seq(v);
+                    return true;
+                }
+                break;
+            case Level::Entry:
+                if (field2 == Field::Timestamp)
+                {
+                    ts.timestamp = v;
+                    have_ts = true;
+                    return true;
+                }
+                break;
+            case Level::Stats:
+                if (field3 == Field::Mem)
+                {
+                    ts.stats.max_mem = v;
+                    return true;
+                }
+                if (field3 == Field::Cpu)
+                {
+                    ts.stats.cpu_avg = static_cast<double>(v);
+                    return true;
+                }
+                break;
+            default:
+                break;
+            }
+            return scalar_(false);
+        }
+
+        // `as_u64`: value is representable as u64 (nlohmann truncates)
+        bool number_(double v, bool as_u64)
+        {
+            if (skip || depth == 0)
+                return scalar_(false);
+            if (top() == Level::Stats && field3 == Field::Cpu)
+            {
+                ts.stats.cpu_avg = v;
+                return true;
+            }
+            if (as_u64 && top() == Level::Entry && field2 == Field::Timestamp)
+            {
+                ts.timestamp = static_cast<uint64_t>(v);
+                have_ts = true;
+                return true;
+            }
+            if (as_u64 && top() == Level::Stats && field3 == Field::Mem)
+            {
+                ts.stats.max_mem = static_cast<uint64_t>(v);
+                return true;
+            }
+            return scalar_(false);
+        }
+
+        // a value that is not a usable number at the current position
+        bool scalar_(bool is_null)
+        {
+            if (skip)
+                return true;
+            if (depth == 0)
+                return false; // frame must be a map
+            switch (top())
+            {
+            case Level::Frame:
+            case Level::Entries:
+            case Level::Removed:
+                ++res.skipped; // entry is not an object / tombstone not a string
+                return true;
+            case Level::Entry:
+                if (field2 == Field::Timestamp)
+                    ok = false;
+                else if (field2 == Field::Stats)
+                    have_stats = true; // non‑object stats == no metrics
+                return true;
+            default:
+                if (!is_null && (field3 == Field::Cpu || field3 == Field::Mem))
+                    ok = false;
+                return true;
+            }
+        }
+    };
+
+    std::string id_;    //!< current container ID, reused between entries
+    std::string error_; //!< last parse error
+};
+
+#endif
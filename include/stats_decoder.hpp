@@ -0,0 +1,700 @@
+// stats_decoder.hpp — streaming (zero‑DOM) decoder for stats frames
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_DECODER_HPP
+#define CP_STATS_DECODER_HPP
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#include "stats_model.hpp"
+
+namespace stats_detail
+{
+    // Frame events of the stats decoders: entry / tombstone / envelope fields.
+
+    template <typename Sink>
+    struct EntryHandler
+    {
+        Sink &sink;
+        void entry(std::string_view id, const TimestampedStats &ts) { sink(id, ts); }
+        void removed(std::string_view) noexcept {}
+        void seq(uint64_t) noexcept {}
+        void full(bool) noexcept {}
+    };
+
+    struct BatchHandler
+    {
+        StatsBatch &out;
+        void entry(std::string_view id, const TimestampedStats &ts) { out.add(id, ts); }
+        void removed(std::string_view id) { out.remove(id); }
+        void seq(uint64_t seq) noexcept { out.set_seq(seq); }
+        void full(bool full) noexcept { out.set_full(full); }
+    };
+} // namespace stats_detail
+
+/**
+ * StatsDecoder
+ * ------------
+ * Hand‑written scanner for the stats frame schema
+ *
+ *     { "<container id>": { "stats": { "cpu_avg": f64|null,
+ *                                      "max_mem": u64|null },
+ *                           "timestamp": u64 }, ... }
+ *
+ * It walks the frame once and hands every entry to a sink as
+ * `(std::string_view id, const TimestampedStats &)` without building a JSON
+ * tree.  Container IDs are views into the frame itself; only IDs that contain
+ * escape sequences are unescaped, into a scratch buffer that is reused between
+ * frames.  The views are valid for the duration of the sink call only, so a
+ * sink that keeps an ID looks it up in (or copies it into) its own storage.
+ *
+ * Semantics follow `from_json` in stats_json.hpp: unknown keys are ignored,
+ * null metrics (or a non‑object "stats") stay empty, and an entry with a missing or mistyped field is
+ * skipped (counted in `Result::skipped`) without aborting the frame.  A frame
+ * that is not well‑formed JSON is rejected as a whole.
+ *
+ * Delta‑mode frames wrap the same entries in an envelope
+ *
+ *     { "seq": u64, "full": bool, "upserts": { <entries> }, "removed": [id] }
+ *
+ * Decoding into a `StatsBatch` keeps the sequence number, the full‑snapshot
+ * flag and the tombstones; the plain sink overload only sees the upserts.
+ */
+class StatsDecoder
+{
+public:
+    struct Result
+    {
+        std::size_t entries{}; //!< entries handed to the sink
+        std::size_t skipped{}; //!< well‑formed but schema‑invalid entries
+        std::size_t removed{}; //!< tombstones in a delta frame
+    };
+
+    /** Entries only — tombstones and sequencing of delta frames are dropped. */
+    template <typename Sink>
+        requires std::invocable<Sink &, std::string_view, const TimestampedStats &>
+    [[nodiscard]] std::expected<Result, std::string>
+    decode(std::string_view json, Sink &&sink)
+    {
+        stats_detail::EntryHandler<std::remove_reference_t<Sink>> h{sink};
+        return decode_frame_(json, h);
+    }
+
+    /** Everything, including delta envelope fields, into `out` (cleared first). */
+    [[nodiscard]] std::expected<Result, std::string>
+    decode(std::string_view json, StatsBatch &out)
+    {
+        out.clear();
+        stats_detail::BatchHandler h{out};
+        return decode_frame_(json, h);
+    }
+
+    /** Convenience overload: upsert every entry into `out` (latest wins). */
+    [[nodiscard]] std::expected<Result, std::string>
+    decode(std::string_view json, StatsMap &out)
+    {
+        return decode(json, [&out](std::string_view id, const TimestampedStats &ts)
+                      {
+                          // Frames arrive key‑ordered (BTreeMap on the server),
+                          // so the end() hint makes every insert O(1).
+                          out.insert_or_assign(out.end(), std::string{id}, ts); });
+    }
+
+private:
+    template <typename Handler>
+    std::expected<Result, std::string> decode_frame_(std::string_view json, Handler &h)
+    {
+        frame_begin_ = cur_ = json.data();
+        end_ = json.data() + json.size();
+
+        Result res;
+        skip_ws_();
+        if (!consume_('{'))
+            return fail_("expected '{' at top level");
+
+        skip_ws_();
+        if (!consume_('}'))
+        {
+            while (true)
+            {
+                std::string_view key;
+                if (!parse_string_(key, key_scratch_))
+                    return fail_("expected container ID");
+                skip_ws_();
+                if (!consume_(':'))
+                    return fail_("expected ':' after container ID");
+                skip_ws_();
+
+                // Envelope members are told apart by name *and* value type, so
+                // a container that happens to be called "seq" is still an entry.
+                const char c = peek_();
+                if (key == "upserts" && c == '{')
+                {
+                    if (!parse_entries_(h, res))
+                        return fail_("malformed upserts");
+                }
+                else if (key == "removed" && c == '[')
+                {
+                    if (!parse_removed_(h, res))
+                        return fail_("malformed removed list");
+                }
+                else if (key == "seq" && c >= '0' && c <= '9')
+                {
+                    uint64_t seq{};
+                    bool valid = false;
+                    if (!parse_u64_(seq, valid))
+                        return fail_("malformed seq");
+                    if (valid)
+                        h.seq(seq);
+                }
+                else if (key == "full" && consume_literal_("true"))
+                {
+                    h.full(true);
+                }
+                else if (key == "full" && consume_literal_("false"))
+                {
+                    h.full(false);
+                }
+                else if (!parse_member_(key, h, res))
+                {
+                    return fail_("malformed stats entry");
+                }
+
+                skip_ws_();
+                if (consume_(','))
+                {
+                    skip_ws_();
+                    continue;
+                }
+                if (consume_('}'))
+                    break;
+                return fail_("expected ',' or '}' after stats entry");
+            }
+        }
+
+        skip_ws_();
+        if (cur_ != end_)
+            return fail_("trailing data after frame");
+        return res;
+    }
+
+    static constexpr int kMaxDepth = 64; //!< nesting limit for skipped values
+
+    // -------------------------------------------------------------------------
+    // Delta envelope
+    // -------------------------------------------------------------------------
+
+    /** `"upserts": { id: entry, ... }` — same shape as a snapshot frame. */
+    template <typename Handler>
+    bool parse_entries_(Handler &h, Result &res)
+    {
+        ++cur_; // '{'
+        skip_ws_();
+        if (consume_('}'))
+            return true;
+
+        while (true)
+        {
+            std::string_view id;
+            if (!parse_string_(id, key_scratch_))
+                return false;
+            skip_ws_();
+            if (!consume_(':'))
+                return false;
+            skip_ws_();
+            if (!parse_member_(id, h, res))
+                return false;
+
+            skip_ws_();
+            if (consume_(','))
+            {
+                skip_ws_();
+                continue;
+            }
+            return consume_('}');
+        }
+    }
+
+    /** `"removed": [id, ...]`; non‑string elements are skipped. */
+    template <typename Handler>
+    bool parse_removed_(Handler &h, Result &res)
+    {
+        ++cur_; // '['
+        skip_ws_();
+        if (consume_(']'))
+            return true;
+
+        while (true)
+        {
+            if (peek_() == '"')
+            {
+                std::string_view id;
+                if (!parse_string_(id, key_scratch_))
+                    return false;
+                h.removed(id);
+                ++res.removed;
+            }
+            else
+            {
+                if (!skip_value_(1))
+                    return false;
+                ++res.skipped;
+            }
+
+            skip_ws_();
+            if (consume_(','))
+            {
+                skip_ws_();
+                continue;
+            }
+            return consume_(']');
+        }
+    }
+
+    /** One `id: entry` member; hands valid entries to the handler. */
+    template <typename Handler>
+    bool parse_member_(std::string_view id, Handler &h, Result &res)
+    {
+        TimestampedStats ts{};
+        bool valid = false;
+        if (!parse_entry_(ts, valid))
+            return false;
+
+        if (valid)
+        {
+            h.entry(id, static_cast<const TimestampedStats &>(ts));
+            ++res.entries;
+        }
+        else
+        {
+            ++res.skipped;
+        }
+        return true;
+    }
+
+    // -------------------------------------------------------------------------
+    // Entry level
+    // -------------------------------------------------------------------------
+
+    /**
+     * Parse one `TimestampedStats` value.  Returns false only on a syntax
+     * error; `valid` reports whether the value matched the schema.
+     */
+    bool parse_entry_(TimestampedStats &ts, bool &valid)
+    {
+        valid = false;
+        if (peek_() != '{')
+            return skip_value_(0); // wrong type → skip, entry invalid
+
+        ++cur_;
+        bool have_stats = false, have_ts = false, ok = true;
+
+        skip_ws_();
+        if (consume_('}'))
+            return true;
+
+        while (true)
+        {
+            std::string_view key;
+            if (!parse_string_(key, field_scratch_))
+                return false;
+            skip_ws_();
+            if (!consume_(':'))
+                return false;
+            skip_ws_();
+
+            if (key == "stats")
+            {
+                bool stats_ok = false;
+                if (!parse_stats_(ts.stats, stats_ok))
+                    return false;
+                have_stats = true;
+                ok = ok && stats_ok;
+            }
+            else if (key == "timestamp")
+            {
+                if (!parse_u64_(ts.timestamp, have_ts))
+                    return false;
+                ok = ok && have_ts;
+            }
+            else if (!skip_value_(1))
+            {
+                return false;
+            }
+
+            skip_ws_();
+            if (consume_(','))
+            {
+                skip_ws_();
+                continue;
+            }
+            if (consume_('}'))
+                break;
+            return false;
+        }
+
+        valid = ok && have_stats && have_ts;
+        return true;
+    }
+
+    bool parse_stats_(Stats &s, bool &valid)
+    {
+        // Like from_json: a non‑object "stats" has no metrics, which is valid.
+        valid = true;
+        if (peek_() != '{')
+            return skip_value_(1);
+
+        ++cur_;
+        bool ok = true;
+
+        skip_ws_();
+        if (consume_('}'))
+        {
+            valid = true;
+            return true;
+        }
+
+        while (true)
+        {
+            std::string_view key;
+            if (!parse_string_(key, field_scratch_))
+                return false;
+            skip_ws_();
+            if (!consume_(':'))
+                return false;
+            skip_ws_();
+
+            if (key == "cpu_avg")
+            {
+                if (!consume_literal_("null"))
+                {
+                    double v{};
+                    bool field_ok = false;
+                    if (!parse_f64_(v, field_ok))
+                        return false;
+                    if (field_ok)
+                        s.cpu_avg = v;
+                    ok = ok && field_ok;
+                }
+            }
+            else if (key == "max_mem")
+            {
+                if (!consume_literal_("null"))
+                {
+                    uint64_t v{};
+                    bool field_ok = false;
+                    if (!parse_u64_(v, field_ok))
+                        return false;
+                    if (field_ok)
+                        s.max_mem = v;
+                    ok = ok && field_ok;
+                }
+            }
+            else if (!skip_value_(2))
+            {
+                return false;
+            }
+
+            skip_ws_();
+            if (consume_(','))
+            {
+                skip_ws_();
+                continue;
+            }
+            if (consume_('}'))
+                break;
+            return false;
+        }
+
+        valid = ok;
+        return true;
+    }
+
+    // -------------------------------------------------------------------------
+    // Scalars
+    // -------------------------------------------------------------------------
+
+    /** Number token (or any other value, which is skipped and flagged). */
+    bool number_token_(std::string_view &tok, bool &is_number)
+    {
+        const char *start = cur_;
+        while (cur_ != end_ && is_number_char_(*cur_))
+            ++cur_;
+        tok = {start, static_cast<std::size_t>(cur_ - start)};
+        is_number = !tok.empty();
+        if (!is_number)
+            return skip_value_(2); // string / bool / object → wrong type
+        return true;
+    }
+
+    bool parse_f64_(double &out, bool &valid)
+    {
+        std::string_view tok;
+        if (!number_token_(tok, valid))
+            return false;
+        if (!valid)
+            return true;
+
+        auto [ptr, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), out);
+        if (ec != std::errc{} || ptr != tok.data() + tok.size())
+            return false; // not a JSON number at all
+        return true;
+    }
+
+    bool parse_u64_(uint64_t &out, bool &valid)
+    {
+        std::string_view tok;
+        if (!number_token_(tok, valid))
+            return false;
+        if (!valid)
+            return true;
+
+        auto [ptr, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), out);
+        if (ec == std::errc{} && ptr == tok.data() + tok.size())
+            return true;
+
+        // Fractional / exponent form: nlohmann truncates those on get<u64>().
+        double d{};
+        auto [dptr, dec] = std::from_chars(tok.data(), tok.data() + tok.size(), d);
+        if (dec != std::errc{} || dptr != tok.data() + tok.size())
+            return false;
+        if (d < 0.0 || d >= 18446744073709551616.0)
+            valid = false; // out of range for u64 → entry invalid
+        else
+            out = static_cast<uint64_t>(d);
+        return true;
+    }
+
+    /**
+     * Parse a JSON string.  Escape‑free strings are returned as a view into
+     * the frame; otherwise they are unescaped into `scratch`.
+     */
+    bool parse_string_(std::string_view &out, std::string &scratch)
+    {
+        if (!consume_('"'))
+            return false;
+
+        const char *start = cur_;
+        while (cur_ != end_ && *cur_ != '"' && *cur_ != '\\')
+            ++cur_;
+        if (cur_ == end_)
+            return false;
+        if (*cur_ == '"')
+        {
+            out = {start, static_cast<std::size_t>(cur_ - start)};
+            ++cur_;
+            return true;
+        }
+
+        // slow path: escapes present
+        scratch.assign(start, cur_);
+        while (cur_ != end_)
+        {
+            const char c = *cur_++;
+            if (c == '"')
+            {
+                out = scratch;
+                return true;
+            }
+            if (c != '\\')
+            {
+                scratch.push_back(c);
+                continue;
+            }
+            if (cur_ == end_)
+                return false;
+            switch (*cur_++)
+            {
+            case '"': scratch.push_back('"'); break;
+            case '\\': scratch.push_back('\\'); break;
+            case '/': scratch.push_back('/'); break;
+            case 'b': scratch.push_back('\b'); break;
+            case 'f': scratch.push_back('\f'); break;
+            case 'n': scratch.push_back('\n'); break;
+            case 'r': scratch.push_back('\r'); break;
+            case 't': scratch.push_back('\t'); break;
+            case 'u':
+            {
+                uint32_t cp{};
+                if (!parse_hex4_(cp))
+                    return false;
+                if (cp >= 0xD800 && cp <= 0xDBFF)
+                {
+                    uint32_t lo{};
+                    if (!consume_('\\') || !consume_('u') || !parse_hex4_(lo) ||
+                        lo < 0xDC00 || lo > 0xDFFF)
+                        return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                append_utf8_(scratch, cp);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false; // unterminated
+    }
+
+    bool parse_hex4_(uint32_t &cp)
+    {
+        if (end_ - cur_ < 4)
+            return false;
+        auto [ptr, ec] = std::from_chars(cur_, cur_ + 4, cp, 16);
+        if (ec != std::errc{} || ptr != cur_ + 4)
+            return false;
+        cur_ += 4;
+        return true;
+    }
+
+    static void append_utf8_(std::string &s, uint32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            s.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            s.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            s.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            s.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // Generic skipping (values we do not care about)
+    // -------------------------------------------------------------------------
+
+    bool skip_value_(int depth)
+    {
+        if (depth > kMaxDepth)
+            return false;
+
+        switch (peek_())
+        {
+        case '"':
+        {
+            std::string_view ignored;
+            return parse_string_(ignored, field_scratch_);
+        }
+        case '{':
+        case '[':
+        {
+            const char close = *cur_ == '{' ? '}' : ']';
+            const bool object = close == '}';
+            ++cur_;
+            skip_ws_();
+            if (consume_(close))
+                return true;
+            while (true)
+            {
+                if (object)
+                {
+                    std::string_view ignored;
+                    if (!parse_string_(ignored, field_scratch_))
+                        return false;
+                    skip_ws_();
+                    if (!consume_(':'))
+                        return false;
+                    skip_ws_();
+                }
+                if (!skip_value_(depth + 1))
+                    return false;
+                skip_ws_();
+                if (consume_(','))
+                {
+                    skip_ws_();
+                    continue;
+                }
+                return consume_(close);
+            }
+        }
+        case 't':
+            return consume_literal_("true");
+        case 'f':
+            return consume_literal_("false");
+        case 'n':
+            return consume_literal_("null");
+        default:
+        {
+            const char *start = cur_;
+            while (cur_ != end_ && is_number_char_(*cur_))
+                ++cur_;
+            return cur_ != start;
+        }
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // Cursor primitives
+    // -------------------------------------------------------------------------
+
+    static bool is_number_char_(char c) noexcept
+    {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+               c == 'e' || c == 'E';
+    }
+
+    char peek_() const noexcept { return cur_ != end_ ? *cur_ : '\0'; }
+
+    bool consume_(char c) noexcept
+    {
+        if (cur_ != end_ && *cur_ == c)
+        {
+            ++cur_;
+            return true;
+        }
+        return false;
+    }
+
+    bool consume_literal_(std::string_view lit) noexcept
+    {
+        if (static_cast<std::size_t>(end_ - cur_) >= lit.size() &&
+            std::string_view{cur_, lit.size()} == lit)
+        {
+            cur_ += lit.size();
+            return true;
+        }
+        return false;
+    }
+
+    void skip_ws_() noexcept
+    {
+        while (cur_ != end_ &&
+               (*cur_ == ' ' || *cur_ == '\n' || *cur_ == '\r' || *cur_ == '\t'))
+            ++cur_;
+    }
+
+    std::unexpected<std::string> fail_(std::string_view what) const
+    {
+        return std::unexpected(std::string{what} + " at offset " +
+                               std::to_string(cur_ - frame_begin_));
+    }
+
+    const char *cur_{};
+    const char *end_{};
+    const char *frame_begin_{};
+    std::string key_scratch_;   //!< unescaped container ID (rare)
+    std::string field_scratch_; //!< unescaped field names / skipped strings
+};
+
+#endif
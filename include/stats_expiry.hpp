@@ -0,0 +1,151 @@
+// stats_expiry.hpp — stale marking and eviction of silent containers
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_EXPIRY_HPP
+#define CP_STATS_EXPIRY_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "timer_wheel.hpp"
+
+/**
+ * StatsExpiry
+ * -----------
+ * Tracks when each container (by slot) last reported and drives its expiry
+ * through a `TimerWheel`: `stale_after` past its newest sample timestamp a
+ * container is marked stale, `evict_after` past it the caller is told to
+ * evict it.  Each update just re‑arms the slot's timer, O(1), instead of
+ * anyone scanning the ledger for silent rows.
+ *
+ * Deadlines come from the samples' own timestamps, and "now" is *stream
+ * time*: the newest timestamp seen from any container, carried forward by
+ * the wall clock since it arrived.  That keeps expiry meaningful when the
+ * console's clock is off, during a replay, and when every endpoint goes
+ * quiet at once (time keeps moving, so everything ages out).  A node whose
+ * clock lags the rest of the fleet by more than `stale_after` looks stale.
+ */
+class StatsExpiry
+{
+public:
+    using Slot = uint32_t;
+
+    struct Config
+    {
+        std::chrono::seconds stale_after{30};
+        std::chrono::seconds evict_after{300};
+    };
+
+    struct Metrics
+    {
+        std::size_t stale{};   //!< containers currently stale
+        uint64_t evicted{};    //!< containers evicted so far
+        uint64_t revived{};    //!< stale containers that reported again
+    };
+
+    StatsExpiry() : StatsExpiry(Config{}) {}
+
+    explicit StatsExpiry(Config cfg)
+        : stale_ms_{ms_(cfg.stale_after)},
+          evict_ms_{std::max(ms_(cfg.evict_after), ms_(cfg.stale_after))}
+    {
+    }
+
+    /** A sample with timestamp `sample_ms` arrived for `slot` at `wall_ms`. */
+    void touch(Slot slot, uint64_t sample_ms, uint64_t wall_ms)
+    {
+        if (slot >= last_ms_.size())
+        {
+            last_ms_.resize(std::max<std::size_t>(slot + 1, last_ms_.size() * 2), 0);
+            stale_.resize(last_ms_.size(), 0);
+        }
+
+        if (sample_ms > stream_ms_)
+        {
+            stream_ms_ = sample_ms;
+            stream_wall_ms_ = wall_ms;
+        }
+        if (stale_[slot])
+        {
+            stale_[slot] = 0;
+            --metrics_.stale;
+            ++metrics_.revived;
+        }
+        last_ms_[slot] = sample_ms;
+        // the wheel runs on stream time from the first sample on, not from
+        // that sample's deadline: a slightly older sample is not overdue
+        wheel_.start(now_ms(wall_ms));
+        wheel_.schedule(slot, sample_ms + stale_ms_);
+    }
+
+    /** The slot left the ledger some other way (tombstone, full snapshot). */
+    void forget(Slot slot) noexcept
+    {
+        wheel_.cancel(slot);
+        if (slot < stale_.size() && stale_[slot])
+        {
+            stale_[slot] = 0;
+            --metrics_.stale;
+        }
+    }
+
+    /** Advance stream time; calls `evict(slot)` for every slot to drop. */
+    template <typename Evict>
+    void advance(uint64_t wall_ms, Evict &&evict)
+    {
+        if (stream_ms_ == 0)
+            return; // no stream time yet; the wall clock alone says nothing
+        wheel_.advance(now_ms(wall_ms), [&](TimerWheel::Id slot)
+                       {
+                           if (!stale_[slot] && evict_ms_ > stale_ms_)
+                           {
+                               stale_[slot] = 1;
+                               ++metrics_.stale;
+                               wheel_.schedule(slot, last_ms_[slot] + evict_ms_);
+                               return;
+                           }
+                           if (stale_[slot])
+                           {
+                               stale_[slot] = 0;
+                               --metrics_.stale;
+                           }
+                           ++metrics_.evicted;
+                           evict(slot); });
+    }
+
+    [[nodiscard]] bool stale(Slot slot) const noexcept
+    {
+        return slot < stale_.size() && stale_[slot];
+    }
+
+    /** Current stream time (see class comment). */
+    [[nodiscard]] uint64_t now_ms(uint64_t wall_ms) const noexcept
+    {
+        return stream_ms_ + (wall_ms > stream_wall_ms_ ? wall_ms - stream_wall_ms_ : 0);
+    }
+
+    [[nodiscard]] const Metrics &metrics() const noexcept { return metrics_; }
+
+private:
+    static uint64_t ms_(std::chrono::seconds s) noexcept
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(s).count());
+    }
+
+    const uint64_t stale_ms_;
+    const uint64_t evict_ms_;
+
+    TimerWheel wheel_{1000};
+    uint64_t stream_ms_{};      // newest sample timestamp seen
+    uint64_t stream_wall_ms_{}; // wall clock when it arrived
+
+    // per‑slot columns
+    std::vector<uint64_t> last_ms_; // newest sample timestamp
+    std::vector<uint8_t> stale_;
+
+    Metrics metrics_{};
+};
+
+#endif
@@ -0,0 +1,192 @@
+// stats_exporter.hpp — Prometheus / OpenMetrics scrape endpoint for the merged ledger
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_EXPORTER_HPP
+#define CP_STATS_EXPORTER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "stats_model.hpp"
+
+/**
+ * StatsExporter
+ * -------------
+ * Serves the ledger `StatsWindow` has already merged from every endpoint as
+ * Prometheus text exposition (0.0.4), or OpenMetrics 1.0 when the scraper
+ * asks for it, over a small HTTP/1.1 listener on TCP (`host:port`, `:port`)
+ * or a Unix socket (`unix:/path`).
+ *
+ * The ledger belongs to the UI thread, so a scrape never touches it: the
+ * exporter thread raises `wanted()`, the UI thread notices it in
+ * `StatsWindow::pumpQueue()` and `publish()`es a flat copy of the rows (a
+ * memcpy‑sized job), and the exporter renders and sends that copy on its own
+ * thread.  If the UI does not answer within `snapshot_wait` the previous
+ * snapshot is served.  Nothing is copied while nobody scrapes.
+ *
+ * Snapshots and response buffers are reused, so once they have grown to the
+ * ledger's size a scrape allocates nothing.
+ *
+ * A client that has not sent its whole request within `request_timeout` of
+ * connecting, or stops reading the response for that long, is dropped, so
+ * idle connections cannot hold the `max_clients` slots.
+ *
+ * The constructor throws if the address cannot be bound.
+ */
+class StatsExporter
+{
+public:
+    struct Config
+    {
+        std::string listen;                              //!< "host:port", ":port" or "unix:/path"
+        std::chrono::milliseconds snapshot_wait{250};    //!< how long a scrape waits for the UI
+        std::size_t max_clients = 16;                    //!< concurrent connections
+        std::chrono::milliseconds request_timeout{5000}; //!< to send the request / take a response chunk
+    };
+
+    struct Metrics
+    {
+        uint64_t scrapes{};      //!< /metrics responses
+        uint64_t stale{};        //!< scrapes served from the previous snapshot
+        uint64_t rejected{};     //!< connections over max_clients, bad or timed‑out requests
+        uint64_t render_us{};    //!< last render time
+        std::size_t bytes{};     //!< last response body size
+    };
+
+    /** Flat, reusable copy of the ledger, filled by the UI thread. */
+    class Snapshot
+    {
+    public:
+        void clear() noexcept
+        {
+            text_.clear();
+            endpoints_.clear();
+            rows_.clear();
+            alerts_firing_ = 0;
+        }
+
+        void add_endpoint(std::string_view node, bool up, uint64_t frames, uint64_t gaps)
+        {
+            endpoints_.push_back({intern_(node), static_cast<uint32_t>(node.size()), up, frames, gaps});
+        }
+
+        void add_container(uint32_t endpoint, std::string_view id, const TimestampedStats &ts, bool stale)
+        {
+            rows_.push_back({intern_(id), static_cast<uint32_t>(id.size()), endpoint,
+                             ts.stats.cpu_avg.has_value(), ts.stats.max_mem.has_value(), stale,
+                             ts.stats.cpu_avg.value_or(0.0), ts.stats.max_mem.value_or(0),
+                             stats_timestamp_ms(ts.timestamp)});
+        }
+
+        void set_alerts_firing(std::size_t n) noexcept { alerts_firing_ = n; }
+
+    private:
+        friend class StatsExporter;
+
+        struct Endpoint
+        {
+            uint32_t off, len; // node label in text_
+            bool up;
+            uint64_t frames;
+            uint64_t gaps;
+        };
+
+        struct Row
+        {
+            uint32_t off, len; // container ID in text_
+            uint32_t endpoint;
+            bool has_cpu, has_mem, stale;
+            double cpu;
+            uint64_t mem;
+            uint64_t ts_ms;
+        };
+
+        uint32_t intern_(std::string_view s)
+        {
+            const auto off = static_cast<uint32_t>(text_.size());
+            text_.append(s);
+            return off;
+        }
+
+        std::string_view str_(uint32_t off, uint32_t len) const noexcept
+        {
+            return std::string_view{text_}.substr(off, len);
+        }
+
+        std::string text_;                // labels back to back
+        std::vector<Endpoint> endpoints_;
+        std::vector<Row> rows_;
+        std::size_t alerts_firing_{};
+    };
+
+    explicit StatsExporter(Config cfg);
+    ~StatsExporter();
+
+    StatsExporter(const StatsExporter &) = delete;
+    StatsExporter &operator=(const StatsExporter &) = delete;
+
+    /** A scrape is waiting for a fresh snapshot (UI thread polls this). */
+    [[nodiscard]] bool wanted() const noexcept { return want_.load(std::memory_order_acquire); }
+
+    /**
+     * Fill a snapshot with `fill(Snapshot &)` and hand it to the waiting
+     * scrape.  The filling happens outside the lock, which only covers the
+     * O(1) swap.  Called from one thread (the UI) only.
+     */
+    template <typename Fill>
+    void publish(Fill &&fill)
+    {
+        fill_.clear();
+        fill(fill_);
+        {
+            std::lock_guard lk{mtx_};
+            std::swap(back_, fill_);
+            ++generation_;
+            want_.store(false, std::memory_order_release);
+        }
+        cv_.notify_one();
+    }
+
+    [[nodiscard]] Metrics metrics() const;
+    [[nodiscard]] const std::string &listen() const noexcept { return cfg_.listen; }
+
+private:
+    struct Client;
+
+    void run_();
+    void serve_(Client &c);
+    const Snapshot &snapshot_();
+    void render_(const Snapshot &snap, bool openmetrics, std::string &out);
+
+    Config cfg_;
+    int listen_fd_{-1};
+    int epfd_{-1};
+    int wakefd_{-1};
+    std::string unix_path_; // unlinked on shutdown
+
+    std::atomic<bool> want_{false};
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    Snapshot fill_;          // UI thread only, filled by publish()
+    Snapshot back_;          // newest published, under mtx_
+    uint64_t generation_{};  // bumped per publish
+    Metrics metrics_{};      // under mtx_
+
+    // exporter thread only
+    Snapshot front_;                  // being rendered
+    std::string labels_;              // escaped {node,id} block per row, rebuilt per render
+    std::vector<uint32_t> label_end_; // row i's block is [label_end_[i-1], label_end_[i])
+    uint64_t seen_generation_{};
+    std::vector<std::string> spare_;  // response buffers, capacity kept
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+#endif
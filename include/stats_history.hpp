@@ -0,0 +1,192 @@
+// stats_history.hpp — fixed‑capacity per‑container sample history (SoA)
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_HISTORY_HPP
+#define CP_STATS_HISTORY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "stats_model.hpp"
+
+/**
+ * StatsHistory
+ * ------------
+ * Ring of the last `depth` samples for every container, laid out as a
+ * structure of arrays: one contiguous column each for timestamps, CPU and
+ * memory, indexed by `slot * depth + i`.  A *slot* is the dense index the
+ * caller assigns to a container.
+ *
+ *   - `append()` is O(1) and allocation‑free once the slot's storage exists;
+ *     columns grow geometrically only when a higher slot shows up.
+ *   - Total memory is capped by `budget_bytes`; slots beyond the budget are
+ *     simply not recorded (`append()` returns false).
+ */
+class StatsHistory
+{
+public:
+    using Slot = uint32_t;
+
+    enum class Metric
+    {
+        Cpu,
+        Mem
+    };
+
+    struct Config
+    {
+        std::size_t depth = 60;                  //!< samples kept per container
+        std::size_t budget_bytes = 32u << 20;    //!< cap for all columns together
+    };
+
+    /** Bytes of column storage one container costs at a given depth. */
+    static constexpr std::size_t bytes_per_slot(std::size_t depth) noexcept
+    {
+        return depth * (sizeof(uint64_t) + sizeof(float) + sizeof(uint64_t)) +
+               2 * sizeof(uint32_t); // head + count
+    }
+
+    StatsHistory() : StatsHistory(Config{}) {}
+
+    explicit StatsHistory(Config cfg)
+        : depth_{std::max<std::size_t>(cfg.depth, 1)},
+          max_slots_{cfg.budget_bytes / bytes_per_slot(depth_)}
+    {
+    }
+
+    /** Record a sample; false if `slot` is outside the memory budget. */
+    bool append(Slot slot, const TimestampedStats &ts)
+    {
+        if (slot >= max_slots_)
+            return false;
+        if (slot >= head_.size())
+            grow_(slot);
+
+        uint32_t &head = head_[slot];
+        uint32_t &count = count_[slot];
+
+        // Skip duplicates: the same sample may be re‑delivered on reconnect.
+        if (count && ts_[index_(slot, (head + depth_ - 1) % depth_)] == ts.timestamp)
+            return true;
+
+        const std::size_t i = index_(slot, head);
+        ts_[i] = ts.timestamp;
+        cpu_[i] = static_cast<float>(ts.stats.cpu_avg.value_or(0.0));
+        mem_[i] = ts.stats.max_mem.value_or(0);
+
+        head = static_cast<uint32_t>((head + 1) % depth_);
+        if (count < depth_)
+            ++count;
+        return true;
+    }
+
+    /** Forget a slot's samples (e.g. when the slot is reused). */
+    void reset(Slot slot) noexcept
+    {
+        if (slot < head_.size())
+            head_[slot] = count_[slot] = 0;
+    }
+
+    [[nodiscard]] std::size_t size(Slot slot) const noexcept
+    {
+        return slot < count_.size() ? count_[slot] : 0;
+    }
+
+    [[nodiscard]] std::size_t depth() const noexcept { return depth_; }
+    [[nodiscard]] std::size_t max_slots() const noexcept { return max_slots_; }
+
+    /** Bytes currently allocated for all columns. */
+    [[nodiscard]] std::size_t bytes() const noexcept
+    {
+        return head_.size() * bytes_per_slot(depth_);
+    }
+
+    /** Sample `i` of a slot, 0 = oldest. */
+    [[nodiscard]] uint64_t timestamp(Slot slot, std::size_t i) const noexcept
+    {
+        return ts_[logical_(slot, i)];
+    }
+    [[nodiscard]] float cpu(Slot slot, std::size_t i) const noexcept
+    {
+        return cpu_[logical_(slot, i)];
+    }
+    [[nodiscard]] uint64_t mem(Slot slot, std::size_t i) const noexcept
+    {
+        return mem_[logical_(slot, i)];
+    }
+
+    /**
+     * Render the newest `width` samples of one metric as an ASCII sparkline
+     * into `out` (NUL‑terminated, `out` must hold width + 1 chars).  Samples
+     * are scaled against the largest value in the window, so a spike stands
+     * out while a steady load draws a flat line.  Cost is O(width).
+     */
+    void sparkline(Slot slot, Metric metric, char *out, std::size_t width) const noexcept
+    {
+        static constexpr char kRamp[] = " .:-=+*#%@";
+        static constexpr std::size_t kLevels = sizeof(kRamp) - 2;
+
+        const std::size_t n = std::min(size(slot), width);
+        const std::size_t first = size(slot) - n;
+
+        double peak = 0.0;
+        for (std::size_t i = 0; i < n; ++i)
+            peak = std::max(peak, value_(slot, metric, first + i));
+
+        std::size_t pos = 0;
+        for (; pos < width - n; ++pos)
+            out[pos] = ' '; // right‑align: newest sample is the last column
+        for (std::size_t i = 0; i < n; ++i, ++pos)
+        {
+            const double v = value_(slot, metric, first + i);
+            const std::size_t level =
+                peak > 0.0 ? static_cast<std::size_t>(v / peak * kLevels + 0.5) : 0;
+            out[pos] = kRamp[std::min(level, kLevels)];
+        }
+        out[pos] = '\0';
+    }
+
+private:
+    std::size_t index_(Slot slot, std::size_t i) const noexcept
+    {
+        return static_cast<std::size_t>(slot) * depth_ + i;
+    }
+
+    std::size_t logical_(Slot slot, std::size_t i) const noexcept
+    {
+        const std::size_t oldest = (head_[slot] + depth_ - count_[slot]) % depth_;
+        return index_(slot, (oldest + i) % depth_);
+    }
+
+    double value_(Slot slot, Metric metric, std::size_t i) const noexcept
+    {
+        return metric == Metric::Cpu ? static_cast<double>(cpu(slot, i))
+                                     : static_cast<double>(mem(slot, i));
+    }
+
+    void grow_(Slot slot)
+    {
+        const std::size_t slots =
+            std::min(std::max<std::size_t>(slot + 1, head_.size() * 2), max_slots_);
+        head_.resize(slots, 0);
+        count_.resize(slots, 0);
+        ts_.resize(slots * depth_);
+        cpu_.resize(slots * depth_);
+        mem_.resize(slots * depth_);
+    }
+
+    const std::size_t depth_;
+    const std::size_t max_slots_;
+
+    // columns, slot‑major: [slot * depth_ + ring index]
+    std::vector<uint64_t> ts_;
+    std::vector<float> cpu_;
+    std::vector<uint64_t> mem_;
+
+    // per‑slot ring state
+    std::vector<uint32_t> head_;  // next write position
+    std::vector<uint32_t> count_; // valid samples (≤ depth_)
+};
+
+#endif
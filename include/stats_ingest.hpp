@@ -0,0 +1,225 @@
+// stats_ingest.hpp — merge of the endpoint mailboxes into the container ledger
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_INGEST_HPP
+#define CP_STATS_INGEST_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "container_order.hpp"
+#include "container_table.hpp"
+#include "host_stats.hpp"
+#include "stats_aggregator.hpp"
+#include "stats_alerts.hpp"
+#include "stats_expiry.hpp"
+#include "stats_exporter.hpp"
+#include "stats_history.hpp"
+#include "stats_mailbox.hpp"
+#include "stats_model.hpp"
+#include "stats_rollup.hpp"
+
+/**
+ * StatsIngest
+ * -----------
+ * The UI thread's side of stats ingest, without any drawing.  `pump()`
+ * drains every endpoint mailbox and merges the batches into the slot‑indexed
+ * ledger and what is kept per slot next to it: history, rollups, expiry
+ * timers, alert state, per‑host totals and the sorted view.  It then expires
+ * containers that went silent and, if a scrape is waiting, hands the
+ * exporter a snapshot.
+ *
+ * `StatsWindow` owns one and draws from it; the ingest bench drives the same
+ * object, so the merge cost it reports is the console's.
+ *
+ * Alert transitions go to the sink set with `on_alert()`.  Frames merged by
+ * `pump()` are listed in `merged()` (up to 4096) until `clear_merged()`, so
+ * the caller can tell when they reached the screen.
+ */
+class StatsIngest
+{
+public:
+    using AlertSink = std::function<void(const StatsAlerts::Event &)>;
+
+    struct Merged
+    {
+        std::size_t endpoint;
+        StatsStamp stamp;
+        int64_t merged_ns; //!< steady clock
+    };
+
+    explicit StatsIngest(StatsAggregator *stats,
+                         StatsHistory::Config history = {},
+                         StatsRollup::Config rollup = {},
+                         StatsExpiry::Config expiry = {},
+                         std::vector<StatsAlerts::Rule> alerts = {},
+                         StatsExporter *exporter = nullptr)
+        : stats_{stats}, exporter_{exporter}, history_{history}, rollup_{rollup}, expiry_{expiry},
+          alerts_{std::move(alerts)}, hostStats_{ledger_}
+    {
+        for (std::size_t i = 0; i < stats_->size(); ++i)
+        {
+            labels_.emplace_back(stats_endpoint_label(stats_->uri(i)));
+            hostStats_.add_endpoint(stats_->uri(i));
+        }
+    }
+
+    StatsIngest(const StatsIngest &) = delete; // hostStats_ refers to ledger_
+    StatsIngest &operator=(const StatsIngest &) = delete;
+
+    void on_alert(AlertSink sink) { sink_ = std::move(sink); }
+
+    /**
+     * Merge everything the mailboxes coalesced since the last call, expire
+     * silent containers and answer a waiting scrape.  Returns the entries
+     * merged (updates and removals).
+     */
+    std::size_t pump(uint64_t now_ms)
+    {
+        std::size_t entries = 0;
+        for (std::size_t i = 0; i < stats_->size(); ++i)
+        {
+            const auto src = static_cast<ContainerTable::Source>(i);
+            stats_->mailbox(i).drain(inbox_);
+            if (!inbox_.stamps().empty())
+            {
+                const int64_t mergedNs = steady_ns_();
+                auto &latency = stats_->latency(i);
+                for (const auto &stamp : inbox_.stamps())
+                {
+                    latency.merged(stamp, mergedNs);
+                    if (merged_.size() < kMaxMerged)
+                        merged_.push_back({i, stamp, mergedNs});
+                }
+            }
+            for (const auto &[id, ts] : inbox_)
+            {
+                auto [slot, inserted] = ledger_.upsert(src, id, ts); // overwrite newest
+                if (inserted)
+                {
+                    history_.reset(slot); // slot may be recycled
+                    rollup_.reset(slot);
+                }
+                history_.append(slot, ts);
+                rollup_.fold(slot, ts);
+                expiry_.touch(slot, stats_timestamp_ms(ts.timestamp), now_ms);
+                alerts_.update(slot, ts, [this](const StatsAlerts::Event &e) { emit_(e); });
+                hostStats_.update(slot, src, ts);
+                order_.touch(slot);
+                if (inbox_.full())
+                    listed_.push_back(slot);
+            }
+            for (const auto &id : inbox_.removed())
+            {
+                const auto slot = ledger_.find(src, id);
+                if (slot != ContainerTable::npos)
+                    forget_(slot, now_ms);
+            }
+
+            // the mailbox pruned containers it can no longer tombstone: this
+            // batch is the whole fleet of the source, drop everything else
+            if (inbox_.full())
+            {
+                std::sort(listed_.begin(), listed_.end());
+                unlisted_.clear();
+                for (const auto slot : ledger_.rows())
+                    if (ledger_.source(slot) == src && !std::binary_search(listed_.begin(), listed_.end(), slot))
+                        unlisted_.push_back(slot);
+                for (const auto slot : unlisted_)
+                    forget_(slot, now_ms);
+                listed_.clear();
+            }
+            entries += inbox_.size() + inbox_.removed().size();
+        }
+
+        // containers that went silent: dimmed after stale_after, gone after evict_after
+        expiry_.advance(now_ms, [this, now_ms](ContainerTable::Slot slot)
+                        {
+                            alerts_.forget(slot, now_ms, [this](const StatsAlerts::Event &e) { emit_(e); });
+                            hostStats_.erase(slot);
+                            ledger_.erase(slot);
+                            order_.touch(slot); });
+
+        // a scrape is waiting: hand it a flat copy, rendering happens off this thread
+        if (exporter_ && exporter_->wanted())
+            exporter_->publish([this](StatsExporter::Snapshot &snap)
+                               { fill_snapshot_(snap); });
+        return entries;
+    }
+
+    [[nodiscard]] const std::vector<Merged> &merged() const noexcept { return merged_; }
+    void clear_merged() noexcept { merged_.clear(); }
+
+    /** Endpoint host:port of a source. */
+    [[nodiscard]] const std::string &label(std::size_t source) const noexcept { return labels_[source]; }
+
+    [[nodiscard]] const ContainerTable &ledger() const noexcept { return ledger_; }
+    [[nodiscard]] const StatsHistory &history() const noexcept { return history_; }
+    [[nodiscard]] const StatsRollup &rollup() const noexcept { return rollup_; }
+    [[nodiscard]] const StatsExpiry &expiry() const noexcept { return expiry_; }
+    [[nodiscard]] const StatsAlerts &alerts() const noexcept { return alerts_; }
+    [[nodiscard]] HostStats &host_stats() noexcept { return hostStats_; }
+    [[nodiscard]] ContainerOrder &order() noexcept { return order_; }
+
+private:
+    static constexpr std::size_t kMaxMerged = 4096;
+
+    static int64_t steady_ns_()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void emit_(const StatsAlerts::Event &e)
+    {
+        if (sink_)
+            sink_(e);
+    }
+
+    // a container the source removed
+    void forget_(ContainerTable::Slot slot, uint64_t now_ms)
+    {
+        expiry_.forget(slot);
+        alerts_.forget(slot, now_ms, [this](const StatsAlerts::Event &e) { emit_(e); });
+        hostStats_.erase(slot);
+        ledger_.erase(slot);
+        order_.touch(slot);
+    }
+
+    void fill_snapshot_(StatsExporter::Snapshot &snap) const
+    {
+        for (std::size_t i = 0; i < stats_->size(); ++i)
+        {
+            const auto h = stats_->health(i);
+            const bool up = h.state == StatsAggregator::State::Open || h.state == StatsAggregator::State::Replay;
+            snap.add_endpoint(labels_[i], up, h.frames, h.gaps);
+        }
+        for (const ContainerTable::Slot slot : ledger_.rows())
+            snap.add_container(ledger_.source(slot), ledger_.id(slot), ledger_.stats(slot), expiry_.stale(slot));
+        snap.set_alerts_firing(alerts_.firing().size());
+    }
+
+    StatsAggregator *stats_;
+    StatsExporter *exporter_;          // optional scrape endpoint
+    std::vector<std::string> labels_;  // endpoint host:port, by source
+    StatsBatch inbox_;                 // drained updates, reused
+    ContainerTable ledger_;            // persistent, slot‑indexed
+    StatsHistory history_;             // per‑slot sample rings
+    StatsRollup rollup_;               // per‑slot 1s/10s/1m buckets
+    StatsExpiry expiry_;               // stale / evict timers per slot
+    StatsAlerts alerts_;               // rule state machines, evaluated on ingest
+    HostStats hostStats_;              // per‑host totals, maintained on ingest
+    ContainerOrder order_;             // sorted view, updated on ingest
+    AlertSink sink_;
+    std::vector<Merged> merged_;                 // merged, not yet cleared
+    std::vector<ContainerTable::Slot> listed_;   // slots named by a full drain
+    std::vector<ContainerTable::Slot> unlisted_; // ledger rows it left out
+};
+
+#endif
@@ -0,0 +1,124 @@
+// stats_latency.hpp — per‑endpoint ingest latency by stage
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_LATENCY_HPP
+#define CP_STATS_LATENCY_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "latency_histogram.hpp"
+#include "stats_model.hpp"
+
+/**
+ * StatsLatency
+ * ------------
+ * Where the time goes between a stats sample being taken on a node and it
+ * being on screen, one histogram per stage:
+ *
+ *   Wire   newest sample timestamp → frame received, clock‑offset corrected
+ *   Parse  frame received → decoded into a batch (ingest thread)
+ *   Queue  decoded → merged into the ledger by `StatsWindow::pumpQueue()`
+ *   Frame  merged → the frame showing it was presented
+ *   Total  Wire + everything after it, sample → screen
+ *
+ * The node's clock is not ours, so `observe()` estimates the offset the way
+ * NTP's minimum filter does: over a sliding window of two `kOffsetWindowMs`
+ * periods, the smallest (receive − sample) seen is taken to be pure clock
+ * offset with zero transit.  Wire therefore measures delay *above the best
+ * recently observed*, which is what grows when a server, link or socket
+ * backs up.  With second‑resolution server timestamps it is only good to a
+ * second.
+ *
+ * Stages are recorded from the ingest thread (Wire, Parse) and the UI thread
+ * (Queue, Frame, Total); all state the other side reads is atomic.
+ */
+class StatsLatency
+{
+public:
+    enum Stage : std::size_t
+    {
+        Wire,
+        Parse,
+        Queue,
+        Frame,
+        Total,
+        kStages,
+    };
+
+    static constexpr const char *kStageNames[kStages] = {"wire", "parse", "queue", "frame", "total"};
+    static constexpr uint64_t kOffsetWindowMs = 60'000;
+
+    /**
+     * Ingest thread: a frame that arrived at `received_ns` (steady) and was
+     * decoded by `parsed_ns` into `batch`.  Updates the offset estimate,
+     * records Wire and Parse, and returns the stamp that travels with the
+     * batch.  `recv_wall_ms` is the local wall clock at arrival.
+     */
+    StatsStamp observe(const StatsBatch &batch, uint64_t recv_wall_ms, int64_t received_ns, int64_t parsed_ns)
+    {
+        StatsStamp stamp{received_ns, parsed_ns, 0};
+        stages_[Parse].record(static_cast<uint64_t>(std::max<int64_t>(parsed_ns - received_ns, 0)) / 1000);
+
+        uint64_t newest = 0;
+        for (const auto &[id, ts] : batch)
+            newest = std::max(newest, stats_timestamp_ms(ts.timestamp));
+        if (newest == 0)
+            return stamp; // tombstones only
+
+        const int64_t delta = static_cast<int64_t>(recv_wall_ms) - static_cast<int64_t>(newest);
+        if (recv_wall_ms - window_start_ms_ >= kOffsetWindowMs)
+        {
+            prev_min_ = cur_min_;
+            cur_min_ = std::numeric_limits<int64_t>::max();
+            window_start_ms_ = recv_wall_ms;
+        }
+        cur_min_ = std::min(cur_min_, delta);
+        const int64_t offset = std::min(cur_min_, prev_min_);
+        offset_ms_.store(offset, std::memory_order_relaxed);
+
+        stamp.wire_us = static_cast<uint64_t>(delta - offset) * 1000;
+        stages_[Wire].record(stamp.wire_us);
+        return stamp;
+    }
+
+    /** UI thread: the batch carrying `stamp` was merged at `merged_ns`. */
+    void merged(const StatsStamp &stamp, int64_t merged_ns)
+    {
+        stages_[Queue].record(static_cast<uint64_t>(std::max<int64_t>(merged_ns - stamp.parsed_ns, 0)) / 1000);
+    }
+
+    /** UI thread: the frame showing it was presented at `shown_ns`. */
+    void shown(const StatsStamp &stamp, int64_t merged_ns, int64_t shown_ns)
+    {
+        stages_[Frame].record(static_cast<uint64_t>(std::max<int64_t>(shown_ns - merged_ns, 0)) / 1000);
+        stages_[Total].record(stamp.wire_us +
+                              static_cast<uint64_t>(std::max<int64_t>(shown_ns - stamp.received_ns, 0)) / 1000);
+    }
+
+    [[nodiscard]] const LatencyHistogram &stage(Stage s) const noexcept { return stages_[s]; }
+
+    /** Local minus server clock, ms (server transit folded in); 0 until the
+     *  first sample. */
+    [[nodiscard]] int64_t offset_ms() const noexcept { return offset_ms_.load(std::memory_order_relaxed); }
+
+    void reset() noexcept
+    {
+        for (auto &h : stages_)
+            h.reset();
+    }
+
+private:
+    std::array<LatencyHistogram, kStages> stages_;
+    std::atomic<int64_t> offset_ms_{0};
+
+    // ingest thread only
+    uint64_t window_start_ms_{};
+    int64_t cur_min_{std::numeric_limits<int64_t>::max()};
+    int64_t prev_min_{std::numeric_limits<int64_t>::max()};
+};
+
+#endif
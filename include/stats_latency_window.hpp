@@ -0,0 +1,196 @@
+#ifndef CP_STATS_LATENCY_WINDOW_HPP
+#define CP_STATS_LATENCY_WINDOW_HPP
+#include <inttypes.h>
+#include <imgui.h>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "latency_histogram.hpp"
+#include "stats_aggregator.hpp"
+#include "stats_latency.hpp"
+
+// p50 / p99 / max of every ingest stage, all endpoints together and one by one
+class StatsLatencyWindow
+{
+public:
+    explicit StatsLatencyWindow(StatsAggregator *stats) : stats_(stats)
+    {
+        for (std::size_t i = 0; i < stats_->size(); ++i)
+            labels_.emplace_back(stats_endpoint_label(stats_->uri(i)));
+        rows_.resize(stats_->size());
+    }
+
+    void draw(bool *open)
+    {
+        if (!open || !*open)
+            return;
+
+        ImGui::SetNextWindowPos({0, 1}, ImGuiCond_Once);
+        ImGui::SetNextWindowSize({110.f, 20.f}, ImGuiCond_Once);
+
+        if (!ImGui::Begin("Stats Latency", open, ImGuiWindowFlags_NoCollapse))
+        {
+            ImGui::End();
+            return;
+        }
+
+        refresh_();
+
+        if (ImGui::Button("Reset"))
+        {
+            for (std::size_t i = 0; i < stats_->size(); ++i)
+                stats_->latency(i).reset();
+            refreshedAt_ = {};
+        }
+        ImGui::SameLine();
+        ImGui::TextUnformatted("wire = sample → received (offset corrected), total = sample → screen");
+
+        drawStages_();
+        drawEndpoints_();
+
+        ImGui::End();
+    }
+
+private:
+    static constexpr auto kRefresh = std::chrono::milliseconds{500};
+
+    struct Summary
+    {
+        uint64_t count{};
+        uint64_t p50{};
+        uint64_t p99{};
+        uint64_t max{};
+    };
+
+    struct Row
+    {
+        std::array<Summary, StatsLatency::kStages> stages{};
+        int64_t offsetMs{};
+    };
+
+    static Summary summarize_(const LatencyHistogram::Snapshot &s)
+    {
+        return {s.total, s.percentile(0.50), s.percentile(0.99), s.max};
+    }
+
+    // histogram copies are ~9 KiB each: recompute twice a second, not per frame
+    void refresh_()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - refreshedAt_ < kRefresh)
+            return;
+        refreshedAt_ = now;
+
+        for (std::size_t s = 0; s < StatsLatency::kStages; ++s)
+        {
+            merged_ = {};
+            for (std::size_t i = 0; i < stats_->size(); ++i)
+            {
+                const auto &latency = stats_->latency(i);
+                snap_ = latency.stage(static_cast<StatsLatency::Stage>(s)).snapshot();
+                rows_[i].stages[s] = summarize_(snap_);
+                rows_[i].offsetMs = latency.offset_ms();
+                merged_.merge(snap_);
+            }
+            all_[s] = summarize_(merged_);
+        }
+    }
+
+    static const char *fmt_(uint64_t us, char *buf, std::size_t n)
+    {
+        if (us < 1'000)
+            std::snprintf(buf, n, "%" PRIu64 "us", us);
+        else if (us < 1'000'000)
+            std::snprintf(buf, n, "%.1fms", static_cast<double>(us) / 1e3);
+        else
+            std::snprintf(buf, n, "%.2fs", static_cast<double>(us) / 1e6);
+        return buf;
+    }
+
+    void drawStages_()
+    {
+        if (!ImGui::BeginTable("LatencyStages", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+            return;
+
+        ImGui::TableSetupColumn("Stage");
+        ImGui::TableSetupColumn("Frames");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("max");
+        ImGui::TableHeadersRow();
+
+        char buf[32];
+        for (std::size_t s = 0; s < StatsLatency::kStages; ++s)
+        {
+            const auto &sum = all_[s];
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(StatsLatency::kStageNames[s]);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%" PRIu64, sum.count);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::TextUnformatted(fmt_(sum.p50, buf, sizeof buf));
+            ImGui::TableSetColumnIndex(3);
+            ImGui::TextUnformatted(fmt_(sum.p99, buf, sizeof buf));
+            ImGui::TableSetColumnIndex(4);
+            ImGui::TextUnformatted(fmt_(sum.max, buf, sizeof buf));
+        }
+        ImGui::EndTable();
+    }
+
+    // one row per endpoint, each stage as p50/p99/max
+    void drawEndpoints_()
+    {
+        if (!ImGui::CollapsingHeader("Per endpoint"))
+            return;
+
+        if (!ImGui::BeginTable("LatencyEndpoints", 2 + StatsLatency::kStages,
+                               ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY))
+            return;
+
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Endpoint");
+        ImGui::TableSetupColumn("Offset");
+        for (const char *name : StatsLatency::kStageNames)
+            ImGui::TableSetupColumn(name);
+        ImGui::TableHeadersRow();
+
+        char a[16], b[16], c[16];
+        ImGuiListClipper clip;
+        clip.Begin(static_cast<int>(rows_.size()));
+        while (clip.Step())
+        {
+            for (int i = clip.DisplayStart; i < clip.DisplayEnd; ++i)
+            {
+                const auto &row = rows_[i];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(labels_[i].c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%+" PRId64 "ms", row.offsetMs);
+                for (std::size_t s = 0; s < StatsLatency::kStages; ++s)
+                {
+                    const auto &sum = row.stages[s];
+                    ImGui::TableSetColumnIndex(static_cast<int>(2 + s));
+                    if (sum.count)
+                        ImGui::Text("%s/%s/%s", fmt_(sum.p50, a, sizeof a), fmt_(sum.p99, b, sizeof b),
+                                    fmt_(sum.max, c, sizeof c));
+                    else
+                        ImGui::TextUnformatted("-");
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    StatsAggregator *stats_;
+    std::vector<std::string> labels_;                 // endpoint host:port
+    std::vector<Row> rows_;                           // per endpoint, as of refreshedAt_
+    std::array<Summary, StatsLatency::kStages> all_{}; // every endpoint merged
+    LatencyHistogram::Snapshot snap_;                 // scratch
+    LatencyHistogram::Snapshot merged_;               // scratch
+    std::chrono::steady_clock::time_point refreshedAt_{};
+};
+#endif
@@ -0,0 +1,318 @@
+// stats_mailbox.hpp — latest‑wins, bounded hand‑off from stats ingest to UI
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_MAILBOX_HPP
+#define CP_STATS_MAILBOX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "stats_model.hpp"
+#include "string_utils.hpp"
+
+/**
+ * StatsMailbox
+ * ------------
+ * Coalescing channel between the ingest thread (producer) and the UI thread
+ * (consumer).  Instead of queueing whole snapshots, the mailbox keeps one slot
+ * per container holding the newest stats that the consumer has not seen yet:
+ *
+ *   - `publish()` merges a batch into the slots; an update to a slot that is
+ *     still pending simply overwrites it (counted as *coalesced*).
+ *   - `drain()` copies every pending slot out and marks it clean.
+ *
+ * Memory is therefore bounded by the number of distinct containers, capped at
+ * `max_entries`, no matter how long the consumer stays away.  Slots that were
+ * already delivered keep their ID string, so steady‑state publishing does not
+ * allocate; they sit on an intrusive list in delivery order, and when the cap
+ * is reached a new container takes the longest‑delivered one (O(1), its node
+ * recycled).  Only if every slot is still pending is a new container dropped.
+ *
+ * Slots the consumer frees (delivered tombstones) are not deallocated but
+ * parked, node and ID buffer together, for the producer's next new
+ * container, so container churn does not ping‑pong malloc/free between the
+ * two threads either.
+ *
+ * Delta frames add removals: a tombstone replaces whatever the slot held and
+ * is delivered as a removal, after which the slot is freed.  A full snapshot
+ * (`StatsBatch::full()`) tombstones every container it does not mention, so
+ * a resync after a sequence gap also clears containers whose removal was
+ * lost.  Pruned containers are no longer known here to be tombstoned, so the
+ * first full snapshot after a prune is drained as `full()` too: the consumer
+ * then drops whatever the drained batch does not list.
+ *
+ * The batches' `StatsStamp`s travel along (up to 4096 between drains), so
+ * the consumer can tell how long each frame waited here.
+ *
+ * Both sides hold the mutex only for the merge/copy itself — decoding and
+ * rendering happen outside it.
+ */
+class StatsMailbox
+{
+public:
+    struct Metrics
+    {
+        std::size_t depth{};      //!< containers with an undelivered update
+        std::size_t slots{};      //!< containers tracked (≤ max_entries)
+        uint64_t published{};     //!< batches published
+        uint64_t updates{};       //!< entries published
+        uint64_t coalesced{};     //!< entries that overwrote an undelivered one
+        uint64_t dropped{};       //!< entries rejected because the mailbox was full
+        uint64_t delivered{};     //!< entries handed to the consumer
+        uint64_t removed{};       //!< tombstones published (incl. full‑snapshot reconcile)
+    };
+
+    explicit StatsMailbox(std::size_t max_entries = 100'000) : max_entries_{max_entries}
+    {
+        pending_.reserve(1024);
+        spare_.reserve(kMaxSpare);
+    }
+
+    // ---------------------------------------------------------------------
+    // Producer side
+    // ---------------------------------------------------------------------
+
+    /** Merge a batch of (id, stats) pairs — latest wins per container. */
+    template <typename Range>
+    void publish(const Range &batch)
+    {
+        std::lock_guard lock{mtx_};
+        for (const auto &[id, ts] : batch)
+            upsert_(id, ts);
+        ++metrics_.published;
+    }
+
+    /** Merge a decoded frame, applying its tombstones and, if it is a full
+     *  snapshot, removing every container it does not list. */
+    void publish(const StatsBatch &batch)
+    {
+        std::lock_guard lock{mtx_};
+        if (batch.full())
+            ++generation_;
+        const uint64_t dropped = metrics_.dropped;
+        for (const auto &[id, ts] : batch)
+            upsert_(id, ts);
+        for (const auto &id : batch.removed())
+            tombstone_(id);
+        if (batch.full())
+        {
+            reconcile_();
+            // every live slot is now pending, so the next drain lists the
+            // whole fleet — unless some of it did not fit
+            if (pruned_ && metrics_.dropped == dropped)
+            {
+                pruned_ = false;
+                listing_ = true;
+            }
+        }
+        for (const auto &stamp : batch.stamps())
+        {
+            if (stamps_.size() < kMaxStamps)
+                stamps_.push_back(stamp);
+        }
+        ++metrics_.published;
+    }
+
+    // ---------------------------------------------------------------------
+    // Consumer side
+    // ---------------------------------------------------------------------
+
+    /**
+     * Move every pending update and removal into `out` (cleared first) and
+     * mark the slots delivered.  Returns the number of entries copied.
+     */
+    std::size_t drain(StatsBatch &out)
+    {
+        out.clear();
+
+        std::lock_guard lock{mtx_};
+        for (auto *slot : pending_)
+        {
+            if (slot->second.removed)
+            {
+                out.remove(slot->first);
+                recycle_(slots_.extract(slots_.find(std::string_view{slot->first})));
+                continue;
+            }
+            out.add(slot->first, slot->second.ts);
+            slot->second.dirty = false;
+            link_clean_(*slot);
+        }
+        if (std::exchange(listing_, false))
+        {
+            out.set_seq(0);
+            out.set_full(true);
+        }
+        for (const auto &stamp : stamps_)
+            out.add_stamp(stamp);
+        stamps_.clear();
+        metrics_.delivered += pending_.size();
+        pending_.clear(); // keeps capacity
+        return out.size() + out.removed().size();
+    }
+
+    [[nodiscard]] Metrics metrics() const
+    {
+        std::lock_guard lock{mtx_};
+        Metrics m = metrics_;
+        m.depth = pending_.size();
+        m.slots = slots_.size();
+        return m;
+    }
+
+private:
+    struct Slot;
+    using Entry = std::pair<const std::string, Slot>;
+
+    struct Slot
+    {
+        TimestampedStats ts{};
+        uint64_t generation{}; // last full snapshot that listed it
+        Entry *older{};        // clean list neighbours (delivered, not dirty)
+        Entry *newer{};
+        bool dirty{false};
+        bool removed{false}; // pending tombstone
+    };
+
+    // frames stamped while the consumer was away; beyond this the oldest are kept
+    static constexpr std::size_t kMaxStamps = 4096;
+    // freed slots kept for reuse; beyond this they are deallocated
+    static constexpr std::size_t kMaxSpare = 1024;
+
+    using SlotMap = std::unordered_map<std::string, Slot, util::string_hash, std::equal_to<>>;
+
+    void upsert_(std::string_view id, const TimestampedStats &ts)
+    {
+        ++metrics_.updates;
+
+        auto it = slots_.find(id);
+        if (it == slots_.end())
+        {
+            if (slots_.size() >= max_entries_ && !prune_())
+            {
+                ++metrics_.dropped;
+                return;
+            }
+            it = insert_(id);
+        }
+
+        Slot &slot = it->second;
+        mark_dirty_(*it);
+        slot.ts = ts;
+        slot.generation = generation_;
+        slot.removed = false;
+    }
+
+    void tombstone_(std::string_view id)
+    {
+        ++metrics_.removed;
+
+        // An unknown ID still gets a tombstone: the slot may have been pruned
+        // after the consumer saw it.
+        auto it = slots_.find(id);
+        if (it == slots_.end())
+        {
+            if (slots_.size() >= max_entries_ && !prune_())
+            {
+                ++metrics_.dropped;
+                return;
+            }
+            it = insert_(id);
+        }
+        mark_dirty_(*it);
+        it->second.removed = true;
+    }
+
+    /** New slot for `id`, reusing a parked node when there is one. */
+    SlotMap::iterator insert_(std::string_view id)
+    {
+        if (spare_.empty())
+            return slots_.emplace(std::string{id}, Slot{}).first;
+        auto node = std::move(spare_.back());
+        spare_.pop_back();
+        node.key().assign(id);
+        node.mapped() = Slot{};
+        return slots_.insert(std::move(node)).position;
+    }
+
+    void recycle_(SlotMap::node_type node)
+    {
+        if (spare_.size() < kMaxSpare)
+            spare_.push_back(std::move(node));
+    }
+
+    /** Tombstone every live slot the current full snapshot did not list. */
+    void reconcile_()
+    {
+        for (auto &kv : slots_)
+        {
+            if (kv.second.generation == generation_ || kv.second.removed)
+                continue;
+            ++metrics_.removed;
+            mark_dirty_(kv);
+            kv.second.removed = true;
+        }
+    }
+
+    void mark_dirty_(Entry &kv)
+    {
+        if (kv.second.dirty)
+            ++metrics_.coalesced;
+        else
+        {
+            unlink_clean_(kv);
+            pending_.push_back(&kv); // element pointers survive rehashing
+        }
+        kv.second.dirty = true;
+    }
+
+    void link_clean_(Entry &kv) noexcept
+    {
+        kv.second.older = newest_;
+        kv.second.newer = nullptr;
+        (newest_ ? newest_->second.newer : oldest_) = &kv;
+        newest_ = &kv;
+    }
+
+    void unlink_clean_(Entry &kv) noexcept
+    {
+        if (oldest_ != &kv && !kv.second.older)
+            return; // a fresh slot, never delivered
+        (kv.second.older ? kv.second.older->second.newer : oldest_) = kv.second.newer;
+        (kv.second.newer ? kv.second.newer->second.older : newest_) = kv.second.older;
+        kv.second.older = kv.second.newer = nullptr;
+    }
+
+    /** Free the longest‑delivered slot; false if everything is pending. */
+    bool prune_()
+    {
+        if (!oldest_)
+            return false;
+        Entry &kv = *oldest_;
+        unlink_clean_(kv);
+        recycle_(slots_.extract(slots_.find(std::string_view{kv.first})));
+        pruned_ = true;
+        return true;
+    }
+
+    const std::size_t max_entries_;
+
+    mutable std::mutex mtx_;
+    SlotMap slots_;                              // one per known container
+    std::vector<Entry *> pending_;               // slots with dirty == true
+    std::vector<StatsStamp> stamps_;             // timing of the frames behind pending_
+    std::vector<SlotMap::node_type> spare_;      // freed slots, ID capacity kept
+    Entry *oldest_{};                            // clean list, in delivery order
+    Entry *newest_{};
+    uint64_t generation_{}; // bumped by every full snapshot
+    bool pruned_{false};    // delivered slots were freed since the last listing
+    bool listing_{false};   // the next drain lists every live container
+    Metrics metrics_{};
+};
+
+#endif
@@ -3,7 +3,11 @@
 #include <cstdint>
 #include <map>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
@@ -19,5 +23,117 @@ struct TimestampedStats
     uint64_t timestamp; // u64  -> uint64_t
 };
 
+/**
+ * The stats server reports `timestamp` as Unix time; depending on the server
+ * build (and on what a container runtime passes through) that is seconds,
+ * milliseconds, microseconds or nanoseconds.  Each unit is told apart by
+ * magnitude, the boundaries being year 5138 in the finer unit: below 1e11 is
+ * seconds, below 1e14 milliseconds, below 1e17 microseconds, else nanoseconds.
+ */
+inline uint64_t stats_timestamp_ms(uint64_t ts) noexcept
+{
+    if (ts < 100'000'000'000ull)
+        return ts * 1000;
+    if (ts < 100'000'000'000'000ull)
+        return ts;
+    if (ts < 100'000'000'000'000'000ull)
+        return ts / 1000;
+    return ts / 1'000'000;
+}
+
+/**
+ * When one decoded frame passed the ingest stages, for latency accounting.
+ * `received_ns` / `parsed_ns` are steady‑clock nanoseconds; `wire_us` is how
+ * far the frame's newest sample was behind the local clock on arrival, after
+ * correcting for the endpoint's estimated clock offset.
+ */
+struct StatsStamp
+{
+    int64_t received_ns{};
+    int64_t parsed_ns{};
+    uint64_t wire_us{};
+};
+
 // key = container ID (string), value = TimestampedStats
 using StatsMap = std::map<std::string, TimestampedStats>; // BTreeMap -> std::map
+
+/**
+ * StatsBatch — reusable staging list of (container ID, stats) pairs, plus the
+ * tombstones and sequencing of a delta‑mode frame.
+ * `clear()` keeps the entries and their string capacity, so refilling a batch
+ * of roughly the same shape every frame does not allocate.
+ *
+ * A plain snapshot frame leaves `delta()` false.  A delta frame carries a
+ * sequence number, a `full()` flag (the upserts are the complete fleet, so
+ * anything not listed is gone) and explicit removals.
+ */
+class StatsBatch
+{
+public:
+    using Entry = std::pair<std::string, TimestampedStats>;
+
+    void clear() noexcept
+    {
+        size_ = 0;
+        removed_size_ = 0;
+        stamps_.clear();
+        delta_ = full_ = false;
+        seq_ = 0;
+    }
+
+    void add(std::string_view id, const TimestampedStats &ts)
+    {
+        if (size_ == entries_.size())
+            entries_.emplace_back();
+        auto &e = entries_[size_++];
+        e.first.assign(id);
+        e.second = ts;
+    }
+
+    void remove(std::string_view id)
+    {
+        if (removed_size_ == removed_.size())
+            removed_.emplace_back();
+        removed_[removed_size_++].assign(id);
+    }
+
+    /** Ingest timing of a frame in this batch; a drained batch carries one
+     *  per frame that was coalesced into it. */
+    void add_stamp(const StatsStamp &stamp) { stamps_.push_back(stamp); }
+
+    void set_seq(uint64_t seq) noexcept
+    {
+        delta_ = true;
+        seq_ = seq;
+    }
+    void set_full(bool full) noexcept { full_ = full; }
+
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0 && removed_size_ == 0; }
+
+    const Entry *begin() const noexcept { return entries_.data(); }
+    const Entry *end() const noexcept { return entries_.data() + size_; }
+
+    /** IDs the frame tombstoned. */
+    [[nodiscard]] std::span<const std::string> removed() const noexcept
+    {
+        return {removed_.data(), removed_size_};
+    }
+
+    [[nodiscard]] std::span<const StatsStamp> stamps() const noexcept { return stamps_; }
+
+    [[nodiscard]] bool delta() const noexcept { return delta_; }
+    [[nodiscard]] uint64_t seq() const noexcept { return seq_; }
+    /** Delta frame that replaces the whole fleet. */
+    [[nodiscard]] bool full() const noexcept { return delta_ && full_; }
+
+private:
+    std::vector<Entry> entries_;
+    std::size_t size_{};
+    std::vector<std::string> removed_;
+    std::size_t removed_size_{};
+    std::vector<StatsStamp> stamps_;
+    bool delta_{false};
+    bool full_{false};
+    uint64_t seq_{};
+};
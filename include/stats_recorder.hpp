@@ -0,0 +1,207 @@
+// stats_recorder.hpp — append‑only compressed stats recording and replay
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_RECORDER_HPP
+#define CP_STATS_RECORDER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "stats_model.hpp"
+#include "string_utils.hpp"
+
+/**
+ * Recording format
+ * ----------------
+ * A recording is a directory of segments, `stats-<first ms>.rzs`, each with a
+ * sparse time index next to it, `stats-<first ms>.rzi`.
+ *
+ *   segment  = "RZSTATS1" u32 version, u32 endpoint count, {u16 len, uri}…,
+ *              then blocks
+ *   block    = u32 'RZB1', u32 raw length, u32 compressed length,
+ *              u32 crc32 (raw), u64 first ms, u64 last ms, u32 records,
+ *              u32 flags (1 = keyframe), zlib data
+ *   record   = u8 flags (1 = full, 2 = keyframe), u8 0, u16 endpoint,
+ *              u64 receive ms, u32 entries, u32 removals,
+ *              entries  {u16 len, id, u8 present, f64 cpu, u64 mem, u64 ts}…,
+ *              removals {u16 len, id}…
+ *   index    = one {u64 first ms, u64 last ms, u64 offset, u32 records,
+ *              u32 flags} per block
+ *
+ * Integers are little‑endian.  A record is one batch the aggregator applied
+ * to an endpoint's mailbox — delta frames included — so replaying a stretch
+ * only makes sense from a *keyframe*: a block that opens with a full snapshot
+ * of every endpoint.  Keyframe blocks are written every `keyframe_every` and
+ * every segment starts with one, so any segment can be replayed on its own.
+ * The index is a convenience; a reader that finds it missing or short (crash
+ * before it was written) walks the block headers instead.
+ */
+
+/**
+ * StatsRecorder
+ * -------------
+ * Tees applied stats batches into a recording.  `record()` is called from the
+ * ingest threads and only encodes into an in‑memory block under a mutex;
+ * compression and file I/O run on the recorder's own thread, which seals a
+ * block when it reaches `block_bytes` or is `flush_every` old, so a crash
+ * loses at most that much.  Segments roll over at the first keyframe after
+ * `segment_bytes`.
+ *
+ * Keyframes need the current state of every endpoint, so the recorder keeps
+ * a shadow copy of each, merged exactly like `StatsMailbox` merges them.
+ *
+ * The constructor throws if the directory cannot be created; a write error
+ * later is logged once and stops the recording.
+ */
+class StatsRecorder
+{
+public:
+    struct Config
+    {
+        std::filesystem::path dir;
+        std::size_t segment_bytes = 64u << 20;     //!< soft cap, rolls at the next keyframe
+        std::size_t block_bytes = 256u << 10;      //!< uncompressed block size
+        std::chrono::seconds keyframe_every{60};
+        std::chrono::milliseconds flush_every{1'000};
+        int level = 1;                             //!< zlib level; speed over ratio
+    };
+
+    struct Metrics
+    {
+        uint64_t records{};     //!< batches recorded (keyframes included)
+        uint64_t blocks{};      //!< blocks written
+        uint64_t segments{};    //!< segments opened
+        uint64_t raw_bytes{};   //!< encoded bytes before compression
+        uint64_t file_bytes{};  //!< bytes written to segments
+        bool failed{false};     //!< a write error stopped the recording
+    };
+
+    StatsRecorder(std::vector<std::string> endpoints, Config cfg);
+    ~StatsRecorder();
+
+    StatsRecorder(const StatsRecorder &) = delete;
+    StatsRecorder &operator=(const StatsRecorder &) = delete;
+
+    /** Append a batch that was applied to `endpoint` at wall clock `recv_ms`. */
+    void record(std::size_t endpoint, uint64_t recv_ms, const StatsBatch &batch);
+
+    [[nodiscard]] Metrics metrics() const;
+
+private:
+    using State = std::unordered_map<std::string, TimestampedStats, util::string_hash, std::equal_to<>>;
+
+    struct Block
+    {
+        std::string raw;
+        uint64_t first_ms{};
+        uint64_t last_ms{};
+        uint32_t records{};
+        bool keyframe{false};
+    };
+
+    void apply_(State &state, const StatsBatch &batch);
+    void encode_(std::size_t endpoint, uint64_t recv_ms, const StatsBatch &batch, uint8_t flags);
+    void keyframe_(uint64_t now_ms);
+    void seal_();
+    void run_();
+    bool write_(Block &block, std::string &zbuf);
+    bool open_segment_(uint64_t first_ms);
+    void close_segment_();
+
+    Config cfg_;
+    std::vector<std::string> endpoints_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<State> state_;      // per endpoint, as the mailbox sees it
+    StatsBatch scratch_;            // keyframe staging
+    Block open_;                    // block being filled
+    std::deque<Block> sealed_;      // waiting for the writer
+    std::vector<std::string> spare_; // raw buffers handed back by the writer
+    uint64_t next_keyframe_ms_{};
+    std::chrono::steady_clock::time_point opened_at_{};
+    bool stopping_{false};
+    Metrics metrics_{};
+
+    // writer thread only
+    int seg_fd_{-1};
+    int idx_fd_{-1};
+    uint64_t seg_bytes_{};
+    std::thread thread_;
+};
+
+/**
+ * StatsReplay
+ * -----------
+ * Reads a recording back.  Segments are mmapped and blocks inflated one at a
+ * time into a reused buffer, so replay runs at disk (or page cache) speed and
+ * memory stays at one block.  Endpoints are matched across segments by URI;
+ * `endpoints()` is the union, and `next()` reports indices into it.
+ *
+ * `seek(ms)` positions at the last keyframe at or before `ms` (or the first
+ * one), so the records up to `ms` rebuild the state; callers that scrub
+ * should apply those without pacing.
+ *
+ * The constructor throws if the directory holds no readable segment.
+ * Corrupt blocks end the segment they are in; replay goes on with the next.
+ */
+class StatsReplay
+{
+public:
+    explicit StatsReplay(const std::filesystem::path &dir);
+    ~StatsReplay();
+
+    StatsReplay(const StatsReplay &) = delete;
+    StatsReplay &operator=(const StatsReplay &) = delete;
+
+    [[nodiscard]] const std::vector<std::string> &endpoints() const noexcept { return endpoints_; }
+    [[nodiscard]] uint64_t begin_ms() const noexcept;
+    [[nodiscard]] uint64_t end_ms() const noexcept;
+
+    void seek(uint64_t ms);
+
+    /** Decode the next record into `batch`; false at the end of the recording. */
+    bool next(std::size_t &endpoint, uint64_t &recv_ms, StatsBatch &batch);
+
+private:
+    struct IndexEntry
+    {
+        uint64_t first_ms{};
+        uint64_t last_ms{};
+        uint64_t offset{};
+        uint32_t records{};
+        uint32_t flags{};
+    };
+
+    struct Segment
+    {
+        std::filesystem::path path;
+        const unsigned char *map{};
+        std::size_t size{};
+        std::vector<std::size_t> endpoint; // local index → union index
+        std::vector<IndexEntry> blocks;
+    };
+
+    bool open_(const std::filesystem::path &path, Segment &seg);
+    bool load_block_();
+
+    std::vector<Segment> segments_;
+    std::vector<std::string> endpoints_;
+
+    std::size_t seg_{};    // cursor: segment,
+    std::size_t block_{};  // block within it,
+    std::string raw_;      // its inflated records,
+    std::size_t pos_{};    // and the read position in them
+    bool loaded_{false};
+};
+
+#endif
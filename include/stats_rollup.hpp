@@ -0,0 +1,274 @@
+// stats_rollup.hpp — multi‑resolution min/max/avg rollups per container (SoA)
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_ROLLUP_HPP
+#define CP_STATS_ROLLUP_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "stats_model.hpp"
+
+/**
+ * StatsRollup
+ * -----------
+ * Folds every sample into fixed‑width time buckets on three tiers — by
+ * default 1 s × 120 (2 min), 10 s × 360 (1 h) and 1 min × 1440 (24 h) — each
+ * bucket holding count, min, max and sum of CPU and memory.  Like
+ * `StatsHistory` it is indexed by the caller's dense slot and stored as one
+ * column per field, `slot * depth + i`.
+ *
+ * A tier's ring is *direct‑mapped by time*: bucket number `e = t / width`
+ * lives at `e % depth` and remembers `e`, so folding is O(1) per tier with no
+ * head pointers, a bucket that still holds an older `e` is simply reused, and
+ * gaps in the stream read back as empty buckets.
+ *
+ *   - Memory per container is the constant `bytes_per_slot()` (60 KiB with
+ *     the defaults); slots beyond `budget_bytes` are not rolled up.  The
+ *     budget is a cap, allocated as slots are used: the default 512 MiB
+ *     covers ~8.7k containers.
+ *   - `summarize()` answers "min/avg/max over the last N" from the finest
+ *     tier that still covers the window, so a 24 h query reads 1440 buckets,
+ *     never 86 400 samples.
+ *
+ * Memory is kept in KiB (32 bits, up to 4 TiB) and sums in single precision
+ * (averages are accumulated in double at query time) to keep a bucket at 32
+ * bytes.
+ * Samples must arrive in timestamp order per slot; re‑delivered or older
+ * samples are ignored so a reconnect cannot double count.
+ */
+class StatsRollup
+{
+public:
+    using Slot = uint32_t;
+    static constexpr std::size_t kTiers = 3;
+
+    struct Tier
+    {
+        uint32_t width_s;  //!< bucket width in seconds
+        uint32_t depth;    //!< buckets kept
+    };
+
+    struct Config
+    {
+        std::array<Tier, kTiers> tiers{{{1, 120}, {10, 360}, {60, 1440}}};
+        std::size_t budget_bytes = 512u << 20; //!< cap for all tiers together
+    };
+
+    struct Summary
+    {
+        uint64_t count{};   //!< samples folded into the window, 0 = no data
+        float cpu_min{};
+        float cpu_max{};
+        double cpu_avg{};
+        uint64_t mem_min{}; //!< bytes
+        uint64_t mem_max{};
+        double mem_avg{};
+    };
+
+    static constexpr std::size_t kBucketBytes =
+        sizeof(uint32_t) * 2 + sizeof(float) * 3 + sizeof(uint32_t) * 2 + sizeof(float);
+
+    /** Bytes one container costs with a given tier layout. */
+    static constexpr std::size_t bytes_per_slot(const std::array<Tier, kTiers> &tiers) noexcept
+    {
+        std::size_t buckets = 0;
+        for (const auto &t : tiers)
+            buckets += t.depth;
+        return buckets * kBucketBytes + sizeof(uint64_t); // + last timestamp
+    }
+
+    StatsRollup() : StatsRollup(Config{}) {}
+
+    explicit StatsRollup(Config cfg)
+        : tiers_{sanitize_(cfg.tiers)},
+          max_slots_{cfg.budget_bytes / bytes_per_slot(tiers_)}
+    {
+    }
+
+    /** Fold a sample; false if `slot` is outside the budget or the sample
+     *  is not newer than the last one folded. */
+    bool fold(Slot slot, const TimestampedStats &ts)
+    {
+        if (slot >= max_slots_)
+            return false;
+        if (slot >= last_ms_.size())
+            grow_(slot);
+
+        const uint64_t ms = stats_timestamp_ms(ts.timestamp);
+        if (ms <= last_ms_[slot])
+            return false;
+        last_ms_[slot] = ms;
+
+        const float cpu = static_cast<float>(ts.stats.cpu_avg.value_or(0.0));
+        const uint32_t mem = static_cast<uint32_t>(
+            std::min<uint64_t>(ts.stats.max_mem.value_or(0) >> 10, std::numeric_limits<uint32_t>::max()));
+
+        for (std::size_t t = 0; t < kTiers; ++t)
+        {
+            const uint64_t e64 = ms / 1000 / tiers_[t].width_s;
+            const uint32_t e = static_cast<uint32_t>(e64);
+            Columns &c = cols_[t];
+            const std::size_t i = static_cast<std::size_t>(slot) * tiers_[t].depth + e64 % tiers_[t].depth;
+
+            if (c.epoch[i] != e || c.count[i] == 0)
+            {
+                c.epoch[i] = e;
+                c.count[i] = 0;
+                c.cpu_min[i] = c.cpu_max[i] = cpu;
+                c.cpu_sum[i] = 0.f;
+                c.mem_min[i] = c.mem_max[i] = mem;
+                c.mem_sum[i] = 0.f;
+            }
+            ++c.count[i];
+            c.cpu_min[i] = std::min(c.cpu_min[i], cpu);
+            c.cpu_max[i] = std::max(c.cpu_max[i], cpu);
+            c.cpu_sum[i] += cpu;
+            c.mem_min[i] = std::min(c.mem_min[i], mem);
+            c.mem_max[i] = std::max(c.mem_max[i], mem);
+            c.mem_sum[i] += static_cast<float>(mem);
+        }
+        return true;
+    }
+
+    /** Forget a slot's buckets (e.g. when the slot is reused). */
+    void reset(Slot slot) noexcept
+    {
+        if (slot >= last_ms_.size())
+            return;
+        last_ms_[slot] = 0;
+        for (std::size_t t = 0; t < kTiers; ++t)
+        {
+            const std::size_t first = static_cast<std::size_t>(slot) * tiers_[t].depth;
+            std::fill_n(cols_[t].count.begin() + first, tiers_[t].depth, 0u);
+        }
+    }
+
+    /**
+     * min/avg/max over the `window_s` seconds up to the slot's newest sample
+     * (not the wall clock, so a replayed or stalled stream still answers),
+     * read from the finest tier whose ring spans the window.  Windows longer
+     * than the coarsest tier are clipped to it.
+     */
+    [[nodiscard]] Summary summarize(Slot slot, uint64_t window_s) const noexcept
+    {
+        Summary s;
+        if (slot >= last_ms_.size() || last_ms_[slot] == 0)
+            return s;
+
+        const std::size_t t = tier_for(window_s);
+        const Tier &tier = tiers_[t];
+        const Columns &c = cols_[t];
+
+        const uint64_t last = last_ms_[slot] / 1000 / tier.width_s;
+        const uint64_t n = std::min<uint64_t>((window_s + tier.width_s - 1) / tier.width_s, tier.depth);
+        const std::size_t base = static_cast<std::size_t>(slot) * tier.depth;
+
+        double cpu_sum = 0.0, mem_sum = 0.0;
+        for (uint64_t k = 0; k < n && k <= last; ++k)
+        {
+            const uint64_t e = last - k;
+            const std::size_t i = base + e % tier.depth;
+            if (c.count[i] == 0 || c.epoch[i] != static_cast<uint32_t>(e))
+                continue;
+            if (s.count == 0)
+            {
+                s.cpu_min = c.cpu_min[i];
+                s.cpu_max = c.cpu_max[i];
+                s.mem_min = s.mem_max = c.mem_min[i];
+            }
+            s.count += c.count[i];
+            s.cpu_min = std::min(s.cpu_min, c.cpu_min[i]);
+            s.cpu_max = std::max(s.cpu_max, c.cpu_max[i]);
+            s.mem_min = std::min<uint64_t>(s.mem_min, c.mem_min[i]);
+            s.mem_max = std::max<uint64_t>(s.mem_max, c.mem_max[i]);
+            cpu_sum += c.cpu_sum[i];
+            mem_sum += c.mem_sum[i];
+        }
+        if (s.count)
+        {
+            s.cpu_avg = cpu_sum / static_cast<double>(s.count);
+            s.mem_avg = mem_sum / static_cast<double>(s.count) * 1024.0;
+            s.mem_min <<= 10;
+            s.mem_max <<= 10;
+        }
+        return s;
+    }
+
+    /** Finest tier whose ring covers `window_s` (else the coarsest). */
+    [[nodiscard]] std::size_t tier_for(uint64_t window_s) const noexcept
+    {
+        for (std::size_t t = 0; t < kTiers; ++t)
+        {
+            if (uint64_t{tiers_[t].width_s} * tiers_[t].depth >= window_s)
+                return t;
+        }
+        return kTiers - 1;
+    }
+
+    [[nodiscard]] const Tier &tier(std::size_t t) const noexcept { return tiers_[t]; }
+    [[nodiscard]] std::size_t max_slots() const noexcept { return max_slots_; }
+    /** Whether `slot` is within the budget, i.e. rolled up at all. */
+    [[nodiscard]] bool covers(Slot slot) const noexcept { return slot < max_slots_; }
+
+    /** Bytes currently allocated for all tiers. */
+    [[nodiscard]] std::size_t bytes() const noexcept
+    {
+        return last_ms_.size() * bytes_per_slot(tiers_);
+    }
+
+private:
+    // one tier, slot‑major: [slot * depth + e % depth]
+    struct Columns
+    {
+        std::vector<uint32_t> epoch;  // bucket number e = t / width
+        std::vector<uint32_t> count;  // samples, 0 = empty
+        std::vector<float> cpu_min;
+        std::vector<float> cpu_max;
+        std::vector<float> cpu_sum;
+        std::vector<uint32_t> mem_min; // KiB
+        std::vector<uint32_t> mem_max;
+        std::vector<float> mem_sum;
+    };
+
+    static std::array<Tier, kTiers> sanitize_(std::array<Tier, kTiers> tiers) noexcept
+    {
+        for (auto &t : tiers)
+        {
+            t.width_s = std::max<uint32_t>(t.width_s, 1);
+            t.depth = std::max<uint32_t>(t.depth, 1);
+        }
+        return tiers;
+    }
+
+    void grow_(Slot slot)
+    {
+        const std::size_t slots =
+            std::min(std::max<std::size_t>(slot + 1, last_ms_.size() * 2), max_slots_);
+        last_ms_.resize(slots, 0);
+        for (std::size_t t = 0; t < kTiers; ++t)
+        {
+            const std::size_t n = slots * tiers_[t].depth;
+            Columns &c = cols_[t];
+            c.epoch.resize(n);
+            c.count.resize(n, 0);
+            c.cpu_min.resize(n);
+            c.cpu_max.resize(n);
+            c.cpu_sum.resize(n);
+            c.mem_min.resize(n);
+            c.mem_max.resize(n);
+            c.mem_sum.resize(n);
+        }
+    }
+
+    const std::array<Tier, kTiers> tiers_;
+    const std::size_t max_slots_;
+
+    Columns cols_[kTiers];
+    std::vector<uint64_t> last_ms_; // newest sample folded, per slot
+};
+
+#endif
@@ -0,0 +1,96 @@
+// stats_sequencer.hpp — sequence tracking for delta‑mode stats streams
+// -----------------------------------------------------------------------------
+#ifndef CP_STATS_SEQUENCER_HPP
+#define CP_STATS_SEQUENCER_HPP
+
+#include <cstdint>
+#include <string_view>
+
+#include "stats_model.hpp"
+
+/** Client → server control messages of the stats stream (text frames). */
+inline constexpr std::string_view kStatsSubscribeDelta =
+    R"({"op":"subscribe","mode":"delta"})";
+inline constexpr std::string_view kStatsResubscribeDelta =
+    R"({"op":"subscribe","mode":"delta","resync":true})";
+
+/**
+ * StatsSequencer
+ * --------------
+ * Decides whether a decoded frame may be applied.  Delta frames are only
+ * meaningful on top of an unbroken chain that starts at a full snapshot:
+ *
+ *   - a full snapshot is always applied and (re)starts the chain at `seq`;
+ *   - the next delta must carry `seq + 1`; anything else is a *gap* — the
+ *     client has lost updates or tombstones and must resubscribe;
+ *   - until the next full snapshot arrives, further deltas are discarded
+ *     (they would apply on top of an unknown state), as are replays of
+ *     sequence numbers already seen.
+ *
+ * Plain snapshot frames (servers without delta support) carry no sequence
+ * and pass straight through.
+ */
+class StatsSequencer
+{
+public:
+    enum class Verdict
+    {
+        Apply,   //!< merge the frame
+        Discard, //!< drop it, nothing else to do
+        Gap,     //!< drop it and resubscribe
+    };
+
+    struct Counters
+    {
+        uint64_t snapshots{}; //!< full snapshots accepted
+        uint64_t deltas{};    //!< deltas accepted
+        uint64_t gaps{};      //!< sequence gaps detected
+        uint64_t discarded{}; //!< deltas dropped while out of sync / replayed
+    };
+
+    Verdict accept(const StatsBatch &batch) noexcept
+    {
+        if (!batch.delta())
+            return Verdict::Apply;
+
+        if (batch.full())
+        {
+            synced_ = true;
+            next_ = batch.seq() + 1;
+            ++counters_.snapshots;
+            return Verdict::Apply;
+        }
+
+        if (synced_ && batch.seq() == next_)
+        {
+            ++next_;
+            ++counters_.deltas;
+            return Verdict::Apply;
+        }
+
+        if (!synced_ || batch.seq() < next_)
+        {
+            ++counters_.discarded;
+            return Verdict::Discard;
+        }
+
+        synced_ = false;
+        ++counters_.gaps;
+        return Verdict::Gap;
+    }
+
+    /** Forget the chain, e.g. when the connection is re‑established. */
+    void reset() noexcept { synced_ = false; }
+
+    /** Sequence number the next delta must carry (valid while in sync). */
+    [[nodiscard]] uint64_t expected() const noexcept { return next_; }
+    [[nodiscard]] bool synced() const noexcept { return synced_; }
+    [[nodiscard]] const Counters &counters() const noexcept { return counters_; }
+
+private:
+    uint64_t next_{};
+    bool synced_{false};
+    Counters counters_{};
+};
+
+#endif
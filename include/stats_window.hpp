@@ -2,16 +2,47 @@
 #define CP_STATS_WINDOW_HPP
 #include <inttypes.h>
 #include <imgui.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <format>
 #include <string>
-#include <map>
-#include "readerwriterqueue.h"
+#include <vector>
+#include "container_order.hpp"
+#include "container_table.hpp"
+#include "host_stats.hpp"
+#include "log.hpp"
+#include "log_service.hpp"
+#include "stats_aggregator.hpp"
+#include "stats_alerts.hpp"
+#include "stats_expiry.hpp"
+#include "stats_exporter.hpp"
+#include "stats_history.hpp"
+#include "stats_ingest.hpp"
+#include "stats_mailbox.hpp"
 #include "stats_model.hpp"
+#include "stats_rollup.hpp"
 
 class StatsWindow
 {
 public:
-    explicit StatsWindow(moodycamel::ReaderWriterQueue<StatsMap> *q) noexcept
-        : queue_(q) {}
+    explicit StatsWindow(StatsAggregator *stats,
+                         StatsHistory::Config history = {},
+                         StatsRollup::Config rollup = {},
+                         StatsExpiry::Config expiry = {},
+                         std::vector<StatsAlerts::Rule> alerts = {},
+                         StatsExporter *exporter = nullptr)
+        : stats_(stats), ingest_(stats, history, rollup, expiry, std::move(alerts), exporter)
+    {
+        ingest_.on_alert([this](const StatsAlerts::Event &e) { onAlert_(e); });
+    }
+
+    StatsWindow(const StatsWindow &) = delete; // the alert sink captures this
+    StatsWindow &operator=(const StatsWindow &) = delete;
+
+    /** Per‑host rollup of the ledger, for the Hosts window. */
+    HostStats &hostStats() noexcept { return ingest_.host_stats(); }
 
     void draw(bool *open)
     {
@@ -27,52 +58,362 @@ public:
             return;
         }
 
-        pumpQueue(); // <-- merge fresh data into ledger_
+        drawStatus_();
+        drawEndpoints_();
+        drawAlerts_();
         drawTable_();
+        drawn_ = true;
 
         ImGui::End();
     }
 
-private:
-    // merge every batch available this frame
+    // after the frame went out: frames merged since the last one are now on
+    // screen, if the window was drawn at all
+    void presented()
+    {
+        if (drawn_)
+        {
+            const int64_t shownNs = steadyNs_();
+            for (const auto &m : ingest_.merged())
+                stats_->latency(m.endpoint).shown(m.stamp, m.merged_ns, shownNs);
+        }
+        ingest_.clear_merged();
+        drawn_ = false;
+    }
+
+    // merge everything the endpoint mailboxes coalesced since the last
+    // frame; called every frame (window open or not) so history keeps recording
     void pumpQueue()
     {
-        StatsMap batch;
-        while (queue_->try_dequeue(batch))
-        { // drains queue
-            for (auto &[id, ts] : batch)
-                ledger_[id] = std::move(ts); // overwrite newest
+        const uint64_t nowMs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        ingest_.pump(nowMs);
+    }
+
+private:
+    static constexpr std::size_t kSparkWidth = 16;
+
+    static int64_t steadyNs_()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // selectable rollup windows for the min/avg/max columns
+    static constexpr const char *kRangeNames[] = {"2m", "1h", "24h"};
+    static constexpr uint64_t kRangeSeconds[] = {120, 3600, 86400};
+
+    // column user IDs double as sort keys
+    enum Column : ImGuiID
+    {
+        ColId,
+        ColNode,
+        ColCpu,
+        ColCpuTrend,
+        ColCpuRange,
+        ColMem,
+        ColMemTrend,
+        ColMemRange,
+        ColAge,
+    };
+
+    void drawStatus_()
+    {
+        StatsMailbox::Metrics m{};
+        std::size_t up = 0;
+        for (std::size_t i = 0; i < stats_->size(); ++i)
+        {
+            const auto e = stats_->mailbox(i).metrics();
+            m.depth += e.depth;
+            m.coalesced += e.coalesced;
+            m.dropped += e.dropped;
+            m.removed += e.removed;
+            const auto state = stats_->health(i).state;
+            up += state == StatsAggregator::State::Open || state == StatsAggregator::State::Replay;
+        }
+        ImGui::Text("%zu containers | endpoints %zu/%zu | pending %zu | coalesced %" PRIu64
+                    " | dropped %" PRIu64 " | removed %" PRIu64 " | stale %zu | evicted %" PRIu64
+                    " | history %zu KiB | rollup %zu KiB",
+                    ingest_.ledger().size(), up, stats_->size(), m.depth, m.coalesced, m.dropped,
+                    m.removed, ingest_.expiry().metrics().stale, ingest_.expiry().metrics().evicted,
+                    ingest_.history().bytes() / 1024, ingest_.rollup().bytes() / 1024);
+
+        ImGui::TextUnformatted("Range:");
+        for (int i = 0; i < static_cast<int>(std::size(kRangeNames)); ++i)
+        {
+            ImGui::SameLine();
+            ImGui::RadioButton(kRangeNames[i], &range_, i);
         }
     }
 
+    // per‑endpoint connection health, collapsed by default
+    void drawEndpoints_()
+    {
+        if (!ImGui::CollapsingHeader("Endpoints"))
+            return;
+
+        const float rows = static_cast<float>(std::min<std::size_t>(stats_->size(), 8) + 1);
+        if (!ImGui::BeginTable("StatsEndpoints", 9,
+                               ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY,
+                               ImVec2(0.f, rows * ImGui::GetTextLineHeightWithSpacing())))
+            return;
+
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Endpoint");
+        ImGui::TableSetupColumn("State");
+        ImGui::TableSetupColumn("Frames");
+        ImGui::TableSetupColumn("Last");
+        ImGui::TableSetupColumn("Gaps");
+        ImGui::TableSetupColumn("Retry");     // consecutive / total attempts
+        ImGui::TableSetupColumn("Connect");   // last handshake / last outage
+        ImGui::TableSetupColumn("Resumed");   // TLS resumptions / connects
+        ImGui::TableSetupColumn("Error");
+        ImGui::TableHeadersRow();
+
+        const uint64_t nowMs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+
+        ImGuiListClipper clip;
+        clip.Begin(static_cast<int>(stats_->size()));
+        while (clip.Step())
+        {
+            for (int i = clip.DisplayStart; i < clip.DisplayEnd; ++i)
+            {
+                const auto h = stats_->health(static_cast<std::size_t>(i));
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(ingest_.label(i).c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%s %s", StatsAggregator::state_name(h.state), h.subprotocol.c_str());
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%" PRIu64, h.frames);
+                ImGui::TableSetColumnIndex(3);
+                if (h.last_frame_ms)
+                    ImGui::Text("%" PRIu64 "s", nowMs > h.last_frame_ms ? (nowMs - h.last_frame_ms) / 1000 : 0);
+                else
+                    ImGui::TextUnformatted("-");
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%" PRIu64, h.gaps);
+                ImGui::TableSetColumnIndex(5);
+                ImGui::Text("%" PRIu32 "/%" PRIu64, h.retry, h.attempts);
+                ImGui::TableSetColumnIndex(6);
+                if (h.reconnect_ms)
+                    ImGui::Text("%" PRIu64 "ms/%" PRIu64 "ms", h.connect_ms, h.reconnect_ms);
+                else
+                    ImGui::Text("%" PRIu64 "ms", h.connect_ms);
+                ImGui::TableSetColumnIndex(7);
+                ImGui::Text("%" PRIu64 "/%" PRIu64, h.tls_resumed, h.connects);
+                ImGui::TableSetColumnIndex(8);
+                ImGui::TextUnformatted(h.last_error.c_str());
+            }
+        }
+        ImGui::EndTable();
+    }
+
     void drawTable_()
     {
-        if (!ImGui::BeginTable("HostLedger", 3,
-                               ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+        // ScrollY makes the table its own scrolling region, which is what lets
+        // the clipper skip every row outside the viewport.
+        if (!ImGui::BeginTable("HostLedger", 9,
+                               ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+                                   ImGuiTableFlags_ScrollY | ImGuiTableFlags_Sortable))
+            return;
+
+        ImGui::TableSetupScrollFreeze(0, 1); // keep the header visible
+        ImGui::TableSetupColumn("ID", ImGuiTableColumnFlags_DefaultSort, 0.f, ColId);
+        ImGui::TableSetupColumn("Node", 0, 0.f, ColNode);
+        ImGui::TableSetupColumn("CPU", ImGuiTableColumnFlags_PreferSortDescending, 0.f, ColCpu);
+        ImGui::TableSetupColumn("CPU trend", ImGuiTableColumnFlags_NoSort, 0.f, ColCpuTrend);
+        ImGui::TableSetupColumn("CPU min/avg/max", ImGuiTableColumnFlags_NoSort, 0.f, ColCpuRange);
+        ImGui::TableSetupColumn("Memory", ImGuiTableColumnFlags_PreferSortDescending, 0.f, ColMem);
+        ImGui::TableSetupColumn("Mem trend", ImGuiTableColumnFlags_NoSort, 0.f, ColMemTrend);
+        ImGui::TableSetupColumn("Mem avg/max", ImGuiTableColumnFlags_NoSort, 0.f, ColMemRange);
+        ImGui::TableSetupColumn("Age", 0, 0.f, ColAge);
+        ImGui::TableHeadersRow();
+
+        applySortSpecs_();
+
+        const auto &rows = ingest_.order().rows(ingest_.ledger());
+        const uint64_t nowMs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        const uint64_t streamMs = ingest_.expiry().now_ms(nowMs); // ages agree with staleness
+        char spark[kSparkWidth + 1];
+
+        ImGuiListClipper clip;
+        clip.Begin(static_cast<int>(rows.size()));
+        while (clip.Step())
+        {
+            for (int i = clip.DisplayStart; i < clip.DisplayEnd; ++i)
+            {
+                const ContainerTable::Slot slot = rows[i];
+                const auto &ts = ingest_.ledger().stats(slot);
+                double cpu = ts.stats.cpu_avg.value_or(0.0);
+                uint64_t mem = ts.stats.max_mem.value_or(0);
+                const uint64_t sampleMs = stats_timestamp_ms(ts.timestamp);
+                const uint64_t ageS = streamMs > sampleMs ? (streamMs - sampleMs) / 1000 : 0;
+
+                ImGui::TableNextRow();
+                const bool stale = ingest_.expiry().stale(slot);
+                if (stale) // silent for stale_after: dim the whole row
+                    ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled));
+                const auto id = ingest_.ledger().id(slot);
+                ImGui::TableSetColumnIndex(ColId);
+                ImGui::TextUnformatted(id.data(), id.data() + id.size());
+                ImGui::TableSetColumnIndex(ColNode);
+                ImGui::TextUnformatted(ingest_.label(ingest_.ledger().source(slot)).c_str());
+                ImGui::TableSetColumnIndex(ColCpu);
+                ImGui::Text("%.1f %%", cpu * 100.0);
+                ImGui::TableSetColumnIndex(ColCpuTrend);
+                ingest_.history().sparkline(slot, StatsHistory::Metric::Cpu, spark, kSparkWidth);
+                ImGui::TextUnformatted(spark);
+                const bool rolled = ingest_.rollup().covers(slot);
+                const auto range = ingest_.rollup().summarize(slot, kRangeSeconds[range_]);
+                ImGui::TableSetColumnIndex(ColCpuRange);
+                if (!rolled)
+                    ImGui::TextDisabled("over budget");
+                else if (range.count)
+                    ImGui::Text("%.1f/%.1f/%.1f %%", range.cpu_min * 100.0, range.cpu_avg * 100.0,
+                                range.cpu_max * 100.0);
+                ImGui::TableSetColumnIndex(ColMem);
+                ImGui::Text("%" PRIu64 " KiB", mem / 1024);
+                ImGui::TableSetColumnIndex(ColMemTrend);
+                ingest_.history().sparkline(slot, StatsHistory::Metric::Mem, spark, kSparkWidth);
+                ImGui::TextUnformatted(spark);
+                ImGui::TableSetColumnIndex(ColMemRange);
+                if (!rolled)
+                    ImGui::TextDisabled("over budget");
+                else if (range.count)
+                    ImGui::Text("%" PRIu64 "/%" PRIu64 " KiB", static_cast<uint64_t>(range.mem_avg) / 1024,
+                                range.mem_max / 1024);
+                ImGui::TableSetColumnIndex(ColAge);
+                ImGui::Text("%" PRIu64 "s", ageS);
+                if (stale)
+                    ImGui::PopStyleColor();
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    // currently firing alerts; rules are evaluated on ingest, not here
+    void drawAlerts_()
+    {
+        const auto &firing = ingest_.alerts().firing();
+        char title[64];
+        std::snprintf(title, sizeof title, "Alerts (%zu firing)###Alerts", firing.size());
+        if (!ImGui::CollapsingHeader(title))
             return;
 
+        const float rows = static_cast<float>(std::min<std::size_t>(firing.size(), 8) + 1);
+        if (!ImGui::BeginTable("StatsAlerts", 5,
+                               ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY,
+                               ImVec2(0.f, rows * ImGui::GetTextLineHeightWithSpacing())))
+            return;
+
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Rule");
         ImGui::TableSetupColumn("ID");
-        ImGui::TableSetupColumn("CPU");
-        ImGui::TableSetupColumn("Memory");
+        ImGui::TableSetupColumn("Node");
+        ImGui::TableSetupColumn("Value");
+        ImGui::TableSetupColumn("For");
         ImGui::TableHeadersRow();
 
-        for (auto &[id, ts] : ledger_)
+        const uint64_t nowMs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        const uint64_t streamMs = ingest_.expiry().now_ms(nowMs);
+
+        ImGuiListClipper clip;
+        clip.Begin(static_cast<int>(firing.size()));
+        while (clip.Step())
         {
-            double cpu = ts.stats.cpu_avg.value_or(0.0);
-            uint64_t mem = ts.stats.max_mem.value_or(0);
-
-            ImGui::TableNextRow();
-            ImGui::TableSetColumnIndex(0);
-            ImGui::TextUnformatted(id.c_str());
-            ImGui::TableSetColumnIndex(1);
-            ImGui::Text("%.1f %%", cpu * 100.0);
-            ImGui::TableSetColumnIndex(2);
-            ImGui::Text("%" PRIu64 " KiB", mem / 1024);
+            for (int i = clip.DisplayStart; i < clip.DisplayEnd; ++i)
+            {
+                const auto &f = firing[i];
+                const auto &rule = ingest_.alerts().rules()[f.rule];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(rule.name.c_str());
+                ImGui::TableSetColumnIndex(1);
+                const auto id = ingest_.ledger().id(f.slot);
+                ImGui::TextUnformatted(id.data(), id.data() + id.size());
+                ImGui::TableSetColumnIndex(2);
+                ImGui::TextUnformatted(ingest_.label(ingest_.ledger().source(f.slot)).c_str());
+                ImGui::TableSetColumnIndex(3);
+                ImGui::TextUnformatted(formatAlertValue_(rule, f.value).c_str());
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%" PRIu64 "s", streamMs > f.since_ms ? (streamMs - f.since_ms) / 1000 : 0);
+            }
         }
         ImGui::EndTable();
     }
 
-    moodycamel::ReaderWriterQueue<StatsMap> *queue_;
-    std::map<std::string, TimestampedStats> ledger_; // persistent
+    static std::string formatAlertValue_(const StatsAlerts::Rule &rule, double v)
+    {
+        if (rule.metric == StatsAlerts::Metric::Cpu)
+            return std::format("{:.1f} %", v * 100.0);
+        return std::format("{} KiB", static_cast<uint64_t>(v) / 1024);
+    }
+
+    // raise / clear transitions go to the log; the slot is still in the ledger here
+    void onAlert_(const StatsAlerts::Event &e)
+    {
+        const auto &rule = ingest_.alerts().rules()[e.rule];
+        const auto id = ingest_.ledger().id(e.slot);
+        const auto &node = ingest_.label(ingest_.ledger().source(e.slot));
+        if (e.raised)
+            LOG_WARN("Alert '{}' raised for {} on {}: {}", rule.name, id, node,
+                     formatAlertValue_(rule, e.value));
+        else if (std::isnan(e.value))
+            LOG_WARN("Alert '{}' cleared for {} on {}: container gone", rule.name, id, node);
+        else
+            LOG_WARN("Alert '{}' cleared for {} on {}: {}", rule.name, id, node,
+                     formatAlertValue_(rule, e.value));
+    }
+
+    // translate the clicked header into the incremental order's key
+    void applySortSpecs_()
+    {
+        ImGuiTableSortSpecs *specs = ImGui::TableGetSortSpecs();
+        if (!specs || !specs->SpecsDirty)
+            return;
+
+        if (specs->SpecsCount > 0)
+        {
+            const auto &spec = specs->Specs[0];
+            const bool desc = spec.SortDirection == ImGuiSortDirection_Descending;
+            switch (spec.ColumnUserID)
+            {
+            case ColNode:
+                ingest_.order().set_key(ContainerOrder::Key::Source, desc);
+                break;
+            case ColCpu:
+                ingest_.order().set_key(ContainerOrder::Key::Cpu, desc);
+                break;
+            case ColMem:
+                ingest_.order().set_key(ContainerOrder::Key::Mem, desc);
+                break;
+            case ColAge:
+                ingest_.order().set_key(ContainerOrder::Key::Age, desc);
+                break;
+            default:
+                ingest_.order().set_key(ContainerOrder::Key::Id, desc);
+                break;
+            }
+        }
+        specs->SpecsDirty = false;
+    }
+
+    StatsAggregator *stats_;
+    StatsIngest ingest_;               // ledger and per‑slot state, merged each frame
+    int range_ = 1;                    // index into kRangeSeconds
+    bool drawn_ = false;               // draw() ran this frame
 };
 #endif
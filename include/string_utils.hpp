@@ -1,7 +1,10 @@
+#pragma once
+
 #include <string>
 #include <string_view>
 #include <vector>
 #include <numeric>
+#include <functional>
 
 namespace util
 {
@@ -39,4 +42,33 @@ namespace util
                                    return acc;
                                });
     }
+
+    // ASCII case‑insensitive comparison (HTTP header names and the like).
+    [[nodiscard]] constexpr bool iequals(std::string_view a, std::string_view b) noexcept
+    {
+        if (a.size() != b.size())
+            return false;
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            char x = a[i], y = b[i];
+            if (x >= 'A' && x <= 'Z')
+                x = static_cast<char>(x - 'A' + 'a');
+            if (y >= 'A' && y <= 'Z')
+                y = static_cast<char>(y - 'A' + 'a');
+            if (x != y)
+                return false;
+        }
+        return true;
+    }
+
+    // Transparent hash so unordered containers keyed by std::string can be
+    // probed with a string_view without building a temporary key.
+    struct string_hash
+    {
+        using is_transparent = void;
+        [[nodiscard]] std::size_t operator()(std::string_view sv) const noexcept
+        {
+            return std::hash<std::string_view>{}(sv);
+        }
+    };
 } // namespace util
@@ -0,0 +1,224 @@
+// timer_wheel.hpp — hierarchical timing wheel over dense integer IDs
+// -----------------------------------------------------------------------------
+#ifndef CP_TIMER_WHEEL_HPP
+#define CP_TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * TimerWheel
+ * ----------
+ * One timer per ID (a dense slot number, as handed out by `ContainerTable`),
+ * kept in four levels of 64 buckets each.  Level `L` holds timers due within
+ * 64^(L+1) ticks, in bucket `(due >> 6L) & 63`; when the lower levels wrap,
+ * the next bucket of the level above is cascaded down.  With 1 s ticks that
+ * covers ~194 days; later deadlines are clamped to the top level and
+ * re‑placed as they cascade.
+ *
+ *   - `schedule()` (arm or re‑arm) and `cancel()` are O(1): buckets are
+ *     intrusive doubly linked lists threaded through per‑ID arrays, so a
+ *     timer that is pushed back on every update never allocates.
+ *   - `advance()` costs O(ticks elapsed + timers fired); a wheel with nothing
+ *     armed jumps straight to the new time.
+ *
+ * Timers fire at the first tick at or after their deadline, never early.
+ * Wheel time starts at `start()` or the first `advance()`.  Deadlines are
+ * placed relative to it, so a caller that knows the current time starts the
+ * wheel before scheduling; a timer scheduled on an unstarted wheel starts
+ * the clock one tick before its own deadline, and any later timer due
+ * before that is overdue at once.
+ */
+class TimerWheel
+{
+public:
+    using Id = uint32_t;
+
+    explicit TimerWheel(uint64_t tick_ms = 1000) : tick_ms_{tick_ms ? tick_ms : 1}
+    {
+        heads_.fill(kNone);
+    }
+
+    /** Start wheel time at `now_ms`; no effect once started. */
+    void start(uint64_t now_ms) noexcept
+    {
+        if (!started_)
+            start_(now_ms / tick_ms_);
+    }
+
+    [[nodiscard]] bool started() const noexcept { return started_; }
+
+    /** Arm (or move) the timer of `id` to fire at `due_ms`. */
+    void schedule(Id id, uint64_t due_ms)
+    {
+        if (id >= next_.size())
+            grow_(id);
+        if (bucket_[id] != kUnarmed)
+            unlink_(id);
+        else
+            ++armed_;
+
+        const uint64_t due = (due_ms + tick_ms_ - 1) / tick_ms_; // round up: never early
+        if (!started_)
+            start_(due ? due - 1 : 0);
+        due_[id] = due;
+        place_(id);
+    }
+
+    void cancel(Id id) noexcept
+    {
+        if (id >= next_.size() || bucket_[id] == kUnarmed)
+            return;
+        unlink_(id);
+        bucket_[id] = kUnarmed;
+        --armed_;
+    }
+
+    [[nodiscard]] bool armed(Id id) const noexcept
+    {
+        return id < bucket_.size() && bucket_[id] != kUnarmed;
+    }
+
+    /**
+     * Move time forward to `now_ms` and call `fire(id)` for every timer that
+     * came due, in tick order.  The callback may schedule or cancel any
+     * timer, including the one firing.
+     */
+    template <typename Fire>
+    void advance(uint64_t now_ms, Fire &&fire)
+    {
+        const uint64_t target = now_ms / tick_ms_;
+        if (!started_)
+            start_(target);
+
+        drain_(kOverdue, fire);
+        while (now_ < target)
+        {
+            if (armed_ == 0)
+            {
+                now_ = target; // nothing to cascade or fire on the way
+                break;
+            }
+            ++now_;
+            for (unsigned level = 1; level < kLevels; ++level)
+            {
+                // cascade level L when every level below it wrapped
+                if ((now_ & ((uint64_t{1} << (kBits * level)) - 1)) != 0)
+                    break;
+                cascade_(level * kSize + ((now_ >> (kBits * level)) & kMask));
+            }
+            drain_(now_ & kMask, fire);
+            drain_(kOverdue, fire);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return armed_; }
+    [[nodiscard]] uint64_t now_ms() const noexcept { return now_ * tick_ms_; }
+
+private:
+    static constexpr unsigned kBits = 6;
+    static constexpr unsigned kSize = 1u << kBits;
+    static constexpr uint64_t kMask = kSize - 1;
+    static constexpr unsigned kLevels = 4;
+    static constexpr uint16_t kOverdue = kLevels * kSize;     // due now or earlier
+    static constexpr uint16_t kUnarmed = kOverdue + 1;
+    static constexpr Id kNone = ~Id{0};
+
+    void start_(uint64_t tick)
+    {
+        now_ = tick;
+        started_ = true;
+    }
+
+    void place_(Id id)
+    {
+        const uint64_t due = due_[id];
+        uint16_t b = kOverdue;
+        if (due > now_)
+        {
+            const uint64_t delta = due - now_;
+            unsigned level = 0;
+            while (level + 1 < kLevels && delta >= (uint64_t{1} << (kBits * (level + 1))))
+                ++level;
+            // beyond the top level: park in the farthest bucket, re‑placed on cascade
+            const uint64_t at = delta >> (kBits * kLevels) ? now_ + (uint64_t{1} << (kBits * kLevels)) - 1 : due;
+            b = static_cast<uint16_t>(level * kSize + ((at >> (kBits * level)) & kMask));
+        }
+        bucket_[id] = b;
+        prev_[id] = kNone;
+        next_[id] = heads_[b];
+        if (heads_[b] != kNone)
+            prev_[heads_[b]] = id;
+        heads_[b] = id;
+    }
+
+    void unlink_(Id id) noexcept
+    {
+        const uint16_t b = bucket_[id];
+        if (prev_[id] != kNone)
+            next_[prev_[id]] = next_[id];
+        else
+            heads_[b] = next_[id];
+        if (next_[id] != kNone)
+            prev_[next_[id]] = prev_[id];
+    }
+
+    void cascade_(std::size_t b)
+    {
+        Id id = heads_[b];
+        heads_[b] = kNone;
+        while (id != kNone)
+        {
+            const Id next = next_[id];
+            place_(id);
+            id = next;
+        }
+    }
+
+    template <typename Fire>
+    void drain_(std::size_t b, Fire &fire)
+    {
+        // pop one at a time: the callback may touch this very list
+        while (heads_[b] != kNone)
+        {
+            const Id id = heads_[b];
+            if (due_[id] > now_) // parked beyond the top level, not due yet
+            {
+                unlink_(id);
+                place_(id);
+                continue;
+            }
+            unlink_(id);
+            bucket_[id] = kUnarmed;
+            --armed_;
+            fire(id);
+        }
+    }
+
+    void grow_(Id id)
+    {
+        const std::size_t n = std::max<std::size_t>(id + 1, next_.size() * 2);
+        next_.resize(n, kNone);
+        prev_.resize(n, kNone);
+        due_.resize(n, 0);
+        bucket_.resize(n, kUnarmed);
+    }
+
+    const uint64_t tick_ms_;
+    uint64_t now_{};
+    bool started_{false};
+    std::size_t armed_{};
+
+    std::array<Id, kLevels * kSize + 1> heads_; // + overdue list
+
+    // per‑ID columns
+    std::vector<Id> next_;
+    std::vector<Id> prev_;
+    std::vector<uint64_t> due_;     // in ticks
+    std::vector<uint16_t> bucket_;  // kUnarmed if not armed
+};
+
+#endif
@@ -1,34 +1,199 @@
 #include "api_client.hpp"
 
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <stdexcept>
+#include <string_view>
+
+namespace
+{
+    nlohmann::json create_request(const ledgr::HostDescriptor &host)
+    {
+        return {{"op", "create"}, {"entry", host}};
+    }
+
+    bool created(const nlohmann::json &resp, std::string *error)
+    {
+        if (resp.contains("status") && resp["status"] == "ok")
+        {
+            return true;
+        }
+        if (error && resp.contains("message"))
+        {
+            *error = resp["message"].get<std::string>();
+        }
+        return false;
+    }
+
+    nlohmann::json changes_request(uint64_t since)
+    {
+        return {{"op", "changes"}, {"since", since}};
+    }
+
+    uint64_t revision_of(const nlohmann::json &resp)
+    {
+        auto it = resp.find("revision");
+        return it != resp.end() && it->is_number_unsigned() ? it->get<uint64_t>() : 0;
+    }
+
+    void append_hosts(const nlohmann::json &resp, const char *key, std::vector<ledgr::HostDescriptor> &out)
+    {
+        auto it = resp.find(key);
+        if (it == resp.end() || !it->is_array())
+            return;
+        for (const auto &jhost : *it)
+            out.push_back(jhost.get<ledgr::HostDescriptor>());
+    }
+
+    LedgerApiClient::HostChanges changes_from(const nlohmann::json &resp)
+    {
+        LedgerApiClient::HostChanges c;
+        if (!resp.is_object() || resp.value("status", "") != "ok")
+        {
+            c.resync = true; // expired revision, or a daemon without the op
+            return c;
+        }
+        c.revision = revision_of(resp);
+        append_hosts(resp, "added", c.upserts);
+        append_hosts(resp, "changed", c.upserts);
+        if (auto it = resp.find("removed"); it != resp.end() && it->is_array())
+        {
+            for (const auto &id : *it)
+            {
+                if (id.is_string())
+                    c.removed.push_back(id.get<std::string>());
+                else if (id.is_object())
+                    c.removed.push_back(id.value("id", ""));
+            }
+        }
+        return c;
+    }
+} // namespace
+
 LedgerApiClient::LedgerApiClient(const std::string &socket_path)
     : client(socket_path) {}
 
 std::vector<ledgr::HostDescriptor> LedgerApiClient::list_hosts()
 {
+    return sync_hosts(0).upserts;
+}
+
+uint64_t LedgerApiClient::list_hosts(const HostListParser::Chunk &chunk, std::size_t chunk_size)
+{
+    std::vector<ledgr::HostDescriptor> batch;
+    return stream_list_(batch, chunk, chunk_size);
+}
+
+uint64_t LedgerApiClient::stream_list_(std::vector<ledgr::HostDescriptor> &out,
+                                       const HostListParser::Chunk &chunk, std::size_t chunk_size)
+{
+    HostListParser parser{out, chunk, chunk_size};
+    bool malformed = false;
+    std::promise<LedgerClient::Result> reply;
+    auto done = reply.get_future();
+
+    // both callbacks run on the client thread while we wait here
     nlohmann::json req = {{"op", "list"}};
-    nlohmann::json resp = client.send_request(req);
-    std::vector<ledgr::HostDescriptor> hosts;
-    if (resp.contains("entries") && resp["entries"].is_array())
-    {
-        for (const auto &jhost : resp["entries"])
+    client.send_streaming(
+        req,
+        [&](std::string_view piece)
         {
-            hosts.push_back(jhost.get<ledgr::HostDescriptor>());
-        }
-    }
-    return hosts;
+            malformed = !parser.feed(piece);
+            return !malformed; },
+        [&reply](LedgerClient::Result res)
+        { reply.set_value(std::move(res)); });
+
+    const auto res = done.get();
+    if (!res && !malformed)
+        throw std::runtime_error(res.error());
+    if (auto ok = parser.finish(); !ok)
+        throw std::runtime_error("JSON parse error: " + ok.error());
+    return revision_of(parser.meta());
 }
 
-bool LedgerApiClient::add_host(const ledgr::HostDescriptor &host, std::string *error)
+LedgerApiClient::HostChanges LedgerApiClient::sync_hosts(uint64_t revision)
 {
-    nlohmann::json req = {{"op", "create"}, {"entry", host}};
-    nlohmann::json resp = client.send_request(req);
-    if (resp.contains("status") && resp["status"] == "ok")
+    if (revision != 0)
     {
-        return true;
+        if (HostChanges c = changes_from(client.send_request(changes_request(revision))); !c.resync)
+            return c;
     }
-    if (error && resp.contains("message"))
+
+    HostChanges c;
+    c.full = true;
+    c.revision = stream_list_(c.upserts, {}, 0);
+    return c;
+}
+
+void LedgerApiClient::watch_hosts(uint64_t revision, std::chrono::milliseconds wait,
+                                  std::function<void(ChangesResult)> done)
+{
+    auto req = changes_request(revision);
+    req["wait_ms"] = wait.count();
+    // the daemon may hold the reply for `wait`: give the transfer that much on top
+    client.send_async(req, [done = std::move(done)](LedgerClient::Result res)
+                      {
+                          ChangesResult out = std::unexpected(std::string{});
+                          try
+                          {
+                              if (res)
+                                  out = changes_from(*res);
+                              else
+                                  out = std::unexpected(std::move(res.error()));
+                          }
+                          catch (const std::exception &ex) // malformed entries
+                          {
+                              out = std::unexpected(std::string{ex.what()});
+                          }
+                          done(std::move(out)); },
+                      wait + std::chrono::seconds{10});
+}
+
+bool LedgerApiClient::add_host(const ledgr::HostDescriptor &host, std::string *error)
+{
+    nlohmann::json resp = client.send_request(create_request(host));
+    return created(resp, error);
+}
+
+std::vector<LedgerApiClient::AddResult>
+LedgerApiClient::add_hosts(const std::vector<ledgr::HostDescriptor> &hosts,
+                           const AddProgress &progress, std::size_t window)
+{
+    window = std::max<std::size_t>(window, 1);
+    std::deque<std::future<nlohmann::json>> replies; // oldest first
+    std::vector<AddResult> results;
+    results.reserve(hosts.size());
+
+    std::size_t sent = 0;
+    bool stopped = false;
+    while (results.size() < hosts.size())
     {
-        *error = resp["message"].get<std::string>();
+        // keep the window full, then settle the oldest reply
+        while (!stopped && sent < hosts.size() && replies.size() < window)
+            replies.push_back(client.send_async(create_request(hosts[sent++])));
+
+        if (replies.empty()) // stopped: the rest were never sent
+        {
+            results.emplace_back(std::unexpected(std::string{"cancelled"}));
+            continue;
+        }
+
+        AddResult res;
+        try
+        {
+            std::string err = "rejected by daemon";
+            if (!created(replies.front().get(), &err))
+                res = std::unexpected(std::move(err));
+        }
+        catch (const std::exception &ex)
+        {
+            res = std::unexpected(std::string{ex.what()});
+        }
+        replies.pop_front();
+        if (progress && !progress(results.size(), res))
+            stopped = true;
+        results.push_back(std::move(res));
     }
-    return false;
+    return results;
 }
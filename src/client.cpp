@@ -1,5 +1,5 @@
 #include "client.hpp"
-#include <sstream>
+#include <algorithm>
 
 namespace
 {
@@ -20,88 +20,283 @@ namespace
 
     /* Static instance: constructed before main(), destroyed on exit */
     static CurlGlobalGuard curl_global_guard;
+
+    /* Idle easy handles kept beyond the connection limit are freed */
+    constexpr std::size_t kIdleSlack = 4;
 } // namespace
 
 LedgerClient::LedgerClient(const std::string &socket_path,
-                           std::chrono::seconds timeout)
-    : curl_{curl_easy_init()},
+                           std::chrono::seconds timeout,
+                           std::size_t max_connections)
+    : multi_{curl_multi_init()},
       socket_path_{socket_path},
-      timeout_sec_{static_cast<long>(timeout.count())}
+      timeout_ms_{static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count())}
 {
-    if (!curl_)
-        throw std::runtime_error("curl_easy_init() failed");
+    if (!multi_)
+        throw std::runtime_error("curl_multi_init() failed");
+
+    const long conns = static_cast<long>(std::max<std::size_t>(max_connections, 1));
+    curl_multi_setopt(multi_.get(), CURLMOPT_MAX_HOST_CONNECTIONS, conns);
+    curl_multi_setopt(multi_.get(), CURLMOPT_MAX_TOTAL_CONNECTIONS, conns);
+    curl_multi_setopt(multi_.get(), CURLMOPT_MAXCONNECTS, conns); // keep‑alive cache
+
+    hdrs_ = curl_slist_append(nullptr, "Content-Type: application/json");
+    if (!hdrs_)
+        throw std::runtime_error("curl_slist_append() failed");
 
-    apply_invariants();
+    idle_.reserve(static_cast<std::size_t>(conns) + kIdleSlack);
+    thread_ = std::thread([this]
+                          { run_(); });
 }
 
-void LedgerClient::apply_invariants()
+LedgerClient::~LedgerClient()
 {
-    curl_easy_setopt(curl_.get(), CURLOPT_UNIX_SOCKET_PATH, socket_path_.c_str());
-    curl_easy_setopt(curl_.get(), CURLOPT_URL, "http://localhost/");
-    curl_easy_setopt(curl_.get(), CURLOPT_WRITEFUNCTION, &LedgerClient::write_cb);
-    curl_easy_setopt(curl_.get(), CURLOPT_TIMEOUT, timeout_sec_);
-    curl_easy_setopt(curl_.get(), CURLOPT_NOSIGNAL, 1L);
+    stopping_.store(true, std::memory_order_release);
+    curl_multi_wakeup(multi_.get());
+    if (thread_.joinable())
+        thread_.join();
+
+    for (CURL *easy : idle_)
+        curl_easy_cleanup(easy);
+    curl_slist_free_all(hdrs_); // safe: libcurl does NOT free it
 }
 
-LedgerClient::~LedgerClient() = default;
+void LedgerClient::apply_invariants(CURL *easy)
+{
+    curl_easy_setopt(easy, CURLOPT_UNIX_SOCKET_PATH, socket_path_.c_str());
+    curl_easy_setopt(easy, CURLOPT_URL, "http://localhost/");
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, &LedgerClient::write_cb);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_POST, 1L);
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, hdrs_);
+}
 
 size_t LedgerClient::write_cb(char *ptr, size_t size, size_t nmemb, void *userdata)
 {
-    auto *buf = static_cast<std::string *>(userdata);
-    buf->append(ptr, size * nmemb);
-    return size * nmemb;
+    auto *r = static_cast<Request *>(userdata);
+    const size_t n = size * nmemb;
+    if (r->sink)
+    {
+        // headers are in by now: only a 200 body is the caller's
+        long http_status = 0;
+        curl_easy_getinfo(r->easy, CURLINFO_RESPONSE_CODE, &http_status);
+        if (http_status == 200)
+        {
+            if (!r->sink(std::string_view{ptr, n}))
+            {
+                r->aborted = true;
+                return 0; // → CURLE_WRITE_ERROR
+            }
+            return n;
+        }
+    }
+    r->resp.append(ptr, n);
+    return n;
 }
 
 nlohmann::json LedgerClient::send_request(const nlohmann::json &req)
 {
-    /* ---------- request-specific state ---------- */
-    const std::string body = req.dump(); // JSON payload (must stay alive)
-    std::string resp_body;               // will collect response
+    return send_async(req).get();
+}
 
-    struct curl_slist *hdrs = nullptr;
-    hdrs = curl_slist_append(hdrs, "Content-Type: application/json");
+std::future<nlohmann::json> LedgerClient::send_async(const nlohmann::json &req)
+{
+    auto promise = std::make_shared<std::promise<nlohmann::json>>();
+    auto future = promise->get_future();
+    send_async(req, [promise](Result res)
+               {
+                   if (res)
+                       promise->set_value(std::move(*res));
+                   else
+                       promise->set_exception(std::make_exception_ptr(std::runtime_error(res.error()))); });
+    return future;
+}
 
-    /* ---------- PER-REQUEST options (must be set each call) ---------- */
-    curl_easy_setopt(curl_.get(), CURLOPT_POST, 1L);
-    curl_easy_setopt(curl_.get(), CURLOPT_HTTPHEADER, hdrs);
-    curl_easy_setopt(curl_.get(), CURLOPT_POSTFIELDS, body.c_str());
-    curl_easy_setopt(curl_.get(), CURLOPT_POSTFIELDSIZE, body.size());
-    curl_easy_setopt(curl_.get(), CURLOPT_WRITEDATA, &resp_body);
+void LedgerClient::send_streaming(const nlohmann::json &req, BodySink sink, Callback done)
+{
+    auto r = std::make_unique<Request>();
+    r->body = req.dump();
+    r->timeout_ms = timeout_ms_;
+    r->sink = std::move(sink);
+    r->done = std::move(done);
+    submit_(std::move(r));
+}
 
-    /* ---------- perform ---------- */
-    CURLcode rc = curl_easy_perform(curl_.get());
+void LedgerClient::send_async(const nlohmann::json &req, Callback done,
+                              std::chrono::milliseconds timeout)
+{
+    auto r = std::make_unique<Request>();
+    r->body = req.dump();
+    r->timeout_ms = timeout.count() > 0 ? static_cast<long>(timeout.count()) : timeout_ms_;
+    r->done = std::move(done);
+    submit_(std::move(r));
+}
 
-    /* hdrs is no longer needed after the transfer */
-    curl_slist_free_all(hdrs); // safe: libcurl does NOT free it
+void LedgerClient::submit_(std::unique_ptr<Request> r)
+{
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard lk{mtx_};
+        if (!stopping_.load(std::memory_order_acquire))
+        {
+            queue_.push_back(std::move(r)); // leaves r empty
+        }
+    }
+    if (r) // shutting down: the loop will not pick it up
+    {
+        in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        r->done(std::unexpected(std::string{"ledger client is shutting down"}));
+        return;
+    }
+    curl_multi_wakeup(multi_.get());
+}
 
-    /* ---------- status code BEFORE reset ---------- */
-    long http_status = 0;
-    if (rc == CURLE_OK)
-        curl_easy_getinfo(curl_.get(), CURLINFO_RESPONSE_CODE, &http_status);
+CURL *LedgerClient::acquire_()
+{
+    if (!idle_.empty())
+    {
+        CURL *easy = idle_.back();
+        idle_.pop_back();
+        return easy;
+    }
+    CURL *easy = curl_easy_init();
+    if (easy)
+        apply_invariants(easy);
+    return easy;
+}
 
-    /* ---------- reset handle to clear dangling pointers ---------- */
-    curl_easy_reset(curl_.get());
+void LedgerClient::release_(CURL *easy)
+{
+    if (idle_.size() < idle_.capacity())
+        idle_.push_back(easy);
+    else
+        curl_easy_cleanup(easy);
+}
 
-    apply_invariants();
+void LedgerClient::run_()
+{
+    while (!stopping_.load(std::memory_order_acquire))
+    {
+        start_queued_();
+
+        int running = 0;
+        curl_multi_perform(multi_.get(), &running);
+        reap_();
+
+        // sleeps until a socket is ready, a timeout is due or send_async() wakes us
+        curl_multi_poll(multi_.get(), nullptr, 0, 1000, nullptr);
+    }
+    fail_all_("ledger client is shutting down");
+}
+
+void LedgerClient::start_queued_()
+{
+    {
+        std::lock_guard lk{mtx_};
+        starting_.swap(queue_);
+    }
+    for (auto &r : starting_)
+    {
+        CURL *easy = acquire_();
+        if (!easy)
+        {
+            in_flight_.fetch_sub(1, std::memory_order_relaxed);
+            r->done(std::unexpected(std::string{"curl_easy_init() failed"}));
+            continue;
+        }
+
+        /* ---------- PER-REQUEST options ---------- */
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, r->body.c_str());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(r->body.size()));
+        r->easy = easy;
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, r.get());
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, r->timeout_ms);
+
+        if (const CURLMcode mc = curl_multi_add_handle(multi_.get(), easy); mc != CURLM_OK)
+        {
+            release_(easy);
+            in_flight_.fetch_sub(1, std::memory_order_relaxed);
+            r->done(std::unexpected("libcurl: " + std::string(curl_multi_strerror(mc))));
+            continue;
+        }
+        active_.emplace(easy, std::move(r));
+    }
+    starting_.clear(); // keeps capacity
+}
+
+LedgerClient::Result LedgerClient::finish_(CURL *easy, CURLcode rc, Request &r)
+{
+    std::string &resp = r.resp;
 
     /* ---------- error handling ---------- */
+    if (r.aborted)
+        return std::unexpected(std::string{"aborted by the reply consumer"});
     if (rc != CURLE_OK)
-        throw std::runtime_error("libcurl: " +
-                                 std::string(curl_easy_strerror(rc)));
+        return std::unexpected("libcurl: " + std::string(curl_easy_strerror(rc)));
 
+    long http_status = 0;
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &http_status);
     if (http_status != 200)
-        throw std::runtime_error("HTTP " + std::to_string(http_status) +
-                                 " - body: " + resp_body);
+        return std::unexpected("HTTP " + std::to_string(http_status) + " - body: " + resp);
+    if (r.sink)
+        return nlohmann::json{}; // the body went to the sink
 
     /* ---------- JSON parse ---------- */
     try
     {
-        return nlohmann::json::parse(resp_body);
+        return nlohmann::json::parse(resp);
     }
     catch (const std::exception &e)
     {
-        throw std::runtime_error("JSON parse error: " +
-                                 std::string(e.what()) +
-                                 " - raw: " + resp_body);
+        return std::unexpected("JSON parse error: " + std::string(e.what()) + " - raw: " + resp);
+    }
+}
+
+void LedgerClient::reap_()
+{
+    int left = 0;
+    while (CURLMsg *msg = curl_multi_info_read(multi_.get(), &left))
+    {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        CURL *easy = msg->easy_handle;
+        const CURLcode rc = msg->data.result;
+        curl_multi_remove_handle(multi_.get(), easy);
+
+        auto it = active_.find(easy);
+        if (it == active_.end())
+        {
+            release_(easy);
+            continue;
+        }
+        auto r = std::move(it->second);
+        active_.erase(it);
+
+        Result res = finish_(easy, rc, *r);
+        release_(easy); // options stay set; the next request overrides body and sink
+        in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        r->done(std::move(res));
+    }
+}
+
+void LedgerClient::fail_all_(const std::string &why)
+{
+    {
+        std::lock_guard lk{mtx_};
+        starting_.swap(queue_);
+    }
+    for (auto &[easy, r] : active_)
+    {
+        curl_multi_remove_handle(multi_.get(), easy);
+        curl_easy_cleanup(easy);
+        starting_.push_back(std::move(r));
+    }
+    active_.clear();
+    for (auto &r : starting_)
+    {
+        in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        r->done(std::unexpected(why));
     }
+    starting_.clear();
 }
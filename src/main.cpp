@@ -8,7 +8,6 @@
 #include "imtui/imtui-impl-ncurses.h"
 
 #include <nlohmann/json.hpp>
-#include "readerwriterqueue.h"
 
 #include "tui_backend.hpp"
 #include "host_descriptor.hpp"
@@ -18,8 +17,11 @@
 #include "log_window.hpp"
 #include "log.hpp"
 #include "step_ca_init_window.hpp"
-#include "stats_ws_client.hpp"
+#include "stats_aggregator.hpp"
+#include "stats_exporter.hpp"
+#include "string_utils.hpp"
 #include <stats_window.hpp>
+#include "stats_latency_window.hpp"
 
 using json = nlohmann::json;
 
@@ -30,8 +32,86 @@ int main()
     const char *sock_env = std::getenv("LEDGR_SOCKET_PATH");
     std::string sock_path = sock_env ? sock_env : "/tmp/reznledgr.sock";
 
+    // one or more stats endpoints, comma separated
     const char *stats_ws_uri_env = std::getenv("REZN_STATS_WS_URI");
-    std::string stats_ws_uri = stats_ws_uri_env ? stats_ws_uri_env : "ws://localhost:4000/stats/ws";
+    std::vector<std::string> stats_ws_uris;
+    for (std::string_view rest{stats_ws_uri_env ? stats_ws_uri_env : "ws://localhost:4000/stats/ws"};
+         !rest.empty();)
+    {
+        const auto comma = rest.find(',');
+        if (auto uri = util::trim(rest.substr(0, comma)); !uri.empty())
+            stats_ws_uris.emplace_back(uri);
+        rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+    }
+
+    // wire encoding offered first on the stats socket: cbor (default), msgpack or json
+    StatsEncoding statsEncoding = StatsEncoding::Cbor;
+    if (const char *enc_env = std::getenv("REZN_STATS_ENCODING"))
+    {
+        const std::string_view enc{enc_env};
+        if (enc == "json")
+            statsEncoding = StatsEncoding::Json;
+        else if (enc == "msgpack")
+            statsEncoding = StatsEncoding::MsgPack;
+    }
+
+    StatsAggregator::Options statsOpts;
+    statsOpts.encoding = statsEncoding;
+    // delta frames are requested unless REZN_STATS_DELTA=0
+    if (const char *delta_env = std::getenv("REZN_STATS_DELTA"))
+        statsOpts.delta = std::string_view{delta_env} != "0";
+    if (const char *threads_env = std::getenv("REZN_STATS_THREADS"))
+        statsOpts.threads = std::strtoull(threads_env, nullptr, 10);
+
+    // REZN_STATS_RECORD_DIR tees live stats to disk; REZN_STATS_REPLAY_DIR
+    // plays such a recording back instead of connecting (speed 0 = max,
+    // REZN_STATS_REPLAY_FROM = Unix seconds to start at)
+    if (const char *record_env = std::getenv("REZN_STATS_RECORD_DIR"))
+        statsOpts.record_dir = record_env;
+    if (const char *replay_env = std::getenv("REZN_STATS_REPLAY_DIR"))
+        statsOpts.replay_dir = replay_env;
+    if (const char *speed_env = std::getenv("REZN_STATS_REPLAY_SPEED"))
+        statsOpts.replay_speed = std::strtod(speed_env, nullptr);
+    if (const char *from_env = std::getenv("REZN_STATS_REPLAY_FROM"))
+        statsOpts.replay_from_ms = std::strtoull(from_env, nullptr, 10) * 1000;
+
+    StatsHistory::Config statsHistoryCfg;
+    if (const char *depth_env = std::getenv("REZN_STATS_HISTORY_DEPTH"))
+        statsHistoryCfg.depth = std::strtoull(depth_env, nullptr, 10);
+    if (const char *budget_env = std::getenv("REZN_STATS_HISTORY_MB"))
+        statsHistoryCfg.budget_bytes = std::strtoull(budget_env, nullptr, 10) << 20;
+
+    // containers silent for REZN_STATS_STALE_S are dimmed, for REZN_STATS_EVICT_S dropped
+    StatsExpiry::Config statsExpiryCfg;
+    if (const char *stale_env = std::getenv("REZN_STATS_STALE_S"))
+        statsExpiryCfg.stale_after = std::chrono::seconds{std::strtoull(stale_env, nullptr, 10)};
+    if (const char *evict_env = std::getenv("REZN_STATS_EVICT_S"))
+        statsExpiryCfg.evict_after = std::chrono::seconds{std::strtoull(evict_env, nullptr, 10)};
+
+    StatsRollup::Config statsRollupCfg;
+    if (const char *rollup_env = std::getenv("REZN_STATS_ROLLUP_MB"))
+        statsRollupCfg.budget_bytes = std::strtoull(rollup_env, nullptr, 10) << 20;
+
+    // alert rules, ';' separated: "cpu_avg > 0.9 for 60s; max_mem > 8GiB"
+    // (the default); REZN_STATS_ALERTS="" turns alerting off
+    const char *alerts_env = std::getenv("REZN_STATS_ALERTS");
+    std::vector<StatsAlerts::Rule> statsAlerts;
+    for (std::string_view rest{alerts_env ? alerts_env : "cpu_avg > 0.9 for 60s; max_mem > 8GiB"};
+         !rest.empty();)
+    {
+        const auto semi = rest.find(';');
+        if (auto text = util::trim(rest.substr(0, semi)); !text.empty())
+        {
+            auto rule = StatsAlerts::Rule::parse(text);
+            if (!rule)
+            {
+                std::cerr << "Bad alert rule '" << text << "': " << rule.error() << std::endl;
+                return 1;
+            }
+            statsAlerts.push_back(std::move(*rule));
+        }
+        rest = semi == std::string_view::npos ? std::string_view{} : rest.substr(semi + 1);
+    }
 
     std::unique_ptr<LedgerApiClient> api;
     try
@@ -46,30 +126,49 @@ int main()
 
     LOG_INFO("Connected to daemon at {}", sock_path);
 
-    moodycamel::ReaderWriterQueue<StatsMap> q(1024);
-    auto statsWsClient = std::make_unique<StatsWsClient>(stats_ws_uri, q);
-
-    // Start the WebSocket client in a separate thread
-    std::thread statsThread([&statsWsClient]()
-                            {
-    while (true) {
-        auto result = statsWsClient->run_once();
-        if (!result.has_value()) {
-           LOG_ERROR("WebSocket connection failed: {}", result.error().message);
-            // Add reconnection delay
-           std::this_thread::sleep_for(std::chrono::seconds(5));
-        }
-   } });
-    statsThread.detach();
+    // all stats endpoints share a few epoll loops; reconnects are internal
+    std::unique_ptr<StatsAggregator> statsAggregator;
+    try
+    {
+        statsAggregator = std::make_unique<StatsAggregator>(stats_ws_uris, statsOpts);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "Failed to set up stats: " << ex.what() << std::endl;
+        return 1;
+    }
+    statsAggregator->start();
 
     auto hostService = std::make_unique<HostService>(*api);
-    auto hostsWindow = std::make_unique<HostsWindow>(*hostService);
 
     auto stepCaInitWindow = std::make_unique<StepCaInitWindow>();
 
     auto logWindow = std::make_unique<LogWindow>();
 
-    auto statsWindow = std::make_unique<StatsWindow>(&q);
+    // REZN_STATS_EXPORT serves the merged ledger to Prometheus: "host:port",
+    // ":port" or "unix:/path"
+    std::unique_ptr<StatsExporter> statsExporter;
+    if (const char *export_env = std::getenv("REZN_STATS_EXPORT"); export_env && *export_env)
+    {
+        try
+        {
+            statsExporter = std::make_unique<StatsExporter>(StatsExporter::Config{.listen = export_env});
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << "Failed to start stats exporter: " << ex.what() << std::endl;
+            return 1;
+        }
+    }
+
+    auto statsWindow = std::make_unique<StatsWindow>(statsAggregator.get(), statsHistoryCfg, statsRollupCfg, statsExpiryCfg,
+                                                     std::move(statsAlerts), statsExporter.get());
+
+    // hosts get per‑node container totals when there are stats endpoints to join
+    auto hostsWindow = std::make_unique<HostsWindow>(
+        *hostService, statsAggregator->size() ? &statsWindow->hostStats() : nullptr);
+
+    auto statsLatencyWindow = std::make_unique<StatsLatencyWindow>(statsAggregator.get());
 
     auto tuiBackend = std::make_unique<TuiBackend>(true);
 
@@ -77,11 +176,14 @@ int main()
     bool showStepCaInitWindow = false;
     bool showLogWindow = false;
     bool showStatsWindow = false;
+    bool showStatsLatencyWindow = false;
 
     while (true)
     {
         tuiBackend->new_frame();
 
+        statsWindow->pumpQueue(); // ingest even while the window is closed
+
         if (ImGui::BeginMainMenuBar())
         {
             if (ImGui::BeginMenu("File"))
@@ -111,6 +213,10 @@ int main()
                 {
                     showStatsWindow = true;
                 }
+                if (ImGui::MenuItem("Stats Latency"))
+                {
+                    showStatsLatencyWindow = true;
+                }
                 ImGui::EndMenu();
             }
             ImGui::EndMainMenuBar();
@@ -136,7 +242,13 @@ int main()
             statsWindow->draw(&showStatsWindow);
         }
 
+        if (showStatsLatencyWindow)
+        {
+            statsLatencyWindow->draw(&showStatsLatencyWindow);
+        }
+
         tuiBackend->present();
+        statsWindow->presented(); // merged stats are on screen now
     }
 
     return 0;
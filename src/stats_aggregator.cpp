@@ -0,0 +1,1203 @@
+#include "stats_aggregator.hpp"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <expected>
+#include <mutex>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "log.hpp"
+#include "log_service.hpp"
+#include "stats_decoder.hpp"
+#include "stats_recorder.hpp"
+#include "stats_sequencer.hpp"
+#include "string_utils.hpp"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t kReadChunk = 64 * 1024;
+    constexpr std::size_t kReadBudget = 4 * kReadChunk; // per connection per wakeup
+    constexpr uint64_t kMaxMessage = 64ull << 20; // refuse absurd frames
+    // unparsed input: one frame at most, plus its header and a read chunk
+    constexpr std::size_t kMaxBuffered = kMaxMessage + 14 + kReadChunk;
+
+    struct Target
+    {
+        bool secure{false};
+        std::string host;
+        std::string port;
+        std::string path;
+    };
+
+    // ws[s]://host[:port][/path]; IPv6 literals in brackets
+    std::expected<Target, std::string> parse_uri(std::string_view uri)
+    {
+        Target t;
+        if (uri.starts_with("wss://"))
+        {
+            t.secure = true;
+            uri.remove_prefix(6);
+        }
+        else if (uri.starts_with("ws://"))
+        {
+            uri.remove_prefix(5);
+        }
+        else
+        {
+            return std::unexpected("unsupported scheme (expected ws:// or wss://)");
+        }
+
+        const auto slash = uri.find('/');
+        std::string_view authority = uri.substr(0, slash);
+        t.path = slash == std::string_view::npos ? "/" : std::string{uri.substr(slash)};
+
+        std::string_view port;
+        if (authority.starts_with('['))
+        {
+            const auto close = authority.find(']');
+            if (close == std::string_view::npos)
+                return std::unexpected("unterminated IPv6 literal");
+            t.host = authority.substr(1, close - 1);
+            if (close + 1 < authority.size() && authority[close + 1] == ':')
+                port = authority.substr(close + 2);
+        }
+        else
+        {
+            const auto colon = authority.rfind(':');
+            t.host = authority.substr(0, colon);
+            if (colon != std::string_view::npos)
+                port = authority.substr(colon + 1);
+        }
+        if (t.host.empty())
+            return std::unexpected("missing host");
+        t.port = port.empty() ? (t.secure ? "443" : "80") : std::string{port};
+        return t;
+    }
+
+    std::string base64(std::span<const unsigned char> in)
+    {
+        std::string out(4 * ((in.size() + 2) / 3), '\0');
+        EVP_EncodeBlock(reinterpret_cast<unsigned char *>(out.data()), in.data(),
+                        static_cast<int>(in.size()));
+        return out;
+    }
+
+    std::string accept_key(const std::string &key)
+    {
+        const std::string src = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        unsigned char sha[SHA_DIGEST_LENGTH];
+        SHA1(reinterpret_cast<const unsigned char *>(src.data()), src.size(), sha);
+        return base64(sha);
+    }
+
+    // value of header `name` in an HTTP response head, empty if absent
+    std::string_view header_value(std::string_view head, std::string_view name)
+    {
+        std::size_t pos = head.find("\r\n");
+        while (pos != std::string_view::npos && pos + 2 < head.size())
+        {
+            pos += 2;
+            const auto eol = head.find("\r\n", pos);
+            const auto line = head.substr(pos, eol - pos);
+            const auto colon = line.find(':');
+            if (colon != std::string_view::npos && util::iequals(line.substr(0, colon), name))
+                return util::trim(line.substr(colon + 1));
+            pos = eol;
+        }
+        return {};
+    }
+
+    std::string offer(StatsEncoding preferred)
+    {
+        std::string s{stats_subprotocol(preferred)};
+        for (auto enc : {StatsEncoding::Cbor, StatsEncoding::MsgPack, StatsEncoding::Json})
+        {
+            if (enc == preferred)
+                continue;
+            s += ", ";
+            s += stats_subprotocol(enc);
+        }
+        return s;
+    }
+
+    std::string tls_error()
+    {
+        char buf[256];
+        const unsigned long e = ERR_get_error();
+        if (!e)
+            return "TLS error";
+        ERR_error_string_n(e, buf, sizeof(buf));
+        ERR_clear_error();
+        return buf;
+    }
+
+    // ex_data slot of an SSL object → the endpoint's `SSL_SESSION *` member
+    int tls_session_slot()
+    {
+        static const int slot = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return slot;
+    }
+
+    // Called for every session the server issues (TLS 1.3 sends them after
+    // the handshake); keeps the newest one for the next reconnect.  A copy,
+    // because OpenSSL marks the live session non‑resumable when the
+    // connection dies with an error — exactly when we want to resume it.
+    int on_new_session(SSL *ssl, SSL_SESSION *session)
+    {
+        auto **slot = static_cast<SSL_SESSION **>(SSL_get_ex_data(ssl, tls_session_slot()));
+        if (!slot)
+            return 0;
+        if (SSL_SESSION *copy = SSL_SESSION_dup(session))
+        {
+            if (*slot)
+                SSL_SESSION_free(*slot);
+            *slot = copy;
+        }
+        return 0; // the original reference stays with OpenSSL
+    }
+
+    int64_t steady_ns(Clock::time_point t)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    }
+
+    uint64_t wall_ms()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+    }
+} // namespace
+
+// -----------------------------------------------------------------------------
+// Endpoint — shared between the loop thread and the consumer
+// -----------------------------------------------------------------------------
+
+struct StatsAggregator::Endpoint
+{
+    std::size_t index{};
+    std::string uri;
+    StatsMailbox mailbox;
+    StatsLatency latency;
+
+    mutable std::mutex mtx; // guards health
+    Health health;
+
+    template <typename F>
+    void update(F &&f)
+    {
+        std::lock_guard lock{mtx};
+        f(health);
+    }
+};
+
+// -----------------------------------------------------------------------------
+// Worker — one epoll loop over a subset of the endpoints
+// -----------------------------------------------------------------------------
+
+class StatsAggregator::Worker
+{
+public:
+    Worker(const Options &opt, DnsCache &dns, SSL_CTX *tls, StatsRecorder *recorder)
+        : opt_{opt}, dns_{dns}, tls_{tls}, recorder_{recorder}, rng_{std::random_device{}()}
+    {
+        epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        wakefd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epfd_ < 0 || wakefd_ < 0)
+            throw std::runtime_error(std::string{"stats aggregator: "} + std::strerror(errno));
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr; // wake‑up event
+        ::epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+        rbuf_.resize(kReadChunk);
+    }
+
+    ~Worker()
+    {
+        stop();
+        for (auto &c : conns_)
+        {
+            close_(*c);
+            if (c->session)
+                SSL_SESSION_free(c->session);
+        }
+        ::close(wakefd_);
+        ::close(epfd_);
+    }
+
+    void add(Endpoint &ep)
+    {
+        auto c = std::make_unique<Conn>();
+        c->ep = &ep;
+        if (auto t = parse_uri(ep.uri))
+            c->target = std::move(*t);
+        else
+            c->bad_uri = t.error();
+        conns_.push_back(std::move(c));
+    }
+
+    void start()
+    {
+        thread_ = std::thread{[this]
+                              { run_(); }};
+    }
+
+    void stop()
+    {
+        if (!thread_.joinable())
+            return;
+        stopping_ = true;
+        const uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(wakefd_, &one, sizeof(one));
+        thread_.join();
+    }
+
+private:
+    enum class Phase
+    {
+        Tcp,       // non‑blocking connect in flight
+        Tls,       // TLS handshake
+        Upgrade,   // HTTP upgrade request / 101 response
+        Open,      // WebSocket frames
+        Backoff,   // disconnected, waiting for `deadline`
+    };
+
+    struct Conn
+    {
+        Endpoint *ep{};
+        Target target;
+        std::string bad_uri; // non‑empty: never connect
+
+        int fd{-1};
+        SSL *ssl{};
+        SSL_SESSION *session{}; // last TLS session, offered for resumption
+        std::size_t next_addr{}; // rotates through resolved addresses
+        std::size_t addr_count{1};
+        Phase phase{Phase::Backoff};
+        Clock::time_point deadline{}; // timeout of the current phase
+        uint32_t events{};            // registered epoll interest
+        bool tls_wants_write{false};
+
+        std::string tx; // pending output
+        std::size_t tx_off{};
+        std::string rx; // unparsed input (capacity survives reconnects)
+        Clock::time_point rx_at{}; // when the last bytes of rx arrived
+        std::string key; // Sec-WebSocket-Key of the current attempt
+
+        std::string message; // fragmented message being reassembled
+        uint8_t message_op{};
+
+        StatsDecoder decoder;
+        StatsBinaryDecoder bin_decoder;
+        StatsBatch batch;
+        StatsSequencer sequencer;
+        std::string last_error;
+
+        uint32_t retry{};              // consecutive failures, drives backoff
+        Clock::time_point attempt_start{};
+        Clock::time_point lost_at{};   // when an open connection dropped
+        bool lost{false};
+    };
+
+    enum class Io
+    {
+        Ok,
+        Again,
+        Closed,
+        Error,
+    };
+
+    // ---------------------------------------------------------------------
+    // Loop
+    // ---------------------------------------------------------------------
+
+    // connections start in Backoff with an expired deadline, so the first
+    // pass of the loop connects all of them
+    void run_()
+    {
+        epoll_event evs[64];
+        while (!stopping_)
+        {
+            auto now = Clock::now();
+            auto next = now + std::chrono::seconds{1};
+            for (auto &c : conns_)
+            {
+                if (c->deadline <= now)
+                    on_deadline_(*c);
+                next = std::min(next, c->deadline);
+            }
+
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - now);
+            const int n = ::epoll_wait(epfd_, evs, 64, std::clamp<int>(static_cast<int>(wait.count()) + 1, 0, 1000));
+            for (int i = 0; i < n; ++i)
+            {
+                if (!evs[i].data.ptr)
+                {
+                    uint64_t v;
+                    [[maybe_unused]] auto r = ::read(wakefd_, &v, sizeof(v));
+                    continue;
+                }
+                on_event_(*static_cast<Conn *>(evs[i].data.ptr), evs[i].events);
+            }
+        }
+    }
+
+    void on_deadline_(Conn &c)
+    {
+        switch (c.phase)
+        {
+        case Phase::Backoff:
+            connect_(c);
+            break;
+        case Phase::Open:
+            fail_(c, "no data within the idle timeout");
+            break;
+        default:
+            fail_(c, "connect/handshake timed out");
+            break;
+        }
+    }
+
+    void on_event_(Conn &c, uint32_t events)
+    {
+        switch (c.phase)
+        {
+        case Phase::Tcp:
+        {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            ::getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err)
+                return fail_(c, std::strerror(err));
+            if (!(events & EPOLLOUT))
+                return;
+            if (c.target.secure)
+                return start_tls_(c);
+            return start_upgrade_(c);
+        }
+        case Phase::Tls:
+            return drive_tls_(c);
+        case Phase::Upgrade:
+        case Phase::Open:
+            if (events & EPOLLOUT)
+            {
+                c.tls_wants_write = false;
+                if (!flush_(c))
+                    return;
+            }
+            // a TLS read may have stalled on the write side, so retry it
+            if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) || c.ssl)
+                read_(c);
+            if (c.fd >= 0)
+                update_interest_(c);
+            return;
+        case Phase::Backoff:
+            return;
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Connection lifecycle
+    // ---------------------------------------------------------------------
+
+    void connect_(Conn &c)
+    {
+        close_(c);
+        c.attempt_start = Clock::now();
+        c.ep->update([](Health &h)
+                     {
+                         h.state = State::Connecting;
+                         ++h.attempts; });
+
+        if (!c.bad_uri.empty())
+            return fail_(c, c.bad_uri);
+
+        auto dns = dns_.resolve(c.target.host, c.target.port);
+        if (!dns)
+            return fail_(c, dns.error());
+        if (dns->addresses.empty())
+            return fail_(c, "resolve: no addresses");
+        if (dns->cached)
+            c.ep->update([](Health &h)
+                         { ++h.dns_cached; });
+
+        c.addr_count = dns->addresses.size();
+        const auto &addr = dns->addresses[c.next_addr % c.addr_count];
+        // from here on a failure is this address's: fail_() moves to the next
+        // one even when socket() / connect() refuse synchronously
+        c.phase = Phase::Tcp;
+        c.fd = ::socket(addr.family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int rc = c.fd < 0 ? -1 : ::connect(c.fd, reinterpret_cast<const sockaddr *>(&addr.addr), addr.len);
+        const int err = errno;
+        if (c.fd < 0 || (rc != 0 && err != EINPROGRESS))
+            return fail_(c, std::string{"connect: "} + std::strerror(err));
+
+        const int one = 1;
+        ::setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        c.deadline = Clock::now() + opt_.connect_timeout;
+        c.events = EPOLLIN | EPOLLOUT;
+        epoll_event ev{};
+        ev.events = c.events;
+        ev.data.ptr = &c;
+        ::epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    void start_tls_(Conn &c)
+    {
+        c.ssl = SSL_new(tls_);
+        if (!c.ssl)
+            return fail_(c, tls_error());
+        SSL_set_fd(c.ssl, c.fd);
+        SSL_set_tlsext_host_name(c.ssl, c.target.host.c_str());
+        SSL_set1_host(c.ssl, c.target.host.c_str()); // certificate must match
+        SSL_set_mode(c.ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+        SSL_set_ex_data(c.ssl, tls_session_slot(), &c.session); // see on_new_session
+        if (c.session)
+            SSL_set_session(c.ssl, c.session);
+        SSL_set_connect_state(c.ssl);
+        c.phase = Phase::Tls;
+        drive_tls_(c);
+    }
+
+    void drive_tls_(Conn &c)
+    {
+        const int rc = SSL_do_handshake(c.ssl);
+        if (rc == 1)
+        {
+            if (SSL_session_reused(c.ssl))
+                c.ep->update([](Health &h)
+                             { ++h.tls_resumed; });
+            return start_upgrade_(c);
+        }
+
+        switch (SSL_get_error(c.ssl, rc))
+        {
+        case SSL_ERROR_WANT_READ:
+            c.tls_wants_write = false;
+            break;
+        case SSL_ERROR_WANT_WRITE:
+            c.tls_wants_write = true;
+            break;
+        default:
+            if (c.session) // maybe the session is the problem; next try is a full handshake
+            {
+                SSL_SESSION_free(c.session);
+                c.session = nullptr;
+            }
+            return fail_(c, "TLS handshake: " + tls_error());
+        }
+        update_interest_(c);
+    }
+
+    void start_upgrade_(Conn &c)
+    {
+        unsigned char nonce[16];
+        for (auto &b : nonce)
+            b = static_cast<unsigned char>(rng_());
+        c.key = base64(nonce);
+
+        c.tx.clear();
+        c.tx_off = 0;
+        c.tx += "GET " + c.target.path + " HTTP/1.1\r\n";
+        c.tx += "Host: " + c.target.host + ":" + c.target.port + "\r\n";
+        c.tx += "Upgrade: websocket\r\nConnection: Upgrade\r\n";
+        c.tx += "Sec-WebSocket-Key: " + c.key + "\r\n";
+        c.tx += "Sec-WebSocket-Version: 13\r\n";
+        c.tx += "Sec-WebSocket-Protocol: " + offer(opt_.encoding) + "\r\n\r\n";
+
+        c.phase = Phase::Upgrade;
+        c.tls_wants_write = false;
+        if (flush_(c))
+            update_interest_(c);
+    }
+
+    // parse the 101 response once the head is complete
+    bool finish_upgrade_(Conn &c)
+    {
+        const auto end = c.rx.find("\r\n\r\n");
+        if (end == std::string::npos)
+        {
+            if (c.rx.size() > 16 * 1024)
+                fail_(c, "oversized handshake response");
+            return false;
+        }
+
+        const std::string_view head{c.rx.data(), end + 2};
+        if (!head.starts_with("HTTP/1.1 101"))
+        {
+            fail_(c, "upgrade refused: " + std::string{head.substr(0, head.find("\r\n"))});
+            return false;
+        }
+        if (header_value(head, "Sec-WebSocket-Accept") != accept_key(c.key))
+        {
+            fail_(c, "bad Sec-WebSocket-Accept");
+            return false;
+        }
+
+        std::string proto{header_value(head, "Sec-WebSocket-Protocol")};
+        c.rx.erase(0, end + 4); // frames may follow in the same read
+        const auto now = Clock::now();
+        c.phase = Phase::Open;
+        c.deadline = now + opt_.idle_timeout;
+        c.sequencer.reset(); // a new connection starts from a full snapshot
+        c.last_error.clear();
+
+        const auto connect_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - c.attempt_start);
+        const auto reconnect_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - c.lost_at);
+        const bool was_lost = std::exchange(c.lost, false);
+        c.ep->update([&](Health &h)
+                     {
+                         h.state = State::Open;
+                         h.subprotocol = std::move(proto);
+                         h.connect_ms = static_cast<uint64_t>(connect_ms.count());
+                         if (was_lost)
+                             h.reconnect_ms = static_cast<uint64_t>(reconnect_ms.count());
+                         ++h.connects; });
+        LOG_INFO("Stats endpoint {} connected", c.ep->uri);
+
+        if (opt_.delta)
+            send_frame_(c, 0x1, kStatsSubscribeDelta);
+        return true;
+    }
+
+    /** Drop the connection and schedule a reconnect. */
+    void fail_(Conn &c, std::string why)
+    {
+        const bool was_open = c.phase == Phase::Open;
+        if (c.phase == Phase::Tcp && ++c.next_addr % c.addr_count == 0)
+        {
+            // every address failed once: maybe the service moved, re‑resolve
+            dns_.invalidate(c.target.host, c.target.port);
+            c.next_addr = 0;
+        }
+        close_(c);
+
+        const auto now = Clock::now();
+        if (was_open && !c.lost)
+        {
+            c.lost = true;
+            c.lost_at = now;
+        }
+        c.phase = Phase::Backoff;
+        c.deadline = now + backoff_(++c.retry);
+
+        // endpoints that stay down would log every retry; only log changes
+        if (was_open || why != c.last_error)
+            LOG_WARN("Stats endpoint {}: {}", c.ep->uri, why);
+        c.last_error = why;
+        c.ep->update([&](Health &h)
+                     {
+                         h.state = State::Backoff;
+                         h.last_error = std::move(why);
+                         h.retry = c.retry;
+                         ++h.failures; });
+    }
+
+    /**
+     * Exponential backoff with "equal jitter": the cap doubles per failure
+     * up to `backoff_max`, and the wait is a random point in its upper half,
+     * so retries never hammer but still spread out.
+     */
+    Clock::duration backoff_(uint32_t retry)
+    {
+        const auto cap = std::min<Clock::duration>(
+            opt_.backoff_max, opt_.backoff_initial * (uint64_t{1} << std::min<uint32_t>(retry - 1, 20)));
+        std::uniform_int_distribution<Clock::rep> jitter{0, cap.count() / 2};
+        return Clock::duration{cap.count() - cap.count() / 2 + jitter(rng_)};
+    }
+
+    void close_(Conn &c)
+    {
+        if (c.ssl)
+        {
+            SSL_free(c.ssl);
+            c.ssl = nullptr;
+        }
+        if (c.fd >= 0)
+        {
+            ::epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+            ::close(c.fd);
+            c.fd = -1;
+        }
+        c.tx.clear();
+        c.tx_off = 0;
+        c.rx.clear();
+        c.message.clear();
+        c.tls_wants_write = false;
+        c.events = 0;
+    }
+
+    void update_interest_(Conn &c)
+    {
+        uint32_t want = EPOLLIN;
+        if (c.tls_wants_write || c.tx_off < c.tx.size())
+            want |= EPOLLOUT;
+        if (want == c.events)
+            return;
+        c.events = want;
+        epoll_event ev{};
+        ev.events = want;
+        ev.data.ptr = &c;
+        ::epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+    }
+
+    // ---------------------------------------------------------------------
+    // I/O
+    // ---------------------------------------------------------------------
+
+    Io recv_(Conn &c, std::size_t &got)
+    {
+        if (c.ssl)
+        {
+            const int n = SSL_read(c.ssl, rbuf_.data(), static_cast<int>(rbuf_.size()));
+            if (n > 0)
+            {
+                got = static_cast<std::size_t>(n);
+                return Io::Ok;
+            }
+            switch (SSL_get_error(c.ssl, n))
+            {
+            case SSL_ERROR_WANT_READ:
+                return Io::Again;
+            case SSL_ERROR_WANT_WRITE:
+                c.tls_wants_write = true;
+                return Io::Again;
+            case SSL_ERROR_ZERO_RETURN:
+                return Io::Closed;
+            default:
+                return Io::Error;
+            }
+        }
+
+        const ssize_t n = ::recv(c.fd, rbuf_.data(), rbuf_.size(), 0);
+        if (n > 0)
+        {
+            got = static_cast<std::size_t>(n);
+            return Io::Ok;
+        }
+        if (n == 0)
+            return Io::Closed;
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? Io::Again : Io::Error;
+    }
+
+    Io send_(Conn &c, const char *data, std::size_t len, std::size_t &sent)
+    {
+        if (c.ssl)
+        {
+            const int n = SSL_write(c.ssl, data, static_cast<int>(len));
+            if (n > 0)
+            {
+                sent = static_cast<std::size_t>(n);
+                c.tls_wants_write = false;
+                return Io::Ok;
+            }
+            switch (SSL_get_error(c.ssl, n))
+            {
+            case SSL_ERROR_WANT_READ:
+            case SSL_ERROR_WANT_WRITE:
+                return Io::Again;
+            default:
+                return Io::Error;
+            }
+        }
+
+        const ssize_t n = ::send(c.fd, data, len, MSG_NOSIGNAL);
+        if (n >= 0)
+        {
+            sent = static_cast<std::size_t>(n);
+            return Io::Ok;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? Io::Again : Io::Error;
+    }
+
+    /** Write as much pending output as the socket takes; false if the
+     *  connection failed. */
+    bool flush_(Conn &c)
+    {
+        while (c.tx_off < c.tx.size())
+        {
+            std::size_t sent = 0;
+            switch (send_(c, c.tx.data() + c.tx_off, c.tx.size() - c.tx_off, sent))
+            {
+            case Io::Ok:
+                c.tx_off += sent;
+                continue;
+            case Io::Again:
+                return true;
+            default:
+                fail_(c, c.ssl ? "send: " + tls_error() : std::string{"send: "} + std::strerror(errno));
+                return false;
+            }
+        }
+        c.tx.clear();
+        c.tx_off = 0;
+        return true;
+    }
+
+    /** Read at most `kReadBudget` bytes, parsing after every chunk so `rx`
+     *  never holds more than one partial frame plus a chunk; epoll is level
+     *  triggered and reports the rest on the next wait. */
+    void read_(Conn &c)
+    {
+        for (std::size_t budget = kReadBudget; c.fd >= 0 && budget > 0;)
+        {
+            std::size_t got = 0;
+            switch (recv_(c, got))
+            {
+            case Io::Ok:
+                break;
+            case Io::Again:
+                return;
+            case Io::Closed:
+                return fail_(c, "connection closed by peer");
+            default:
+                return fail_(c, c.ssl ? "recv: " + tls_error() : std::string{"recv: "} + std::strerror(errno));
+            }
+            budget -= std::min(got, budget);
+            c.rx.append(rbuf_.data(), got);
+            c.rx_at = Clock::now();
+
+            if (c.phase == Phase::Upgrade && !finish_upgrade_(c))
+                continue; // head incomplete (or the upgrade failed: fd closed)
+            if (c.phase == Phase::Open)
+            {
+                c.deadline = Clock::now() + opt_.idle_timeout;
+                if (!parse_frames_(c) || !flush_(c))
+                    return;
+                if (c.rx.size() > kMaxBuffered)
+                    return fail_(c, "receive buffer overflow");
+            }
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // WebSocket framing
+    // ---------------------------------------------------------------------
+
+    /** Consume every complete frame in `rx`; false if the connection died. */
+    bool parse_frames_(Conn &c)
+    {
+        std::size_t off = 0;
+        while (true)
+        {
+            const std::size_t avail = c.rx.size() - off;
+            if (avail < 2)
+                break;
+            const auto *p = reinterpret_cast<const uint8_t *>(c.rx.data() + off);
+            const bool fin = p[0] & 0x80;
+            const uint8_t op = p[0] & 0x0F;
+            if (p[1] & 0x80)
+            {
+                fail_(c, "server sent a masked frame");
+                return false;
+            }
+
+            uint64_t len = p[1] & 0x7F;
+            std::size_t hdr = 2;
+            if (len == 126)
+            {
+                if (avail < 4)
+                    break;
+                len = (uint64_t{p[2]} << 8) | p[3];
+                hdr = 4;
+            }
+            else if (len == 127)
+            {
+                if (avail < 10)
+                    break;
+                len = 0;
+                for (int i = 0; i < 8; ++i)
+                    len = (len << 8) | p[2 + i];
+                hdr = 10;
+            }
+            if (len > kMaxMessage || c.message.size() + len > kMaxMessage)
+            {
+                fail_(c, "frame too large");
+                return false;
+            }
+            if (avail - hdr < len)
+                break;
+
+            const std::string_view payload{c.rx.data() + off + hdr, static_cast<std::size_t>(len)};
+            off += hdr + static_cast<std::size_t>(len);
+
+            switch (op)
+            {
+            case 0x0: // continuation
+                c.message.append(payload);
+                if (fin)
+                {
+                    on_message_(c, c.message_op, c.message);
+                    c.message.clear();
+                }
+                break;
+            case 0x1:
+            case 0x2:
+                if (fin)
+                {
+                    on_message_(c, op, payload); // straight from the read buffer
+                }
+                else
+                {
+                    c.message.assign(payload);
+                    c.message_op = op;
+                }
+                break;
+            case 0x8: // close: echo the status code, then drop
+                send_frame_(c, 0x8, payload.substr(0, std::min<std::size_t>(payload.size(), 2)));
+                flush_(c);
+                if (c.fd >= 0)
+                    fail_(c, "closed by server");
+                return false;
+            case 0x9: // ping
+                send_frame_(c, 0xA, payload);
+                break;
+            default: // pong / reserved
+                break;
+            }
+        }
+        c.rx.erase(0, off);
+        return true;
+    }
+
+    void send_frame_(Conn &c, uint8_t op, std::string_view payload)
+    {
+        uint8_t hdr[14];
+        std::size_t n = 2;
+        hdr[0] = static_cast<uint8_t>(0x80 | op);
+        if (payload.size() < 126)
+        {
+            hdr[1] = static_cast<uint8_t>(0x80 | payload.size());
+        }
+        else if (payload.size() <= 0xFFFF)
+        {
+            hdr[1] = 0x80 | 126;
+            hdr[2] = static_cast<uint8_t>(payload.size() >> 8);
+            hdr[3] = static_cast<uint8_t>(payload.size());
+            n = 4;
+        }
+        else
+        {
+            hdr[1] = 0x80 | 127;
+            for (int i = 0; i < 8; ++i)
+                hdr[2 + i] = static_cast<uint8_t>(static_cast<uint64_t>(payload.size()) >> (56 - 8 * i));
+            n = 10;
+        }
+        const uint32_t mask = static_cast<uint32_t>(rng_());
+        std::memcpy(hdr + n, &mask, 4);
+        const auto *m = hdr + n;
+        n += 4;
+
+        c.tx.append(reinterpret_cast<const char *>(hdr), n);
+        const std::size_t at = c.tx.size();
+        c.tx.append(payload);
+        for (std::size_t i = 0; i < payload.size(); ++i)
+            c.tx[at + i] = static_cast<char>(c.tx[at + i] ^ m[i % 4]);
+    }
+
+    void on_message_(Conn &c, uint8_t op, std::string_view payload)
+    {
+        auto res = op == 0x2
+                       ? c.bin_decoder.decode(std::as_bytes(std::span{payload.data(), payload.size()}), c.batch)
+                       : c.decoder.decode(payload, c.batch);
+
+        const auto parsed = Clock::now();
+        const uint64_t now = wall_ms();
+        auto verdict = StatsSequencer::Verdict::Discard;
+        if (res)
+        {
+            const uint64_t expected = c.sequencer.expected();
+            verdict = c.sequencer.accept(c.batch);
+            if (verdict == StatsSequencer::Verdict::Apply)
+            {
+                c.batch.add_stamp(c.ep->latency.observe(c.batch, now, steady_ns(c.rx_at), steady_ns(parsed)));
+                c.ep->mailbox.publish(c.batch);
+                if (recorder_)
+                    recorder_->record(c.ep->index, now, c.batch);
+            }
+            else if (verdict == StatsSequencer::Verdict::Gap)
+            {
+                LOG_WARN("Stats endpoint {}: delta gap (expected seq {}, got {}); resubscribing",
+                         c.ep->uri, expected, c.batch.seq());
+                send_frame_(c, 0x1, kStatsResubscribeDelta);
+            }
+        }
+        else
+        {
+            LOG_DEBUG("Stats endpoint {}: dropping frame: {}", c.ep->uri, res.error());
+        }
+
+        const bool healthy = std::exchange(c.retry, 0) != 0; // data flows again
+        c.ep->update([&](Health &h)
+                     {
+                         if (healthy)
+                             h.retry = 0;
+                         ++h.frames;
+                         h.bytes += payload.size();
+                         h.last_frame_ms = now;
+                         if (!res)
+                             ++h.bad_frames;
+                         if (verdict == StatsSequencer::Verdict::Gap)
+                             ++h.gaps; });
+    }
+
+    const Options &opt_;
+    DnsCache &dns_;
+    SSL_CTX *tls_;
+    StatsRecorder *recorder_; // null unless recording
+    std::mt19937_64 rng_; // handshake nonces, frame masks, backoff jitter
+
+    int epfd_{-1};
+    int wakefd_{-1};
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+
+    std::vector<std::unique_ptr<Conn>> conns_; // stable addresses for epoll
+    std::string rbuf_;                         // read chunk, shared by all conns
+};
+
+// -----------------------------------------------------------------------------
+// Replayer — feeds the endpoint mailboxes from a recording
+// -----------------------------------------------------------------------------
+
+class StatsAggregator::Replayer
+{
+public:
+    Replayer(const Options &opt, std::unique_ptr<StatsReplay> replay,
+             std::vector<std::unique_ptr<Endpoint>> &endpoints)
+        : opt_{opt}, replay_{std::move(replay)}, endpoints_{endpoints}
+    {
+    }
+
+    ~Replayer() { stop(); }
+
+    void start()
+    {
+        thread_ = std::thread{[this]
+                              { run_(); }};
+    }
+
+    void stop()
+    {
+        if (!thread_.joinable())
+            return;
+        {
+            std::lock_guard lock{mtx_};
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+private:
+    void run_()
+    {
+        const uint64_t from = std::max(opt_.replay_from_ms, replay_->begin_ms());
+        replay_->seek(from);
+        LOG_INFO("Stats replay: {} endpoint(s), {} → {} ms, speed {}",
+                 endpoints_.size(), from, replay_->end_ms(), opt_.replay_speed);
+
+        for (auto &ep : endpoints_)
+            ep->update([](Health &h)
+                       { h.state = State::Replay; });
+
+        const auto started = Clock::now();
+        std::size_t index = 0;
+        uint64_t recv_ms = 0;
+        while (replay_->next(index, recv_ms, batch_))
+        {
+            // records between the keyframe and `from` rebuild state: no pacing
+            if (recv_ms > from && opt_.replay_speed > 0)
+            {
+                const auto due = started + std::chrono::duration_cast<Clock::duration>(
+                                               std::chrono::duration<double, std::milli>(
+                                                   static_cast<double>(recv_ms - from) / opt_.replay_speed));
+                std::unique_lock lock{mtx_};
+                if (cv_.wait_until(lock, due, [this]
+                                   { return stopping_.load(); }))
+                    return;
+            }
+            else if (stopping_.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            auto &ep = *endpoints_[index];
+            ep.mailbox.publish(batch_);
+            const uint64_t now = wall_ms();
+            ep.update([&](Health &h)
+                      {
+                          ++h.frames;
+                          h.last_frame_ms = now; });
+        }
+
+        LOG_INFO("Stats replay: end of recording");
+        for (auto &ep : endpoints_)
+            ep->update([](Health &h)
+                       { h.last_error = "end of recording"; });
+    }
+
+    const Options &opt_;
+    std::unique_ptr<StatsReplay> replay_;
+    std::vector<std::unique_ptr<Endpoint>> &endpoints_;
+    StatsBatch batch_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+// -----------------------------------------------------------------------------
+// StatsAggregator
+// -----------------------------------------------------------------------------
+
+namespace
+{
+    struct SslCtxDeleter
+    {
+        void operator()(SSL_CTX *ctx) const { SSL_CTX_free(ctx); }
+    };
+
+    // one client context for every wss:// endpoint, created on first use
+    SSL_CTX *client_tls_context()
+    {
+        static std::unique_ptr<SSL_CTX, SslCtxDeleter> ctx = []
+        {
+            std::unique_ptr<SSL_CTX, SslCtxDeleter> c{SSL_CTX_new(TLS_client_method())};
+            if (!c)
+                throw std::runtime_error("SSL_CTX_new failed: " + tls_error());
+            SSL_CTX_set_min_proto_version(c.get(), TLS1_2_VERSION);
+            SSL_CTX_set_default_verify_paths(c.get());
+            SSL_CTX_set_verify(c.get(), SSL_VERIFY_PEER, nullptr);
+
+            // sessions are kept per endpoint (see on_new_session), not in
+            // OpenSSL's internal cache keyed by nothing useful on a client
+            SSL_CTX_set_session_cache_mode(c.get(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(c.get(), on_new_session);
+            return c;
+        }();
+        return ctx.get();
+    }
+} // namespace
+
+StatsAggregator::StatsAggregator(std::vector<std::string> uris, Options opt)
+    : opt_{opt}, dns_{DnsCache::Config{opt.dns_ttl, std::chrono::seconds{5}}}
+{
+    std::unique_ptr<StatsReplay> replay;
+    if (!opt_.replay_dir.empty())
+    {
+        replay = std::make_unique<StatsReplay>(opt_.replay_dir);
+        uris = replay->endpoints();
+    }
+
+    endpoints_.reserve(uris.size());
+    for (const auto &u : uris)
+    {
+        auto ep = std::make_unique<Endpoint>();
+        ep->index = endpoints_.size();
+        ep->uri = u;
+        endpoints_.push_back(std::move(ep));
+    }
+
+    if (replay)
+    {
+        replayer_ = std::make_unique<Replayer>(opt_, std::move(replay), endpoints_);
+        return;
+    }
+
+    if (!opt_.record_dir.empty())
+        recorder_ = std::make_unique<StatsRecorder>(std::move(uris), StatsRecorder::Config{.dir = opt_.record_dir});
+
+    const std::size_t threads = std::clamp<std::size_t>(opt_.threads, 1, std::max<std::size_t>(endpoints_.size(), 1));
+    SSL_CTX *tls = client_tls_context();
+    for (std::size_t i = 0; i < threads; ++i)
+        workers_.push_back(std::make_unique<Worker>(opt_, dns_, tls, recorder_.get()));
+    for (std::size_t i = 0; i < endpoints_.size(); ++i)
+        workers_[i % threads]->add(*endpoints_[i]);
+}
+
+StatsAggregator::~StatsAggregator()
+{
+    stop();
+}
+
+void StatsAggregator::start()
+{
+    for (auto &w : workers_)
+        w->start();
+    if (replayer_)
+        replayer_->start();
+}
+
+void StatsAggregator::stop()
+{
+    for (auto &w : workers_)
+        w->stop();
+    if (replayer_)
+        replayer_->stop();
+}
+
+const std::string &StatsAggregator::uri(std::size_t endpoint) const
+{
+    return endpoints_.at(endpoint)->uri;
+}
+
+StatsMailbox &StatsAggregator::mailbox(std::size_t endpoint)
+{
+    return endpoints_.at(endpoint)->mailbox;
+}
+
+StatsLatency &StatsAggregator::latency(std::size_t endpoint)
+{
+    return endpoints_.at(endpoint)->latency;
+}
+
+StatsAggregator::Health StatsAggregator::health(std::size_t endpoint) const
+{
+    const auto &ep = *endpoints_.at(endpoint);
+    std::lock_guard lock{ep.mtx};
+    return ep.health;
+}
+
+const char *StatsAggregator::state_name(State state) noexcept
+{
+    switch (state)
+    {
+    case State::Connecting:
+        return "connecting";
+    case State::Open:
+        return "open";
+    case State::Replay:
+        return "replay";
+    default:
+        return "backoff";
+    }
+}
@@ -0,0 +1,573 @@
+#include "stats_exporter.hpp"
+
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "log.hpp"
+#include "log_service.hpp"
+#include "string_utils.hpp"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t kMaxRequest = 8 * 1024;
+    constexpr std::size_t kHeadRoom = 192; // response header is written in front of the body
+    constexpr std::size_t kBytesPerRow = 4 * 96;
+
+    constexpr std::string_view kTextType = "text/plain; version=0.0.4; charset=utf-8";
+    constexpr std::string_view kOpenMetricsType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+    std::runtime_error sys_error(std::string_view what)
+    {
+        return std::runtime_error{std::format("stats exporter: {}: {}", what, std::strerror(errno))};
+    }
+
+    int bind_unix(std::string_view path)
+    {
+        sockaddr_un sa{};
+        if (path.empty() || path.size() >= sizeof sa.sun_path)
+            throw std::runtime_error{std::format("stats exporter: bad socket path '{}'", path)};
+        sa.sun_family = AF_UNIX;
+        std::memcpy(sa.sun_path, path.data(), path.size());
+
+        // a socket left behind by an earlier run would make bind() fail
+        struct stat st{};
+        if (::stat(sa.sun_path, &st) == 0 && S_ISSOCK(st.st_mode))
+            ::unlink(sa.sun_path);
+
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            throw sys_error("socket");
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&sa), sizeof sa) < 0)
+        {
+            const auto err = sys_error(std::format("bind {}", path));
+            ::close(fd);
+            throw err;
+        }
+        return fd;
+    }
+
+    // "host:port", ":port", "[v6]:port"
+    int bind_tcp(std::string_view listen)
+    {
+        const auto colon = listen.rfind(':');
+        if (colon == std::string_view::npos)
+            throw std::runtime_error{std::format("stats exporter: expected host:port, got '{}'", listen)};
+        std::string host{listen.substr(0, colon)};
+        const std::string port{listen.substr(colon + 1)};
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+            host = host.substr(1, host.size() - 2);
+
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo *res = nullptr;
+        if (const int rc = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res); rc != 0)
+            throw std::runtime_error{std::format("stats exporter: {}: {}", listen, ::gai_strerror(rc))};
+        std::unique_ptr<addrinfo, decltype(&::freeaddrinfo)> guard{res, &::freeaddrinfo};
+
+        std::string last = "no address";
+        for (auto *ai = res; ai; ai = ai->ai_next)
+        {
+            const int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0)
+                continue;
+            const int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+            if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+                return fd;
+            last = std::strerror(errno);
+            ::close(fd);
+        }
+        throw std::runtime_error{std::format("stats exporter: bind {}: {}", listen, last)};
+    }
+
+    // --- rendering -----------------------------------------------------------
+
+    void put_u64(std::string &o, uint64_t v)
+    {
+        char buf[24];
+        const auto r = std::to_chars(buf, buf + sizeof buf, v);
+        o.append(buf, static_cast<std::size_t>(r.ptr - buf));
+    }
+
+    void put_f64(std::string &o, double v)
+    {
+        char buf[32];
+        const auto r = std::to_chars(buf, buf + sizeof buf, v);
+        o.append(buf, static_cast<std::size_t>(r.ptr - buf));
+    }
+
+    // milliseconds as decimal seconds, "1700000000.123", without going through double
+    void put_millis(std::string &o, uint64_t ms)
+    {
+        put_u64(o, ms / 1000);
+        const auto frac = static_cast<unsigned>(ms % 1000);
+        const char buf[4] = {'.', static_cast<char>('0' + frac / 100), static_cast<char>('0' + frac / 10 % 10),
+                             static_cast<char>('0' + frac % 10)};
+        o.append(buf, 4);
+    }
+
+    // label values escape \, " and newline
+    void put_label(std::string &o, std::string_view s)
+    {
+        if (std::none_of(s.begin(), s.end(), [](char c)
+                         { return c == '\\' || c == '"' || c == '\n'; }))
+        {
+            o.append(s);
+            return;
+        }
+        for (const char c : s)
+        {
+            if (c == '\n')
+                o.append("\\n");
+            else
+            {
+                if (c == '\\' || c == '"')
+                    o.push_back('\\');
+                o.push_back(c);
+            }
+        }
+    }
+
+    void put_family(std::string &o, std::string_view name, std::string_view type, std::string_view help)
+    {
+        o.append("# HELP ").append(name).push_back(' ');
+        o.append(help).append("\n# TYPE ").append(name).push_back(' ');
+        o.append(type).push_back('\n');
+    }
+
+    bool iequals_prefix(std::string_view s, std::string_view prefix)
+    {
+        return s.size() >= prefix.size() && util::iequals(s.substr(0, prefix.size()), prefix);
+    }
+} // namespace
+
+struct StatsExporter::Client
+{
+    int fd{-1};
+    Clock::time_point deadline; // request complete / next chunk taken by then
+    std::string in;
+    std::string out;
+    std::size_t sent{};
+    bool responding{false};
+};
+
+StatsExporter::StatsExporter(Config cfg) : cfg_{std::move(cfg)}
+{
+    const std::string_view listen{cfg_.listen};
+    if (listen.starts_with("unix:"))
+    {
+        unix_path_ = listen.substr(5);
+        listen_fd_ = bind_unix(unix_path_);
+    }
+    else
+    {
+        listen_fd_ = bind_tcp(listen);
+    }
+
+    if (::listen(listen_fd_, 64) < 0)
+    {
+        const auto err = sys_error("listen");
+        ::close(listen_fd_);
+        throw err;
+    }
+
+    epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wakefd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epfd_ < 0 || wakefd_ < 0)
+    {
+        const auto err = sys_error("epoll");
+        for (const int fd : {listen_fd_, epfd_, wakefd_})
+            if (fd >= 0)
+                ::close(fd);
+        throw err;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr; // listener
+    ::epoll_ctl(epfd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+    ev.data.ptr = &wakefd_;
+    ::epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+
+    LOG_INFO("Stats exporter listening on {}", cfg_.listen);
+    thread_ = std::thread{[this]
+                          { run_(); }};
+}
+
+StatsExporter::~StatsExporter()
+{
+    {
+        std::lock_guard lk{mtx_};
+        stopping_.store(true);
+    }
+    cv_.notify_all();
+    const uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(wakefd_, &one, sizeof one);
+    if (thread_.joinable())
+        thread_.join();
+
+    ::close(wakefd_);
+    ::close(epfd_);
+    ::close(listen_fd_);
+    if (!unix_path_.empty())
+        ::unlink(unix_path_.c_str());
+}
+
+StatsExporter::Metrics StatsExporter::metrics() const
+{
+    std::lock_guard lk{mtx_};
+    return metrics_;
+}
+
+void StatsExporter::run_()
+{
+    std::vector<std::unique_ptr<Client>> clients;
+    epoll_event events[32];
+
+    auto close_client = [&](Client *c)
+    {
+        ::epoll_ctl(epfd_, EPOLL_CTL_DEL, c->fd, nullptr);
+        ::close(c->fd);
+        if (c->out.capacity())
+            spare_.push_back(std::move(c->out));
+        std::erase_if(clients, [c](const auto &p)
+                      { return p.get() == c; });
+    };
+
+    // drop clients that sat on their slot past the deadline
+    auto expire = [&]
+    {
+        const auto now = Clock::now();
+        for (std::size_t i = clients.size(); i-- > 0;)
+        {
+            if (clients[i]->deadline <= now)
+            {
+                std::lock_guard lk{mtx_};
+                ++metrics_.rejected;
+                close_client(clients[i].get());
+            }
+        }
+    };
+
+    const int tick_ms = static_cast<int>(std::clamp<int64_t>(cfg_.request_timeout.count() / 4, 10, 1000));
+    while (!stopping_.load())
+    {
+        const int n = ::epoll_wait(epfd_, events, 32, clients.empty() ? -1 : tick_ms);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR("Stats exporter: epoll_wait: {}", std::strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            void *tag = events[i].data.ptr;
+            if (tag == &wakefd_)
+                continue; // stopping_ is checked by the loop
+
+            if (tag == nullptr)
+            {
+                while (true)
+                {
+                    const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (fd < 0)
+                        break;
+                    if (clients.size() >= cfg_.max_clients)
+                    {
+                        ::close(fd);
+                        std::lock_guard lk{mtx_};
+                        ++metrics_.rejected;
+                        continue;
+                    }
+                    auto c = std::make_unique<Client>();
+                    c->fd = fd;
+                    c->deadline = Clock::now() + cfg_.request_timeout;
+                    epoll_event ev{};
+                    ev.events = EPOLLIN | EPOLLRDHUP;
+                    ev.data.ptr = c.get();
+                    ::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+                    clients.push_back(std::move(c));
+                }
+                continue;
+            }
+
+            auto *c = static_cast<Client *>(tag);
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                close_client(c);
+                continue;
+            }
+
+            if (!c->responding)
+            {
+                char buf[2048];
+                const ssize_t r = ::recv(c->fd, buf, sizeof buf, 0);
+                if (r <= 0)
+                {
+                    if (r < 0 && (errno == EAGAIN || errno == EINTR))
+                        continue;
+                    close_client(c);
+                    continue;
+                }
+                c->in.append(buf, static_cast<std::size_t>(r));
+                if (c->in.find("\r\n\r\n") == std::string::npos)
+                {
+                    if (c->in.size() > kMaxRequest)
+                        close_client(c);
+                    continue;
+                }
+                serve_(*c);
+                c->responding = true;
+                c->deadline = Clock::now() + cfg_.request_timeout;
+                epoll_event ev{};
+                ev.events = EPOLLOUT;
+                ev.data.ptr = c;
+                ::epoll_ctl(epfd_, EPOLL_CTL_MOD, c->fd, &ev);
+            }
+
+            // try right away; EPOLLOUT brings us back if the socket fills up
+            while (c->sent < c->out.size())
+            {
+                const ssize_t w = ::send(c->fd, c->out.data() + c->sent, c->out.size() - c->sent, MSG_NOSIGNAL);
+                if (w < 0)
+                    break;
+                c->sent += static_cast<std::size_t>(w);
+                c->deadline = Clock::now() + cfg_.request_timeout;
+            }
+            if (c->sent >= c->out.size() || (errno != EAGAIN && errno != EINTR))
+                close_client(c);
+        }
+        expire();
+    }
+
+    for (auto &c : clients)
+        ::close(c->fd);
+}
+
+// Ask the UI thread for a fresh copy of the ledger and wait briefly for it.
+const StatsExporter::Snapshot &StatsExporter::snapshot_()
+{
+    std::unique_lock lk{mtx_};
+    const uint64_t asked = generation_;
+    want_.store(true, std::memory_order_release);
+    if (cv_.wait_for(lk, cfg_.snapshot_wait, [&]
+                     { return generation_ != asked || stopping_.load(); }) &&
+        generation_ != asked)
+    {
+        std::swap(front_, back_); // back_ keeps the old buffers for the next fill
+        seen_generation_ = generation_;
+    }
+    else
+    {
+        want_.store(false, std::memory_order_release);
+        ++metrics_.stale;
+    }
+    return front_;
+}
+
+void StatsExporter::serve_(Client &c)
+{
+    // request line: METHOD SP path SP version
+    const std::string_view req{c.in};
+    const std::string_view line = req.substr(0, req.find("\r\n"));
+    const auto sp1 = line.find(' ');
+    const auto sp2 = line.find(' ', sp1 == std::string_view::npos ? sp1 : sp1 + 1);
+    const std::string_view method = line.substr(0, sp1);
+    std::string_view path = sp1 == std::string_view::npos ? std::string_view{} : line.substr(sp1 + 1, sp2 - sp1 - 1);
+    path = path.substr(0, path.find('?'));
+
+    bool openmetrics = false;
+    for (std::string_view rest = req.substr(line.size()); !rest.empty();)
+    {
+        rest.remove_prefix(std::min<std::size_t>(2, rest.size()));
+        const std::string_view h = rest.substr(0, rest.find("\r\n"));
+        if (iequals_prefix(h, "accept:"))
+            openmetrics = h.find("application/openmetrics-text") != std::string_view::npos;
+        rest.remove_prefix(h.size());
+        if (h.empty())
+            break;
+    }
+
+    if (!spare_.empty())
+    {
+        c.out = std::move(spare_.back());
+        spare_.pop_back();
+    }
+    c.out.assign(kHeadRoom, ' ');
+
+    std::string_view status = "200 OK";
+    std::string_view type = openmetrics ? kOpenMetricsType : kTextType;
+    const bool head = method == "HEAD";
+    if (method != "GET" && !head)
+    {
+        status = "405 Method Not Allowed";
+        type = "text/plain";
+        c.out.append("method not allowed\n");
+    }
+    else if (path != "/metrics" && path != "/")
+    {
+        status = "404 Not Found";
+        type = "text/plain";
+        c.out.append("try /metrics\n");
+    }
+    else
+    {
+        const Snapshot &snap = snapshot_();
+        const auto t0 = Clock::now();
+        render_(snap, openmetrics, c.out);
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count();
+        std::lock_guard lk{mtx_};
+        ++metrics_.scrapes;
+        metrics_.render_us = static_cast<uint64_t>(us);
+        metrics_.bytes = c.out.size() - kHeadRoom;
+    }
+    if (status[0] != '2')
+    {
+        std::lock_guard lk{mtx_};
+        ++metrics_.rejected;
+    }
+
+    // header right‑aligned into the head room, so the body is never moved
+    char hdr[kHeadRoom];
+    const auto body = c.out.size() - kHeadRoom;
+    const auto r = std::format_to_n(hdr, sizeof hdr,
+                                    "HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n",
+                                    status, type, body);
+    const auto len = static_cast<std::size_t>(r.out - hdr);
+    std::memcpy(c.out.data() + kHeadRoom - len, hdr, len);
+    c.sent = kHeadRoom - len;
+    if (head)
+        c.out.resize(kHeadRoom);
+}
+
+void StatsExporter::render_(const Snapshot &snap, bool openmetrics, std::string &out)
+{
+    out.reserve(out.size() + snap.rows_.size() * kBytesPerRow + snap.endpoints_.size() * 256 + 1024);
+
+    // every container family repeats the same labels: escape them once
+    labels_.clear();
+    label_end_.clear();
+    for (const auto &r : snap.rows_)
+    {
+        labels_.append("{node=\"");
+        if (r.endpoint < snap.endpoints_.size())
+            put_label(labels_, snap.str_(snap.endpoints_[r.endpoint].off, snap.endpoints_[r.endpoint].len));
+        labels_.append("\",id=\"");
+        put_label(labels_, snap.str_(r.off, r.len));
+        labels_.append("\"} ");
+        label_end_.push_back(static_cast<uint32_t>(labels_.size()));
+    }
+    const std::string_view all{labels_};
+    auto labels = [&](std::size_t i)
+    {
+        const uint32_t from = i ? label_end_[i - 1] : 0;
+        out.append(all.substr(from, label_end_[i] - from));
+    };
+
+    put_family(out, "rezn_container_cpu_ratio", "gauge", "Average CPU use of the container (1 = 100 %).");
+    for (std::size_t i = 0; i < snap.rows_.size(); ++i)
+    {
+        const auto &r = snap.rows_[i];
+        if (!r.has_cpu)
+            continue;
+        out.append("rezn_container_cpu_ratio");
+        labels(i);
+        put_f64(out, r.cpu);
+        out.push_back('\n');
+    }
+
+    put_family(out, "rezn_container_memory_max_bytes", "gauge", "Peak memory of the container.");
+    for (std::size_t i = 0; i < snap.rows_.size(); ++i)
+    {
+        const auto &r = snap.rows_[i];
+        if (!r.has_mem)
+            continue;
+        out.append("rezn_container_memory_max_bytes");
+        labels(i);
+        put_u64(out, r.mem);
+        out.push_back('\n');
+    }
+
+    put_family(out, "rezn_container_last_sample_timestamp_seconds", "gauge",
+               "Timestamp of the newest sample for the container.");
+    for (std::size_t i = 0; i < snap.rows_.size(); ++i)
+    {
+        const auto &r = snap.rows_[i];
+        out.append("rezn_container_last_sample_timestamp_seconds");
+        labels(i);
+        put_millis(out, r.ts_ms);
+        out.push_back('\n');
+    }
+
+    put_family(out, "rezn_container_stale", "gauge", "1 if the container has gone silent.");
+    for (std::size_t i = 0; i < snap.rows_.size(); ++i)
+    {
+        const auto &r = snap.rows_[i];
+        out.append("rezn_container_stale");
+        labels(i);
+        out.append(r.stale ? "1\n" : "0\n");
+    }
+
+    put_family(out, "rezn_stats_endpoint_up", "gauge", "1 if the stats endpoint is streaming.");
+    for (const auto &e : snap.endpoints_)
+    {
+        out.append("rezn_stats_endpoint_up{node=\"");
+        put_label(out, snap.str_(e.off, e.len));
+        out.append(e.up ? "\"} 1\n" : "\"} 0\n");
+    }
+
+    // OpenMetrics names the counter family without the _total suffix
+    put_family(out, openmetrics ? "rezn_stats_endpoint_frames" : "rezn_stats_endpoint_frames_total",
+               "counter", "Data frames received from the stats endpoint.");
+    for (const auto &e : snap.endpoints_)
+    {
+        out.append("rezn_stats_endpoint_frames_total{node=\"");
+        put_label(out, snap.str_(e.off, e.len));
+        out.append("\"} ");
+        put_u64(out, e.frames);
+        out.push_back('\n');
+    }
+
+    put_family(out, openmetrics ? "rezn_stats_endpoint_gaps" : "rezn_stats_endpoint_gaps_total",
+               "counter", "Delta sequence gaps that forced a resubscribe.");
+    for (const auto &e : snap.endpoints_)
+    {
+        out.append("rezn_stats_endpoint_gaps_total{node=\"");
+        put_label(out, snap.str_(e.off, e.len));
+        out.append("\"} ");
+        put_u64(out, e.gaps);
+        out.push_back('\n');
+    }
+
+    put_family(out, "rezn_stats_containers", "gauge", "Containers in the merged ledger.");
+    out.append("rezn_stats_containers ");
+    put_u64(out, snap.rows_.size());
+    out.push_back('\n');
+
+    put_family(out, "rezn_stats_alerts_firing", "gauge", "Alert rules currently firing.");
+    out.append("rezn_stats_alerts_firing ");
+    put_u64(out, snap.alerts_firing_);
+    out.push_back('\n');
+
+    if (openmetrics)
+        out.append("# EOF\n");
+}
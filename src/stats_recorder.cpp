@@ -0,0 +1,649 @@
+#include "stats_recorder.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include "log.hpp"
+#include "log_service.hpp"
+
+namespace
+{
+    constexpr std::string_view kSegmentMagic = "RZSTATS1";
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kBlockMagic = 0x31425a52; // "RZB1"
+    constexpr std::size_t kBlockHeader = 40;
+    constexpr std::size_t kIndexEntry = 32;
+    constexpr uint32_t kMaxRawBlock = 64u << 20; // refuse absurd headers
+
+    constexpr uint8_t kRecFull = 1;
+    constexpr uint8_t kRecKeyframe = 2;
+    constexpr uint32_t kBlockKeyframe = 1;
+
+    constexpr uint8_t kHasCpu = 1;
+    constexpr uint8_t kHasMem = 2;
+
+    // --- little‑endian encoding ---------------------------------------------
+
+    template <typename T>
+    void put(std::string &out, T v)
+    {
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+            out.push_back(static_cast<char>(static_cast<uint64_t>(v) >> (8 * i)));
+    }
+
+    void put_str(std::string &out, std::string_view s)
+    {
+        s = s.substr(0, 0xFFFF);
+        put<uint16_t>(out, static_cast<uint16_t>(s.size()));
+        out.append(s);
+    }
+
+    template <typename T>
+    T get(const unsigned char *p)
+    {
+        uint64_t v = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+            v |= uint64_t{p[i]} << (8 * i);
+        return static_cast<T>(v);
+    }
+
+    /** Bounds‑checked reader over a byte range. */
+    struct Reader
+    {
+        const unsigned char *p;
+        const unsigned char *end;
+
+        template <typename T>
+        bool read(T &v)
+        {
+            if (static_cast<std::size_t>(end - p) < sizeof(T))
+                return false;
+            v = get<T>(p);
+            p += sizeof(T);
+            return true;
+        }
+
+        bool read_str(std::string_view &s)
+        {
+            uint16_t len;
+            if (!read(len) || static_cast<std::size_t>(end - p) < len)
+                return false;
+            s = {reinterpret_cast<const char *>(p), len};
+            p += len;
+            return true;
+        }
+    };
+
+    struct BlockHeader
+    {
+        uint32_t raw_len{};
+        uint32_t comp_len{};
+        uint32_t crc{};
+        uint64_t first_ms{};
+        uint64_t last_ms{};
+        uint32_t records{};
+        uint32_t flags{};
+    };
+
+    // header of the block at `off`, if a complete block is there
+    bool parse_block(const unsigned char *map, std::size_t size, std::size_t off, BlockHeader &h)
+    {
+        if (off > size || size - off < kBlockHeader)
+            return false;
+        const unsigned char *p = map + off;
+        if (get<uint32_t>(p) != kBlockMagic)
+            return false;
+        h.raw_len = get<uint32_t>(p + 4);
+        h.comp_len = get<uint32_t>(p + 8);
+        h.crc = get<uint32_t>(p + 12);
+        h.first_ms = get<uint64_t>(p + 16);
+        h.last_ms = get<uint64_t>(p + 24);
+        h.records = get<uint32_t>(p + 32);
+        h.flags = get<uint32_t>(p + 36);
+        return h.raw_len <= kMaxRawBlock && size - off - kBlockHeader >= h.comp_len;
+    }
+
+    bool write_all(int fd, const char *data, std::size_t len)
+    {
+        while (len)
+        {
+            const ssize_t n = ::write(fd, data, len);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += n;
+            len -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+} // namespace
+
+// -----------------------------------------------------------------------------
+// StatsRecorder
+// -----------------------------------------------------------------------------
+
+StatsRecorder::StatsRecorder(std::vector<std::string> endpoints, Config cfg)
+    : cfg_{std::move(cfg)}, endpoints_{std::move(endpoints)}, state_(endpoints_.size())
+{
+    std::error_code ec;
+    std::filesystem::create_directories(cfg_.dir, ec);
+    if (ec)
+        throw std::runtime_error("stats recorder: " + cfg_.dir.string() + ": " + ec.message());
+
+    thread_ = std::thread{[this]
+                          { run_(); }};
+}
+
+StatsRecorder::~StatsRecorder()
+{
+    {
+        std::lock_guard lock{mtx_};
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    close_segment_();
+}
+
+void StatsRecorder::record(std::size_t endpoint, uint64_t recv_ms, const StatsBatch &batch)
+{
+    std::lock_guard lock{mtx_};
+    if (stopping_ || metrics_.failed || endpoint >= state_.size())
+        return;
+
+    if (recv_ms >= next_keyframe_ms_)
+        keyframe_(recv_ms);
+
+    encode_(endpoint, recv_ms, batch, batch.full() ? kRecFull : 0);
+    apply_(state_[endpoint], batch);
+
+    if (open_.raw.size() >= cfg_.block_bytes)
+        seal_();
+}
+
+StatsRecorder::Metrics StatsRecorder::metrics() const
+{
+    std::lock_guard lock{mtx_};
+    return metrics_;
+}
+
+// same merge as StatsMailbox::publish(const StatsBatch &)
+void StatsRecorder::apply_(State &state, const StatsBatch &batch)
+{
+    if (batch.full())
+        state.clear(); // full snapshots are rare; rebuilding beats a sweep
+    for (const auto &[id, ts] : batch)
+    {
+        if (auto it = state.find(id); it != state.end())
+            it->second = ts;
+        else
+            state.emplace(id, ts);
+    }
+    for (const auto &id : batch.removed())
+    {
+        if (auto it = state.find(id); it != state.end())
+            state.erase(it);
+    }
+}
+
+void StatsRecorder::encode_(std::size_t endpoint, uint64_t recv_ms, const StatsBatch &batch, uint8_t flags)
+{
+    std::string &out = open_.raw;
+    if (open_.records == 0)
+    {
+        open_.first_ms = recv_ms;
+        opened_at_ = std::chrono::steady_clock::now();
+    }
+    open_.last_ms = std::max(open_.last_ms, recv_ms);
+    ++open_.records;
+    ++metrics_.records;
+
+    const std::size_t before = out.size();
+    put<uint8_t>(out, flags);
+    put<uint8_t>(out, 0);
+    put<uint16_t>(out, static_cast<uint16_t>(endpoint));
+    put<uint64_t>(out, recv_ms);
+    put<uint32_t>(out, static_cast<uint32_t>(batch.size()));
+    put<uint32_t>(out, static_cast<uint32_t>(batch.removed().size()));
+    for (const auto &[id, ts] : batch)
+    {
+        put_str(out, id);
+        put<uint8_t>(out, static_cast<uint8_t>((ts.stats.cpu_avg ? kHasCpu : 0) |
+                                               (ts.stats.max_mem ? kHasMem : 0)));
+        put<uint64_t>(out, std::bit_cast<uint64_t>(ts.stats.cpu_avg.value_or(0.0)));
+        put<uint64_t>(out, ts.stats.max_mem.value_or(0));
+        put<uint64_t>(out, ts.timestamp);
+    }
+    for (const auto &id : batch.removed())
+        put_str(out, id);
+    metrics_.raw_bytes += out.size() - before;
+}
+
+/** Start a keyframe block: the full state of every endpoint. */
+void StatsRecorder::keyframe_(uint64_t now_ms)
+{
+    seal_();
+    open_.keyframe = true;
+    for (std::size_t i = 0; i < state_.size(); ++i)
+    {
+        scratch_.clear();
+        scratch_.set_seq(0);
+        scratch_.set_full(true);
+        for (const auto &[id, ts] : state_[i])
+            scratch_.add(id, ts);
+        encode_(i, now_ms, scratch_, kRecFull | kRecKeyframe);
+    }
+    next_keyframe_ms_ = now_ms + static_cast<uint64_t>(
+                                     std::chrono::duration_cast<std::chrono::milliseconds>(cfg_.keyframe_every).count());
+}
+
+/** Hand the open block to the writer and start a new one. */
+void StatsRecorder::seal_()
+{
+    if (open_.records == 0)
+        return;
+    sealed_.push_back(std::move(open_));
+    open_ = Block{};
+    if (!spare_.empty())
+    {
+        open_.raw = std::move(spare_.back());
+        spare_.pop_back();
+        open_.raw.clear();
+    }
+    cv_.notify_one();
+}
+
+void StatsRecorder::run_()
+{
+    std::string zbuf; // compressed block, reused
+    std::unique_lock lock{mtx_};
+    while (true)
+    {
+        cv_.wait_for(lock, cfg_.flush_every, [&]
+                     { return stopping_ || !sealed_.empty(); });
+
+        if (open_.records &&
+            (stopping_ || std::chrono::steady_clock::now() - opened_at_ >= cfg_.flush_every))
+            seal_();
+
+        while (!sealed_.empty())
+        {
+            Block block = std::move(sealed_.front());
+            sealed_.pop_front();
+
+            lock.unlock();
+            const bool ok = !metrics_.failed && write_(block, zbuf);
+            const int err = errno;
+            lock.lock();
+
+            if (ok)
+            {
+                ++metrics_.blocks;
+            }
+            else if (!metrics_.failed)
+            {
+                metrics_.failed = true;
+                LOG_ERROR("Stats recorder: writing to {} failed: {}; recording stopped",
+                          cfg_.dir.string(), std::strerror(err));
+            }
+            if (spare_.size() < 4)
+                spare_.push_back(std::move(block.raw));
+        }
+
+        if (stopping_ && open_.records == 0)
+            return;
+    }
+}
+
+/** Compress and append one block (writer thread, no lock held). */
+bool StatsRecorder::write_(Block &block, std::string &zbuf)
+{
+    if (seg_fd_ < 0 || (block.keyframe && seg_bytes_ >= cfg_.segment_bytes))
+    {
+        close_segment_();
+        if (!open_segment_(block.first_ms))
+            return false;
+    }
+
+    uLongf zlen = compressBound(static_cast<uLong>(block.raw.size()));
+    zbuf.resize(kBlockHeader + zlen);
+    if (compress2(reinterpret_cast<Bytef *>(zbuf.data() + kBlockHeader), &zlen,
+                  reinterpret_cast<const Bytef *>(block.raw.data()),
+                  static_cast<uLong>(block.raw.size()), cfg_.level) != Z_OK)
+    {
+        errno = EIO;
+        return false;
+    }
+    zbuf.resize(kBlockHeader + zlen);
+
+    const uint32_t flags = block.keyframe ? kBlockKeyframe : 0;
+    std::string head;
+    put<uint32_t>(head, kBlockMagic);
+    put<uint32_t>(head, static_cast<uint32_t>(block.raw.size()));
+    put<uint32_t>(head, static_cast<uint32_t>(zlen));
+    put<uint32_t>(head, static_cast<uint32_t>(
+                            crc32(0, reinterpret_cast<const Bytef *>(block.raw.data()),
+                                  static_cast<uInt>(block.raw.size()))));
+    put<uint64_t>(head, block.first_ms);
+    put<uint64_t>(head, block.last_ms);
+    put<uint32_t>(head, block.records);
+    put<uint32_t>(head, flags);
+    std::memcpy(zbuf.data(), head.data(), kBlockHeader);
+
+    std::string entry;
+    put<uint64_t>(entry, block.first_ms);
+    put<uint64_t>(entry, block.last_ms);
+    put<uint64_t>(entry, seg_bytes_);
+    put<uint32_t>(entry, block.records);
+    put<uint32_t>(entry, flags);
+
+    if (!write_all(seg_fd_, zbuf.data(), zbuf.size()) || !write_all(idx_fd_, entry.data(), entry.size()))
+        return false;
+
+    seg_bytes_ += zbuf.size();
+    std::lock_guard lock{mtx_};
+    metrics_.file_bytes += zbuf.size();
+    return true;
+}
+
+bool StatsRecorder::open_segment_(uint64_t first_ms)
+{
+    // names sort chronologically; a clash (restart within the same ms) moves on
+    for (uint64_t ms = first_ms; ms < first_ms + 16; ++ms)
+    {
+        const auto base = cfg_.dir / std::format("stats-{:013}", ms);
+        seg_fd_ = ::open((base.string() + ".rzs").c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (seg_fd_ < 0 && errno == EEXIST)
+            continue;
+        if (seg_fd_ < 0)
+            return false;
+        idx_fd_ = ::open((base.string() + ".rzi").c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (idx_fd_ < 0)
+            return false;
+        break;
+    }
+    if (seg_fd_ < 0)
+        return false;
+
+    std::string head{kSegmentMagic};
+    put<uint32_t>(head, kVersion);
+    put<uint32_t>(head, static_cast<uint32_t>(endpoints_.size()));
+    for (const auto &uri : endpoints_)
+        put_str(head, uri);
+    if (!write_all(seg_fd_, head.data(), head.size()))
+        return false;
+
+    seg_bytes_ = head.size();
+    std::lock_guard lock{mtx_};
+    ++metrics_.segments;
+    metrics_.file_bytes += head.size();
+    return true;
+}
+
+void StatsRecorder::close_segment_()
+{
+    if (seg_fd_ >= 0)
+    {
+        ::fdatasync(seg_fd_);
+        ::close(seg_fd_);
+    }
+    if (idx_fd_ >= 0)
+        ::close(idx_fd_);
+    seg_fd_ = idx_fd_ = -1;
+    seg_bytes_ = 0;
+}
+
+// -----------------------------------------------------------------------------
+// StatsReplay
+// -----------------------------------------------------------------------------
+
+StatsReplay::StatsReplay(const std::filesystem::path &dir)
+{
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto &e : std::filesystem::directory_iterator{dir, ec})
+    {
+        if (e.path().extension() == ".rzs")
+            files.push_back(e.path());
+    }
+    if (ec)
+        throw std::runtime_error("stats replay: " + dir.string() + ": " + ec.message());
+    std::sort(files.begin(), files.end()); // zero‑padded start times
+
+    for (const auto &f : files)
+    {
+        Segment seg;
+        if (open_(f, seg))
+            segments_.push_back(std::move(seg));
+        else if (seg.map)
+            ::munmap(const_cast<unsigned char *>(seg.map), seg.size);
+    }
+    if (segments_.empty())
+        throw std::runtime_error("stats replay: no readable recording in " + dir.string());
+}
+
+StatsReplay::~StatsReplay()
+{
+    for (auto &s : segments_)
+        ::munmap(const_cast<unsigned char *>(s.map), s.size);
+}
+
+uint64_t StatsReplay::begin_ms() const noexcept
+{
+    return segments_.front().blocks.front().first_ms;
+}
+
+uint64_t StatsReplay::end_ms() const noexcept
+{
+    return segments_.back().blocks.back().last_ms;
+}
+
+/** Map a segment and collect its blocks; false if it has none usable. */
+bool StatsReplay::open_(const std::filesystem::path &path, Segment &seg)
+{
+    seg.path = path;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void *map = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    seg.map = static_cast<const unsigned char *>(map);
+    seg.size = static_cast<std::size_t>(st.st_size);
+    ::madvise(map, seg.size, MADV_SEQUENTIAL);
+
+    // header
+    Reader r{seg.map, seg.map + seg.size};
+    if (seg.size < kSegmentMagic.size() ||
+        std::memcmp(seg.map, kSegmentMagic.data(), kSegmentMagic.size()) != 0)
+        return false;
+    r.p += kSegmentMagic.size();
+    uint32_t version, count;
+    if (!r.read(version) || version != kVersion || !r.read(count))
+        return false;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        std::string_view uri;
+        if (!r.read_str(uri))
+            return false;
+        auto it = std::find(endpoints_.begin(), endpoints_.end(), uri);
+        if (it == endpoints_.end())
+            it = endpoints_.insert(endpoints_.end(), std::string{uri});
+        seg.endpoint.push_back(static_cast<std::size_t>(it - endpoints_.begin()));
+    }
+    std::size_t next = static_cast<std::size_t>(r.p - seg.map);
+
+    // sparse index, as far as it agrees with the segment
+    auto idx = path;
+    idx.replace_extension(".rzi");
+    if (const int ifd = ::open(idx.c_str(), O_RDONLY | O_CLOEXEC); ifd >= 0)
+    {
+        unsigned char e[kIndexEntry];
+        while (::read(ifd, e, sizeof(e)) == static_cast<ssize_t>(sizeof(e)))
+        {
+            IndexEntry ie{get<uint64_t>(e), get<uint64_t>(e + 8), get<uint64_t>(e + 16),
+                          get<uint32_t>(e + 24), get<uint32_t>(e + 28)};
+            BlockHeader h;
+            if (ie.offset != next || !parse_block(seg.map, seg.size, next, h) || h.first_ms != ie.first_ms)
+                break;
+            seg.blocks.push_back(ie);
+            next += kBlockHeader + h.comp_len;
+        }
+        ::close(ifd);
+    }
+
+    // blocks the index does not cover yet (or no index at all)
+    BlockHeader h;
+    while (parse_block(seg.map, seg.size, next, h))
+    {
+        seg.blocks.push_back({h.first_ms, h.last_ms, next, h.records, h.flags});
+        next += kBlockHeader + h.comp_len;
+    }
+
+    if (next != seg.size)
+        LOG_WARN("Stats replay: {} ends in a partial block", path.string());
+    return !seg.blocks.empty();
+}
+
+void StatsReplay::seek(uint64_t ms)
+{
+    seg_ = block_ = 0;
+    loaded_ = false;
+    bool found = false;
+    for (std::size_t s = 0; s < segments_.size(); ++s)
+    {
+        for (std::size_t b = 0; b < segments_[s].blocks.size(); ++b)
+        {
+            const auto &e = segments_[s].blocks[b];
+            if (!(e.flags & kBlockKeyframe))
+                continue;
+            if (found && e.first_ms > ms)
+                return;
+            seg_ = s;
+            block_ = b;
+            found = true;
+        }
+    }
+}
+
+/** Inflate the block under the cursor, skipping corrupt ones. */
+bool StatsReplay::load_block_()
+{
+    while (seg_ < segments_.size())
+    {
+        const Segment &seg = segments_[seg_];
+        if (block_ >= seg.blocks.size())
+        {
+            ++seg_;
+            block_ = 0;
+            continue;
+        }
+
+        BlockHeader h;
+        parse_block(seg.map, seg.size, seg.blocks[block_].offset, h);
+        raw_.resize(h.raw_len);
+        uLongf len = h.raw_len;
+        const int rc = uncompress(reinterpret_cast<Bytef *>(raw_.data()), &len,
+                                  seg.map + seg.blocks[block_].offset + kBlockHeader, h.comp_len);
+        if (rc != Z_OK || len != h.raw_len ||
+            crc32(0, reinterpret_cast<const Bytef *>(raw_.data()), static_cast<uInt>(len)) != h.crc)
+        {
+            LOG_WARN("Stats replay: corrupt block at offset {} in {}; skipping the rest of it",
+                     seg.blocks[block_].offset, seg.path.string());
+            ++seg_;
+            block_ = 0;
+            continue;
+        }
+        pos_ = 0;
+        loaded_ = true;
+        return true;
+    }
+    return false;
+}
+
+bool StatsReplay::next(std::size_t &endpoint, uint64_t &recv_ms, StatsBatch &batch)
+{
+    while (true)
+    {
+        if (!loaded_ && !load_block_())
+            return false;
+        if (pos_ >= raw_.size())
+        {
+            loaded_ = false;
+            ++block_;
+            continue;
+        }
+
+        const auto *base = reinterpret_cast<const unsigned char *>(raw_.data());
+        Reader r{base + pos_, base + raw_.size()};
+        uint8_t flags{}, pad{};
+        uint16_t local{};
+        uint32_t entries{}, removals{};
+        bool ok = r.read(flags) && r.read(pad) && r.read(local) && r.read(recv_ms) &&
+                  r.read(entries) && r.read(removals) && local < segments_[seg_].endpoint.size();
+
+        batch.clear();
+        if (ok && (flags & kRecFull))
+        {
+            batch.set_seq(0);
+            batch.set_full(true);
+        }
+        for (uint32_t i = 0; ok && i < entries; ++i)
+        {
+            std::string_view id;
+            uint8_t present{};
+            uint64_t cpu{}, mem{};
+            TimestampedStats ts{};
+            ok = r.read_str(id) && r.read(present) && r.read(cpu) && r.read(mem) && r.read(ts.timestamp);
+            if (!ok)
+                break; // truncated or corrupt record
+            if (present & kHasCpu)
+                ts.stats.cpu_avg = std::bit_cast<double>(cpu);
+            if (present & kHasMem)
+                ts.stats.max_mem = mem;
+            batch.add(id, ts);
+        }
+        for (uint32_t i = 0; ok && i < removals; ++i)
+        {
+            std::string_view id;
+            ok = r.read_str(id);
+            if (ok)
+                batch.remove(id);
+        }
+
+        if (!ok) // truncated record: the block is damaged past this point
+        {
+            LOG_WARN("Stats replay: truncated record in {}", segments_[seg_].path.string());
+            loaded_ = false;
+            ++block_;
+            continue;
+        }
+
+        pos_ = static_cast<std::size_t>(r.p - base);
+        endpoint = segments_[seg_].endpoint[local];
+        return true;
+    }
+}